@@ -0,0 +1,23 @@
+/*
+ * @file            bench/bench_alloc.h
+ * @description     Force included into the benchmarked sources to count allocations
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 13:30:12
+ * @lastModified    2026-10-17 13:30:12
+ */
+
+#ifndef BENCH_ALLOC_H
+#define BENCH_ALLOC_H
+
+#include <stddef.h>   // Not stdlib.h, the sources still have to pick their feature macros
+
+// Defined by bench_parser.c, which forwards to the real allocator
+void *bench_malloc(size_t size);
+void *bench_calloc(size_t count, size_t size);
+void *bench_realloc(void *ptr, size_t size);
+
+#define malloc(size) bench_malloc(size)
+#define calloc(count, size) bench_calloc(count, size)
+#define realloc(ptr, size) bench_realloc(ptr, size)
+
+#endif // BENCH_ALLOC_H
@@ -0,0 +1,326 @@
+/*
+ * @file            bench/bench_kernels.c
+ * @description     Times each translate_* kernel in isolation over pre-built entry streams
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 14:52:08
+ * @lastModified    2026-10-17 14:52:08
+ */
+
+#define _POSIX_C_SOURCE 200809L                                         // clock_gettime
+#define _DEFAULT_SOURCE                                                 // syscall
+
+// The kernels are static, so the parser is compiled into this file rather
+// than linked. Build it without exif_parser.o.
+#include "../src/exif_parser.c"
+
+#include "exif_writer.h"
+#include "output_builder.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/perf_event.h>)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#define BENCH_HAVE_PERF 1
+#endif
+#endif
+
+#define KERNEL_ENTRIES 1024                                             // Entries in each stream
+#define KERNEL_PASSES 301                                               // Passes per stream, the median is reported
+
+// **** Counters **** //
+
+// Hardware counters for this thread, user space only. Either fd is -1 when
+// the kernel, the hypervisor or perf_event_paranoid does not allow it.
+typedef struct {
+    int cycles;
+    int instructions;
+} PerfCounters;
+
+typedef struct {
+    uint64_t ns;
+    uint64_t cycles;
+    uint64_t instructions;
+} Sample;
+
+#ifdef BENCH_HAVE_PERF
+
+static int perf_open(uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;                                            // Allowed up to perf_event_paranoid 2
+    attr.exclude_hv = 1;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static void perf_start(int fd) {
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static uint64_t perf_stop(int fd) {
+    uint64_t value = 0;
+    if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd, &value, sizeof(value)) != (ssize_t)sizeof(value)) {
+            value = 0;
+        }
+    }
+    return value;
+}
+
+static PerfCounters counters_open(void) {
+    PerfCounters counters = { perf_open(PERF_COUNT_HW_CPU_CYCLES), perf_open(PERF_COUNT_HW_INSTRUCTIONS) };
+    return counters;
+}
+
+#else
+
+static void perf_start(int fd) {
+    (void)fd;
+}
+
+static uint64_t perf_stop(int fd) {
+    (void)fd;
+    return 0;
+}
+
+static PerfCounters counters_open(void) {
+    PerfCounters counters = { -1, -1 };
+    return counters;
+}
+
+#endif // BENCH_HAVE_PERF
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// **** Entry streams **** //
+
+typedef ErrorCode (*Kernel)(const ExifEntry *entry, OutputBuilder *output);
+
+typedef enum {
+    STREAM_BYTE,
+    STREAM_ASCII,
+    STREAM_SHORT,
+    STREAM_LONG,
+    STREAM_RATIONAL,
+    STREAM_UNDEFINED,
+    STREAM_SLONG,
+    STREAM_SRATIONAL,
+} StreamKind;
+
+static const struct {
+    const char *name;
+    Kernel kernel;
+    uint16_t type;
+} kernels[] = {
+    { "byte", translate_byte, EXIF_TYPE_BYTE },
+    { "ascii", translate_ascii, EXIF_TYPE_ASCII },
+    { "short", translate_short, EXIF_TYPE_SHORT },
+    { "long", translate_long, EXIF_TYPE_LONG },
+    { "rational", translate_rational, EXIF_TYPE_RATIONAL },
+    { "undefined", translate_undefined, EXIF_TYPE_UNDEFINED },
+    { "slong", translate_slong, EXIF_TYPE_SLONG },
+    { "srational", translate_srational, EXIF_TYPE_SRATIONAL },
+};
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+// Fixed seed so every run times the same values
+static uint32_t next_value(uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+// Fills values for entry i of a stream and describes it in field
+static void make_field(StreamKind kind, size_t i, uint32_t *rng, uint8_t *values, ExifWriterEntry *field) {
+    static const uint16_t undefined_tags[] = { 0x9000, 0xA000, 0x9101, 0xA300, 0xA301 };
+    static const char ascii_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ abcdefghijklmnopqrstuvwxyz0123456789:.,\"\\";
+
+    field->tag = (uint16_t)(0x9000 + i);
+    field->type = kernels[kind].type;
+    field->count = 1;
+    field->values = values;
+
+    switch (kind) {
+        case STREAM_BYTE: {
+            field->count = 1 + next_value(rng) % 4;
+            for (uint32_t b = 0; b < field->count; b++) {
+                values[b] = (uint8_t)next_value(rng);
+            }
+            break;
+        }
+        case STREAM_ASCII: {                                            // Date and name length strings, stored out of line
+            field->count = 8 + next_value(rng) % 32;
+            for (uint32_t c = 0; c + 1 < field->count; c++) {
+                values[c] = (uint8_t)ascii_chars[next_value(rng) % (sizeof(ascii_chars) - 1)];
+            }
+            values[field->count - 1] = '\0';
+            break;
+        }
+        case STREAM_SHORT: {
+            uint16_t value = (uint16_t)next_value(rng);
+            if (i % 8 == 0) {                                           // Some ColorSpace entries for the string path
+                field->tag = 0xA001;
+                value = (i % 16 == 0) ? 1 : 0xFFFF;
+            }
+            memcpy(values, &value, 2);
+            break;
+        }
+        case STREAM_LONG:
+        case STREAM_SLONG: {
+            uint32_t value = next_value(rng) >> (next_value(rng) % 32); // Spread the digit counts
+            memcpy(values, &value, 4);
+            break;
+        }
+        case STREAM_RATIONAL:
+        case STREAM_SRATIONAL: {
+            uint32_t pair[2] = { next_value(rng) % 100000, 1 + next_value(rng) % 1000 };
+            if (kind == STREAM_SRATIONAL && (i & 1)) {
+                pair[0] = (uint32_t)-(int32_t)pair[0];
+            }
+            memcpy(values, pair, 8);
+            break;
+        }
+        case STREAM_UNDEFINED: {
+            field->tag = undefined_tags[i % 5];
+            field->count = 4;
+            memcpy(values, (field->tag == 0x9101) ? "\x01\x02\x03\x00" : "0230", 4);
+            if (field->tag == 0xA300 || field->tag == 0xA301) {
+                memset(values, 0, 4);
+                values[0] = (uint8_t)(1 + i % 3);
+            }
+            break;
+        }
+    }
+}
+
+// Writes a TIFF block holding one IFD of the stream's entries and decodes
+// it, so the entries carry the byte order and data pointers the parser sees
+static bool build_stream(StreamKind kind, bool big_endian, OutputBuilder *tiff, ExifEntry *entries) {
+    ExifWriterEntry fields[KERNEL_ENTRIES];
+    static uint8_t values[KERNEL_ENTRIES][64];
+    uint32_t rng = 0x9E3779B9u + (uint32_t)kind;
+
+    for (size_t i = 0; i < KERNEL_ENTRIES; i++) {
+        make_field(kind, i, &rng, values[i], &fields[i]);
+    }
+
+    builder_rewind(tiff, 0);
+    if (exif_write_tiff(tiff, big_endian, fields, KERNEL_ENTRIES, NULL, 0) != ERR_OK) {
+        return false;
+    }
+
+    const uint8_t *block = (const uint8_t *)tiff->data;
+    for (size_t i = 0; i < KERNEL_ENTRIES; i++) {
+        if (decode_field(block, tiff->len, 8 + 2 + 12 * i, big_endian, &entries[i]) != ERR_OK) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// **** Measurement **** //
+
+static int compare_samples(const void *a, const void *b) {
+    uint64_t x = ((const Sample *)a)->ns;
+    uint64_t y = ((const Sample *)b)->ns;
+    return (x > y) - (x < y);
+}
+
+// Runs the kernel over the stream KERNEL_PASSES times and returns the median pass
+static Sample measure(Kernel kernel, const ExifEntry *entries, OutputBuilder *output, const PerfCounters *counters) {
+    static Sample samples[KERNEL_PASSES];
+
+    for (size_t pass = 0; pass < KERNEL_PASSES; pass++) {
+        builder_rewind(output, 0);
+        perf_start(counters->cycles);
+        perf_start(counters->instructions);
+        uint64_t start = now_ns();
+
+        for (size_t i = 0; i < KERNEL_ENTRIES; i++) {
+            kernel(&entries[i], output);
+        }
+
+        samples[pass].ns = now_ns() - start;
+        samples[pass].instructions = perf_stop(counters->instructions);
+        samples[pass].cycles = perf_stop(counters->cycles);
+    }
+
+    qsort(samples, KERNEL_PASSES, sizeof(Sample), compare_samples);
+    return samples[KERNEL_PASSES / 2];
+}
+
+// **** Entry point **** //
+
+int main(int argc, char **argv) {
+
+    const char *only = (argc > 1) ? argv[1] : NULL;                     // Optional kernel name filter
+    static ExifEntry entries[KERNEL_ENTRIES];
+    OutputBuilder tiff;
+    OutputBuilder output;
+
+    if (!builder_init(&tiff, 64 * 1024) || !builder_init(&output, 256 * 1024)) {
+        fprintf(stderr, "bench_kernels: out of memory\n");
+        return 1;
+    }
+
+    PerfCounters counters = counters_open();
+    bool have_perf = counters.cycles >= 0;
+    printf("%zu entries per stream, median of %d passes, %s\n\n", (size_t)KERNEL_ENTRIES, KERNEL_PASSES,
+           have_perf ? "cycles from perf_event_open" : "perf_event_open unavailable, clock_gettime only");
+    printf("%-10s %-6s %10s %12s %12s\n", "kernel", "endian", "ns/entry", "cycles/entry", "instr/entry");
+
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        if (only != NULL && strcmp(only, kernels[k].name) != 0) {
+            continue;
+        }
+
+        for (int endian = 0; endian < 2; endian++) {
+            bool big_endian = endian == 0;
+            if (!build_stream((StreamKind)k, big_endian, &tiff, entries)) {
+                fprintf(stderr, "bench_kernels: could not build the %s stream\n", kernels[k].name);
+                return 1;
+            }
+
+            Sample median = measure(kernels[k].kernel, entries, &output, &counters);
+            printf("%-10s %-6s %10.2f", kernels[k].name, big_endian ? "MM" : "II",
+                   (double)median.ns / KERNEL_ENTRIES);
+            if (have_perf) {
+                printf(" %12.1f %12.1f\n", (double)median.cycles / KERNEL_ENTRIES,
+                       (double)median.instructions / KERNEL_ENTRIES);
+            } else {
+                printf(" %12s %12s\n", "-", "-");
+            }
+        }
+    }
+
+    if (counters.cycles >= 0) {
+        close(counters.cycles);
+    }
+    if (counters.instructions >= 0) {
+        close(counters.instructions);
+    }
+    builder_free(&tiff);
+    builder_free(&output);
+    return 0;
+}
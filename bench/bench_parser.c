@@ -0,0 +1,358 @@
+/*
+ * @file            bench/bench_parser.c
+ * @description     End to end throughput of the parser against the legacy fixed buffer parser
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 13:30:12
+ * @lastModified    2026-10-17 13:30:12
+ */
+
+#define _POSIX_C_SOURCE 200809L                                         // clock_gettime, dup
+
+#include "exif_parser.h"
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// The legacy parser is built with its symbols renamed so both can link
+void legacy_parse_jpeg(const uint8_t *buffer, size_t length, char *outputBuffer, size_t outputCap);
+
+#define BENCH_PARSES 20000                                              // Parses per parser when no iteration count is given
+#define BENCH_MAX_ENTRIES 512
+#define BENCH_SCRATCH (64 * 1024)
+#define BENCH_THRESHOLD 10.0                                            // Percent a metric may get worse before it is flagged
+
+// **** Allocation counting **** //
+
+static size_t allocations = 0;
+
+void *bench_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+void *bench_calloc(size_t count, size_t size) {
+    allocations++;
+    return calloc(count, size);
+}
+
+void *bench_realloc(void *ptr, size_t size) {
+    allocations++;
+    return realloc(ptr, size);
+}
+
+// **** Corpus **** //
+
+typedef struct {
+    const char *path;
+    uint8_t *data;
+    size_t length;
+    size_t tags;                                                        // Entries the current parser reports for the file
+} BenchFile;
+
+typedef struct {
+    const char *name;
+    double files_per_sec;
+    double mb_per_sec;
+    double ns_per_tag;
+    double allocs_per_file;
+    double p50_ns;
+    double p99_ns;
+} BenchResult;
+
+typedef void (*BenchParser)(const BenchFile *file, char *scratch);
+
+// Metrics in the order they are printed and saved, with the direction that counts as better
+static const struct {
+    const char *key;
+    size_t offset;
+    bool higher_is_better;
+} metrics[] = {
+    { "files_per_sec", offsetof(BenchResult, files_per_sec), true },
+    { "mb_per_sec", offsetof(BenchResult, mb_per_sec), true },
+    { "ns_per_tag", offsetof(BenchResult, ns_per_tag), false },
+    { "allocs_per_file", offsetof(BenchResult, allocs_per_file), false },
+    { "p50_ns", offsetof(BenchResult, p50_ns), false },
+    { "p99_ns", offsetof(BenchResult, p99_ns), false },
+};
+#define METRIC_COUNT (sizeof(metrics) / sizeof(metrics[0]))
+
+static double metric(const BenchResult *result, size_t m) {
+    return *(const double *)((const char *)result + metrics[m].offset);
+}
+
+static bool load_file(BenchFile *file, const char *path) {
+    FILE *handle = fopen(path, "rb");
+    if (handle == NULL) {
+        return false;
+    }
+
+    fseek(handle, 0, SEEK_END);
+    long size = ftell(handle);
+    fseek(handle, 0, SEEK_SET);
+
+    file->path = path;
+    file->length = (size > 0) ? (size_t)size : 0;
+    file->data = malloc(file->length ? file->length : 1);
+    bool ok = file->data != NULL && fread(file->data, 1, file->length, handle) == file->length;
+    fclose(handle);
+
+    static ExifEntry entries[BENCH_MAX_ENTRIES];
+    size_t count = 0;
+    if (ok && parse_jpeg_entries(file->data, file->length, entries, BENCH_MAX_ENTRIES, &count) == ERR_OK) {
+        file->tags = count;
+    } else {
+        file->tags = 0;
+    }
+    return ok;
+}
+
+// **** Parsers **** //
+
+static void run_current(const BenchFile *file, char *scratch) {
+    (void)scratch;
+    free(parse_jpeg(file->data, file->length));
+}
+
+static void run_current_into(const BenchFile *file, char *scratch) {
+    size_t required = 0;
+    parse_jpeg_into(file->data, file->length, scratch, BENCH_SCRATCH, &required);
+}
+
+static void run_legacy(const BenchFile *file, char *scratch) {
+    legacy_parse_jpeg(file->data, file->length, scratch, BENCH_SCRATCH);
+}
+
+// **** Measurement **** //
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs parser over the corpus iterations times, timing every call
+static bool measure(const char *name, BenchParser parser, bool quiet, const BenchFile *files, size_t file_count,
+                    size_t iterations, BenchResult *result) {
+
+    size_t runs = file_count * iterations;
+    uint64_t *latencies = malloc(runs * sizeof(uint64_t));
+    char *scratch = malloc(BENCH_SCRATCH);
+    if (latencies == NULL || scratch == NULL) {
+        free(latencies);
+        free(scratch);
+        return false;
+    }
+
+    int saved_stdout = -1;
+    if (quiet) {                                                        // The legacy parser prints while it parses
+        fflush(stdout);
+        int null_fd = open("/dev/null", O_WRONLY);
+        saved_stdout = dup(STDOUT_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    }
+
+    size_t bytes = 0;
+    size_t tags = 0;
+    size_t run = 0;
+    size_t allocations_before = allocations;
+    uint64_t start = now_ns();
+
+    for (size_t it = 0; it < iterations; it++) {
+        for (size_t f = 0; f < file_count; f++) {
+            uint64_t t0 = now_ns();
+            parser(&files[f], scratch);
+            latencies[run++] = now_ns() - t0;
+            bytes += files[f].length;
+            tags += files[f].tags;
+        }
+    }
+
+    uint64_t elapsed = now_ns() - start;
+    size_t allocated = allocations - allocations_before;
+
+    if (quiet) {
+        fflush(stdout);
+        dup2(saved_stdout, STDOUT_FILENO);
+        close(saved_stdout);
+    }
+
+    qsort(latencies, runs, sizeof(uint64_t), compare_u64);
+    double seconds = (double)elapsed / 1e9;
+
+    result->name = name;
+    result->files_per_sec = (double)runs / seconds;
+    result->mb_per_sec = (double)bytes / (1024.0 * 1024.0) / seconds;
+    result->ns_per_tag = tags ? (double)elapsed / (double)tags : 0.0;
+    result->allocs_per_file = (double)allocated / (double)runs;
+    result->p50_ns = (double)latencies[runs / 2];
+    result->p99_ns = (double)latencies[(runs * 99) / 100];
+
+    free(latencies);
+    free(scratch);
+    return true;
+}
+
+// **** Baselines **** //
+
+static bool save_baseline(const char *path, const BenchResult *results, size_t count) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+
+    for (size_t r = 0; r < count; r++) {
+        for (size_t m = 0; m < METRIC_COUNT; m++) {
+            fprintf(file, "%s %s %.3f\n", results[r].name, metrics[m].key, metric(&results[r], m));
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// Compares against a saved baseline, returns the number of regressions or -1
+static int compare_baseline(const char *path, const BenchResult *results, size_t count, double threshold) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    char name[64];
+    char key[64];
+    double before = 0.0;
+    int regressions = 0;
+
+    printf("\n%-14s %-16s %14s %14s %9s\n", "parser", "metric", "baseline", "now", "change");
+    while (fscanf(file, "%63s %63s %lf", name, key, &before) == 3) {
+        for (size_t r = 0; r < count; r++) {
+            if (strcmp(results[r].name, name) != 0) {
+                continue;
+            }
+            for (size_t m = 0; m < METRIC_COUNT; m++) {
+                if (strcmp(metrics[m].key, key) != 0) {
+                    continue;
+                }
+
+                double after = metric(&results[r], m);
+                double change = (before != 0.0) ? (after - before) / before * 100.0 : 0.0;
+                double worse = metrics[m].higher_is_better ? -change : change;
+                bool regressed = (before == 0.0) ? (after > 0.0 && !metrics[m].higher_is_better) : worse > threshold;
+
+                printf("%-14s %-16s %14.2f %14.2f %+8.1f%%%s\n", name, key, before, after, change,
+                       regressed ? "  REGRESSION" : "");
+                regressions += regressed;
+            }
+        }
+    }
+    fclose(file);
+    return regressions;
+}
+
+// **** Entry point **** //
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--iterations N] [--no-legacy] [--save FILE] [--baseline FILE] [--threshold PCT] file...\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+
+    size_t iterations = 0;
+    bool legacy = true;
+    const char *save_path = NULL;
+    const char *baseline_path = NULL;
+    double threshold = BENCH_THRESHOLD;
+
+    BenchFile *files = calloc((size_t)argc, sizeof(BenchFile));
+    size_t file_count = 0;
+    size_t total_bytes = 0;
+    if (files == NULL) {
+        return 1;
+    }
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--iterations") == 0 && a + 1 < argc) {
+            iterations = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--no-legacy") == 0) {
+            legacy = false;
+        } else if (strcmp(argv[a], "--save") == 0 && a + 1 < argc) {
+            save_path = argv[++a];
+        } else if (strcmp(argv[a], "--baseline") == 0 && a + 1 < argc) {
+            baseline_path = argv[++a];
+        } else if (strcmp(argv[a], "--threshold") == 0 && a + 1 < argc) {
+            threshold = strtod(argv[++a], NULL);
+        } else if (argv[a][0] == '-') {
+            usage(argv[0]);
+            return 1;
+        } else if (load_file(&files[file_count], argv[a])) {
+            total_bytes += files[file_count].length;
+            file_count++;
+        } else {
+            fprintf(stderr, "bench: cannot read %s\n", argv[a]);
+        }
+    }
+
+    if (file_count == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (iterations == 0) {                                              // Enough passes for stable percentiles
+        iterations = (BENCH_PARSES + file_count - 1) / file_count;
+    }
+
+    BenchResult results[3];
+    size_t result_count = 0;
+    bool ok = measure("current", run_current, false, files, file_count, iterations, &results[result_count++]) &&
+              measure("current_into", run_current_into, false, files, file_count, iterations, &results[result_count++]);
+    if (ok && legacy) {
+        ok = measure("legacy", run_legacy, true, files, file_count, iterations, &results[result_count++]);
+    }
+    if (!ok) {
+        fprintf(stderr, "bench: out of memory\n");
+        return 1;
+    }
+
+    printf("corpus: %zu files, %zu bytes, %zu passes\n\n", file_count, total_bytes, iterations);
+    printf("%-14s %12s %10s %10s %12s %10s %10s\n", "parser", "files/s", "MB/s", "ns/tag", "allocs/file", "p50 ns",
+           "p99 ns");
+    for (size_t r = 0; r < result_count; r++) {
+        const BenchResult *result = &results[r];
+        printf("%-14s %12.0f %10.1f %10.1f %12.2f %10.0f %10.0f\n", result->name, result->files_per_sec,
+               result->mb_per_sec, result->ns_per_tag, result->allocs_per_file, result->p50_ns, result->p99_ns);
+    }
+
+    int status = 0;
+    if (baseline_path != NULL) {
+        int regressions = compare_baseline(baseline_path, results, result_count, threshold);
+        if (regressions < 0) {
+            fprintf(stderr, "bench: cannot read baseline %s\n", baseline_path);
+            status = 1;
+        } else if (regressions > 0) {
+            printf("\n%d metric(s) regressed by more than %.1f%%\n", regressions, threshold);
+            status = 2;
+        }
+    }
+    if (save_path != NULL && !save_baseline(save_path, results, result_count)) {
+        fprintf(stderr, "bench: cannot write baseline %s\n", save_path);
+        status = 1;
+    }
+
+    for (size_t f = 0; f < file_count; f++) {
+        free(files[f].data);
+    }
+    free(files);
+    return status;
+}
@@ -0,0 +1,11 @@
+/*
+ * @file            bench/legacy/exif_parser.h
+ * @description     Points the legacy parser's include at its own header
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 13:30:12
+ * @lastModified    2026-10-17 13:30:12
+ */
+
+// exif_parser-legacy.c includes "exif_parser.h", this directory sits first
+// on its include path so it gets the legacy declarations instead of ours
+#include "../../exif_parser-legacy.h"
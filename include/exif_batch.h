@@ -0,0 +1,55 @@
+/*
+ * @file            include/exif_batch.h
+ * @description     Parses many files at once on a pool of worker threads
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 12:03:51
+ * @lastModified    2026-10-17 00:17:50
+ */
+
+#ifndef EXIF_BATCH_H
+#define EXIF_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "exif_parser.h"
+
+// **** Batch Extraction **** //
+
+typedef struct {
+  unsigned threads;       // Worker threads, 0 uses one per online CPU
+  bool use_mmap;          // Map each file with exif_parse_mmap instead of pread
+  bool use_uring;         // Read through io_uring when the kernel allows it
+  unsigned queue_depth;   // Reads in flight with use_uring, 0 for the default
+} ExifBatchOptions;
+
+/**
+ * @brief Receives the result for one path. Runs on a worker thread, so calls
+ * for different paths can overlap, but each index is reported exactly once.
+ *
+ * @param index position of path in the list
+ * @param path
+ * @param status ERR_OK when json holds the parsed EXIF
+ * @param json JSON the callback must free, NULL unless status is ERR_OK
+ * @param user pointer handed to exif_parse_batch
+ */
+typedef void (*ExifBatchCallback)(size_t index, const char *path, ErrorCode status, char *json, void *user);
+
+/**
+ * @brief Parses every path on a pool of worker threads. Each worker owns a
+ * slice of the list and steals half of another worker's remaining slice once
+ * its own runs dry, so a few slow files do not leave the other cores idle.
+ * With use_uring the prefixes are read by exif_uring_batch instead, falling
+ * back to the worker pool when no ring can be created. Returns after every
+ * path has been reported.
+ *
+ * @param paths
+ * @param count
+ * @param options may be NULL for the defaults
+ * @param callback
+ * @param user passed through to callback
+ * @return ErrorCode ERR_MALLOC when the pool could not be set up
+ */
+ErrorCode exif_parse_batch(const char *const *paths, size_t count, const ExifBatchOptions *options, ExifBatchCallback callback, void *user);
+
+#endif // EXIF_BATCH_H
@@ -0,0 +1,128 @@
+/*
+ * @file            include/exif_filter.h
+ * @description     Filters over EXIF tags that are evaluated while the IFDs are walked
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 16:21:48
+ * @lastModified    2026-10-17 16:21:48
+ */
+
+#ifndef EXIF_FILTER_H
+#define EXIF_FILTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+
+#define EXIF_FILTER_MAX_NODES 32
+#define EXIF_FILTER_MAX_TEXT 64                                         // Longest string a text comparison holds
+
+// **** Filter **** //
+
+typedef enum {
+  EXIF_CMP_EQ,
+  EXIF_CMP_NE,
+  EXIF_CMP_LT,
+  EXIF_CMP_LE,
+  EXIF_CMP_GT,
+  EXIF_CMP_GE,
+} ExifCompare;
+
+typedef enum {
+  EXIF_NODE_NUMBER,       // Numeric tag against a number
+  EXIF_NODE_TEXT,         // ASCII tag against a string
+  EXIF_NODE_AND,
+  EXIF_NODE_OR,
+} ExifNodeKind;
+
+typedef struct {
+  uint8_t kind;           // One of ExifNodeKind
+  uint8_t compare;        // One of ExifCompare, leaves only
+  uint16_t tag;           // Leaves only
+  int16_t left;           // AND and OR only, always an earlier node
+  int16_t right;
+  uint8_t text_len;
+  char text[EXIF_FILTER_MAX_TEXT];
+  double number;
+} ExifFilterNode;
+
+// A filter is a small expression tree stored in one array. Children are
+// always added before their parent, so the nodes are already in evaluation
+// order and the last one added is the root.
+typedef struct {
+  ExifFilterNode nodes[EXIF_FILTER_MAX_NODES];
+  size_t count;
+  ExifTagSet tags;        // Every tag a leaf reads, the only ones decoded
+  bool invalid;           // A builder call failed, matching reports ERR_INVALID_TAG
+} ExifFilter;
+
+void exif_filter_init(ExifFilter *filter);
+
+// ** Builders ** //
+
+// Each returns the index of the new node to pass to exif_filter_and and
+// exif_filter_or, or -1 when the tag is unknown, the text is too long, a
+// child is -1 or the filter is full. A failed call marks the whole filter
+// invalid.
+
+/**
+ * @brief Compares a SHORT, LONG, SLONG, RATIONAL or SRATIONAL tag with a
+ * number. Rationals compare by their quotient, arrays by their first
+ * component.
+ *
+ * @param filter
+ * @param tag
+ * @param compare
+ * @param number
+ * @return int node index, -1 on failure
+ */
+int exif_filter_number(ExifFilter *filter, uint16_t tag, ExifCompare compare, double number);
+
+/**
+ * @brief Compares an ASCII tag with a string, byte by byte. Trailing spaces
+ * in the tag are ignored, so Make and Model match their plain names, and
+ * EXIF dates order correctly as text.
+ *
+ * @param filter
+ * @param tag
+ * @param compare
+ * @param text NUL terminated, at most EXIF_FILTER_MAX_TEXT bytes
+ * @return int node index, -1 on failure
+ */
+int exif_filter_text(ExifFilter *filter, uint16_t tag, ExifCompare compare, const char *text);
+
+int exif_filter_and(ExifFilter *filter, int left, int right);
+int exif_filter_or(ExifFilter *filter, int left, int right);
+
+// ** Evaluation ** //
+
+/**
+ * @brief Evaluates the filter as the IFDs are walked. Only the tags the
+ * filter reads are decoded, and the walk stops as soon as the result is
+ * decided false. A tag missing from the image makes its comparison false.
+ *
+ * @param filter
+ * @param buffer
+ * @param length
+ * @return ErrorCode ERR_OK when the image matches, ERR_FILTERED when not
+ */
+ErrorCode exif_filter_match(const ExifFilter *filter, const uint8_t *buffer, size_t length);
+
+/**
+ * @brief parse_jpeg_select for images that match the filter. The IFDs are
+ * walked once, keeping the selected entries unformatted while the filter is
+ * evaluated. Rejected images stop at the first deciding tag and never build
+ * any JSON.
+ *
+ * @param filter
+ * @param buffer
+ * @param length
+ * @param tags NULL selects every tag for the output
+ * @param json set to the JSON the caller must free, NULL unless ERR_OK
+ * @return ErrorCode ERR_FILTERED when the image does not match
+ */
+ErrorCode parse_jpeg_where(const ExifFilter *filter, const uint8_t *buffer, size_t length, const ExifTagSet *tags,
+                           char **json);
+
+#endif // EXIF_FILTER_H
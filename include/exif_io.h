@@ -0,0 +1,194 @@
+/*
+ * @file            include/exif_io.h
+ * @description     Reads just enough of an image file to parse its EXIF
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 10:41:07
+ * @lastModified    2026-10-17 00:44:01
+ */
+
+#ifndef EXIF_IO_H
+#define EXIF_IO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+
+// Bytes read from the start of the file before looking for EXIF. APP1 sits
+// near the start of almost every JPEG, so one read usually covers it.
+#define EXIF_READ_WINDOW (64 * 1024)
+
+// Bytes read at a time while walking PNG and WebP chunk headers. Chunks
+// ahead of the image data are small, and the image data itself is skipped
+// by seeking, not read.
+#define EXIF_CHUNK_WINDOW 4096
+
+// **** File Readers **** //
+
+/**
+ * @brief One round of the prefix read loop, for readers that drive their own
+ * I/O. Decides from the bytes read so far whether the prefix is complete.
+ *
+ * @param data prefix read so far
+ * @param have bytes held in data
+ * @param window bytes that were asked for, fewer in have means end of file
+ * @param file_size SIZE_MAX when unknown
+ * @param next_window set to the prefix length to read next, 0 once finished
+ * @param tiff_offset set to where the TIFF header starts in data once ERR_OK
+ * @param tiff_length set to the bytes of TIFF data once ERR_OK
+ * @return ErrorCode ERR_TRUNCATED with a next_window when more must be read
+ */
+ErrorCode exif_prefix_step(const uint8_t *data, size_t have, size_t window, size_t file_size, size_t *next_window,
+                           size_t *tiff_offset, size_t *tiff_length);
+
+/**
+ * @brief Reads the shortest prefix of the file that holds the EXIF segment.
+ * Starts with EXIF_READ_WINDOW bytes and only reads further when a segment
+ * or the APP1 length runs past what has been read. Every read is a pread, so
+ * pipes and sockets fail with ERR_IO; the readers below share this.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param buffer set to a malloc'd prefix of the file, free it manually
+ * @param length set to the bytes held in buffer
+ * @return ErrorCode ERR_EXIF_MISSING when the file has no EXIF segment
+ */
+ErrorCode exif_read_prefix(int fd, uint8_t **buffer, size_t *length);
+
+/**
+ * @brief Reads the eXIf data of a PNG. The chunk headers are walked through
+ * EXIF_CHUNK_WINDOW reads, seeking past every chunk that does not fit in
+ * the window, so IDAT is never read and a large image costs a few reads.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param tiff set to the malloc'd TIFF block of the eXIf chunk, free it manually
+ * @param length set to the bytes held in tiff
+ * @return ErrorCode ERR_EXIF_MISSING when the file is no PNG or has no eXIf
+ * chunk, ERR_TIFF_OVERFLOW when the file ends inside it
+ */
+ErrorCode exif_read_png(int fd, uint8_t **tiff, size_t *length);
+
+/**
+ * @brief exif_read_png for WebP. The first read holds the VP8X flags, a file
+ * without the EXIF flag costs that one read, otherwise the chunks are walked
+ * past the bitstream the same way.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param tiff set to the malloc'd TIFF block of the EXIF chunk, free it manually
+ * @param length set to the bytes held in tiff
+ * @return ErrorCode ERR_EXIF_MISSING when the file is no WebP or has no EXIF
+ * chunk, ERR_TIFF_OVERFLOW when the file ends inside it
+ */
+ErrorCode exif_read_webp(int fd, uint8_t **tiff, size_t *length);
+
+/**
+ * @brief exif_read_png for HEIC and AVIF. The top level box headers are
+ * walked to meta, which is read whole, then iinf and iloc give the Exif item
+ * and one positioned read fetches it. mdat is never read past that item.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param tiff set to the malloc'd TIFF block of the Exif item, free it manually
+ * @param length set to the bytes held in tiff
+ * @return ErrorCode ERR_EXIF_MISSING when the file is no HEIF or has no Exif
+ * item, ERR_TIFF_OVERFLOW when the file ends inside it
+ */
+ErrorCode exif_read_heif(int fd, uint8_t **tiff, size_t *length);
+
+/**
+ * @brief exif_read_png for JPEG XL. The top level boxes are walked past the
+ * codestream to the Exif box, which is read whole. A bare codestream has no
+ * EXIF.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param tiff set to the malloc'd TIFF block of the Exif box, free it manually
+ * @param length set to the bytes held in tiff
+ * @return ErrorCode ERR_EXIF_MISSING when the file is no JPEG XL container or
+ * has no Exif box, ERR_TIFF_OVERFLOW when the file ends inside it
+ */
+ErrorCode exif_read_jxl(int fd, uint8_t **tiff, size_t *length);
+
+/**
+ * @brief exif_read_png for bare TIFF files. The IFDs and the values they
+ * point to can lie anywhere in the file, so the header and then each IFD of
+ * the chain are read where they are, followed by the values of its known
+ * tags. Strip data and anything else no IFD references is never read.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param tiff set to a malloc'd block with the bytes read at their file
+ * offsets and zeros between them, free it manually
+ * @param length set to the bytes held in tiff
+ * @return ErrorCode ERR_EXIF_MISSING when the file is no TIFF
+ */
+ErrorCode exif_read_tiff(int fd, uint8_t **tiff, size_t *length);
+
+/**
+ * @brief Parses the EXIF of an open file into JSON, reading only what it
+ * needs. JPEG reads the shortest prefix that holds APP1. PNG, WebP, HEIC,
+ * AVIF, JPEG XL and TIFF files are recognised from their signature and read
+ * with exif_read_png, exif_read_webp, exif_read_heif, exif_read_jxl and
+ * exif_read_tiff.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param json set to JSON that must be freed, NULL unless ERR_OK
+ * @return ErrorCode
+ */
+ErrorCode exif_json_fd(int fd, char **json);
+
+/**
+ * @brief The JSON step of exif_json_fd for a TIFF block the caller read,
+ * as the io_uring reader does with the span exif_prefix_step located
+ *
+ * @param tiff starts at the TIFF header
+ * @param length
+ * @param json set to JSON that must be freed, NULL unless ERR_OK
+ * @return ErrorCode
+ */
+ErrorCode exif_json_tiff(const uint8_t *tiff, size_t length, char **json);
+
+/**
+ * @brief exif_json_fd without the status
+ *
+ * @param fd
+ * @return char* JSON that must be freed, NULL when nothing could be parsed
+ */
+char *exif_parse_fd(int fd);
+
+/**
+ * @brief exif_parse_fd for a file path
+ *
+ * @param path
+ * @return char* JSON that must be freed, NULL when nothing could be parsed
+ */
+char *exif_parse_path(const char *path);
+
+/**
+ * @brief exif_thumbnail for an open file. Only the prefix up to the end of
+ * the APP1 segment is read, which holds the thumbnail, and none of it is
+ * kept: the span is given as a file offset for the caller to read or send.
+ *
+ * @param fd file opened for reading, its offset is not used or changed
+ * @param thumbnail data is always NULL, offset is from the start of the file
+ * @return ErrorCode same as exif_thumbnail
+ */
+ErrorCode exif_thumbnail_fd(int fd, ExifThumbnail *thumbnail);
+
+/**
+ * @brief exif_json_fd over a read-only mapping of the file, for any format
+ * exif_locate knows. The mapping is advised for random access so that only
+ * the pages the header walk and the EXIF block touch are faulted in, the
+ * header window is prefetched.
+ *
+ * @param path
+ * @param json set to JSON that must be freed, NULL unless ERR_OK
+ * @return ErrorCode ERR_IO when the path cannot be mapped
+ */
+ErrorCode exif_json_mmap(const char *path, char **json);
+
+/**
+ * @brief exif_json_mmap without the status
+ *
+ * @param path
+ * @return char* JSON that must be freed, NULL when nothing could be parsed
+ */
+char *exif_parse_mmap(const char *path);
+
+#endif // EXIF_IO_H
@@ -3,7 +3,7 @@
  * @description
  * @author          Jesse Peterson
  * @createTime      2025-06-27 22:51:55
- * @lastModified    2025-07-18 09:32:31
+ * @lastModified    2026-10-17 00:47:03
  */
 
 #ifndef EXIF_PARSER_H
@@ -16,6 +16,12 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include "output_builder.h"
+
+// The parser keeps no mutable state outside the call: lookup tables are const
+// and every output buffer belongs to the caller. Calls on different buffers
+// may run on different threads at once, see exif_batch.h.
+
 // **** Error Handling **** //
 typedef enum {
   ERR_OK = 0,
@@ -31,6 +37,11 @@ typedef enum {
   ERR_LONG_COUNT,
   ERR_RATIONAL_COUNT,
   ERR_UNKNOWN_UNDEFINED,
+  ERR_TRUNCATED,
+  ERR_IO,
+  ERR_FILTERED,
+  ERR_JPEG_INVALID,
+  ERR_CHECKSUM,
   ERR_UNKNOWN,
 } ErrorCode;
 
@@ -44,54 +55,215 @@ typedef struct {
 // Lookup for Exif tags
 typedef struct {
   uint16_t tag;
-  const char *name;
+  uint16_t name_len;      // strlen(name), computed at compile time
+  const char *name;       // NULL for an empty slot
 } ExifTag;
 
-// Array of ExifTag struct
-static const ExifTag exif_tags[] = {
-    {0x010F, "Make"},
-    {0x0110, "Model"},
-    {0x0112, "Orientation"},
-    // {0x011A, "XResolution"},
-    // {0x011B, "YResolution"},
-    // {0x0128, "ResolutionUnit"},
-    // {0x0131, "Software"},
-    {0x0132, "ModifyDate"},
-    {0x8298, "Copyright"},
-    {0x8769, "ExifOffset"},
-
-    {0x829A, "ExposureTime"},
-    {0x829D, "FNumber"},
-    {0x8822, "ExposureProgram"},
-    {0x8827, "ISO"},
-    {0x8830, "SensitivityType"},
-    {0x8831, "StandardOutputSensitivity"},
-    // {0x9000, "ExifVersion"},
-    {0x9003, "DateTimeOriginal"},
-    {0x9004, "CreateDate"},
-    // {0x9101, "ComponentsConfiguration"},
-    // {0x9204, "ExposureCompensation"},
-    // {0x9207, "MeteringMode"},
-    // {0x9209, "Flash"},
-    {0x920A, "FocalLength"},
-    // {0xA000, "FlashpixVersion"},
-    {0xA001, "ColorSpace"},
-    {0xA002, "ExifImageWidth"},
-    {0xA003, "ExifImageHeight"},
-    // {0xA217, "SensingMethod"},
-    // {0xA300, "FileSource"},
-    // {0xA301, "SceneType"},
-    // {0xA401, "CustomRendered"},
-    // {0xA402, "ExposureMode"},
-    // {0xA403, "WhiteBalanced"},
-    {0xA405, "FocalLengthIn35mmFormat"},
-    // {0xA406, "SceneCaptureType"},
-    {0xA408, "Contrast"},
-    {0xA409, "Saturation"},
-    {0xA40A, "Sharpness"},
-    // {0xA40C, "SubjectDistanceRange"},
-    {0xA500, "Gamma"},
-};
+// The tag table is indexed by a multiplicative hash that is collision free for
+// every tag in it, so a lookup is one multiply, one load and one compare.
+#define EXIF_TAG_SLOT_BITS 7
+#define EXIF_TAG_SLOTS (1u << EXIF_TAG_SLOT_BITS)
+#define EXIF_TAG_HASH_MUL 0xB1F90A3Fu
+#define EXIF_TAG_SLOT(tag) ((uint32_t)((uint32_t)(tag) * EXIF_TAG_HASH_MUL) >> (32 - EXIF_TAG_SLOT_BITS))
+
+extern const ExifTag exif_tag_table[EXIF_TAG_SLOTS];
+
+/**
+ * @brief Finds the descriptor of a known tag in constant time
+ *
+ * @param tag
+ * @return const ExifTag* NULL when the tag is unknown
+ */
+static inline const ExifTag *exif_tag_lookup(uint16_t tag) {
+  const ExifTag *slot = &exif_tag_table[EXIF_TAG_SLOT(tag)];
+  return (slot->tag == tag && slot->name != NULL) ? slot : NULL;
+}
+
+// ** IFDs ** //
+
+// The IFDs of an EXIF block. IFD0 links to IFD1 through its next IFD offset,
+// the others are reached through pointer tags: ExifOffset (0x8769) and
+// GPSInfo (0x8825) in IFD0, InteropOffset (0xA005) in the Exif IFD.
+typedef enum {
+  EXIF_IFD_0 = 0,
+  EXIF_IFD_EXIF,
+  EXIF_IFD_GPS,
+  EXIF_IFD_INTEROP,
+  EXIF_IFD_1,             // The thumbnail, the chain is not followed past it
+} ExifIfd;
+
+#define EXIF_IFD_BIT(ifd) (1u << (ifd))
+// What parse_jpeg has always reported, GPS and the rest are opted into
+#define EXIF_IFDS_DEFAULT (EXIF_IFD_BIT(EXIF_IFD_0) | EXIF_IFD_BIT(EXIF_IFD_EXIF))
+#define EXIF_IFDS_ALL 0x1Fu
+
+// GPS and Interop tags are small numbers that mean something else in the
+// other IFDs, so each has its own table indexed by the tag itself
+#define EXIF_GPS_TAGS 32
+#define EXIF_INTEROP_TAGS 4
+
+extern const ExifTag exif_gps_tag_table[EXIF_GPS_TAGS];
+extern const ExifTag exif_interop_tag_table[EXIF_INTEROP_TAGS];
+
+/**
+ * @brief Finds the descriptor of a known tag in the table of its IFD. IFD0,
+ * the Exif IFD and IFD1 share the main table.
+ *
+ * @param ifd
+ * @param tag
+ * @return const ExifTag* NULL when the tag is unknown in that IFD
+ */
+static inline const ExifTag *exif_ifd_tag_lookup(ExifIfd ifd, uint16_t tag) {
+  const ExifTag *known;
+  switch (ifd) {
+    case EXIF_IFD_GPS:
+      known = (tag < EXIF_GPS_TAGS) ? &exif_gps_tag_table[tag] : NULL;
+      break;
+    case EXIF_IFD_INTEROP:
+      known = (tag < EXIF_INTEROP_TAGS) ? &exif_interop_tag_table[tag] : NULL;
+      break;
+    default:
+      return exif_tag_lookup(tag);
+  }
+  return (known != NULL && known->name != NULL) ? known : NULL;
+}
+
+// Every known tag of every IFD has a key, used to index tag sets and the
+// lazy index. IFD0 and the Exif IFD share the keys of the main table, IFD1
+// has its own copy so a thumbnail tag is never mistaken for the image's.
+#define EXIF_KEY_IFD1 EXIF_TAG_SLOTS
+#define EXIF_KEY_GPS (2 * EXIF_TAG_SLOTS)
+#define EXIF_KEY_INTEROP (EXIF_KEY_GPS + EXIF_GPS_TAGS)
+#define EXIF_TAG_KEYS (EXIF_KEY_INTEROP + EXIF_INTEROP_TAGS)
+
+/**
+ * @brief The key of a known tag in an IFD
+ *
+ * @param ifd
+ * @param tag
+ * @return int -1 when the tag is unknown in that IFD
+ */
+static inline int exif_tag_key(ExifIfd ifd, uint16_t tag) {
+  if (exif_ifd_tag_lookup(ifd, tag) == NULL) {
+    return -1;
+  }
+  switch (ifd) {
+    case EXIF_IFD_GPS:
+      return EXIF_KEY_GPS + tag;
+    case EXIF_IFD_INTEROP:
+      return EXIF_KEY_INTEROP + tag;
+    case EXIF_IFD_1:
+      return EXIF_KEY_IFD1 + (int)EXIF_TAG_SLOT(tag);
+    default:
+      return (int)EXIF_TAG_SLOT(tag);
+  }
+}
+
+// ** Tag selection ** //
+
+// A set of known tags, one bit per tag key, and the IFDs the walk descends
+// into. Only known tags are ever reported, so those are the only ones that
+// can be selected.
+typedef struct {
+  uint64_t bits[(EXIF_TAG_KEYS + 63) / 64];
+  unsigned count;         // Tags in the set
+  unsigned ifds;          // EXIF_IFD_BIT mask of the IFDs to walk
+} ExifTagSet;
+
+static inline void exif_tagset_clear(ExifTagSet *set) {
+  memset(set, 0, sizeof(*set));
+  set->ifds = EXIF_IFDS_DEFAULT;
+}
+
+static inline bool exif_tagset_has_in(const ExifTagSet *set, ExifIfd ifd, uint16_t tag) {
+  int key = exif_tag_key(ifd, tag);
+  return key >= 0 && ((set->bits[key >> 6] >> (key & 63)) & 1u);
+}
+
+static inline bool exif_tagset_has(const ExifTagSet *set, uint16_t tag) {
+  return exif_tagset_has_in(set, EXIF_IFD_0, tag);
+}
+
+/**
+ * @brief Adds a tag of one IFD to the set and walks that IFD
+ *
+ * @param set
+ * @param ifd
+ * @param tag
+ * @return bool false when the tag is not in the table of that IFD
+ */
+static inline bool exif_tagset_add_in(ExifTagSet *set, ExifIfd ifd, uint16_t tag) {
+  int key = exif_tag_key(ifd, tag);
+  if (key < 0) {
+    return false;
+  }
+  if (!exif_tagset_has_in(set, ifd, tag)) {
+    set->bits[key >> 6] |= (uint64_t)1 << (key & 63);
+    set->count++;
+  }
+  set->ifds |= EXIF_IFD_BIT(ifd);
+  return true;
+}
+
+/**
+ * @brief Adds a tag of IFD0 or the Exif IFD to the set
+ *
+ * @param set
+ * @param tag
+ * @return bool false when the tag is not in the tag table
+ */
+static inline bool exif_tagset_add(ExifTagSet *set, uint16_t tag) {
+  return exif_tagset_add_in(set, EXIF_IFD_0, tag);
+}
+
+/**
+ * @brief Adds every known tag of the IFDs in a mask, so they are reported
+ * whole, and walks them
+ *
+ * @param set
+ * @param ifds EXIF_IFD_BIT mask
+ */
+void exif_tagset_add_ifds(ExifTagSet *set, unsigned ifds);
+
+// TIFF field types
+typedef enum {
+  EXIF_TYPE_BYTE = 1,
+  EXIF_TYPE_ASCII = 2,
+  EXIF_TYPE_SHORT = 3,
+  EXIF_TYPE_LONG = 4,
+  EXIF_TYPE_RATIONAL = 5,
+  EXIF_TYPE_SBYTE = 6,
+  EXIF_TYPE_UNDEFINED = 7,
+  EXIF_TYPE_SSHORT = 8,
+  EXIF_TYPE_SLONG = 9,
+  EXIF_TYPE_SRATIONAL = 10,
+  EXIF_TYPE_FLOAT = 11,
+  EXIF_TYPE_DOUBLE = 12,
+} ExifType;
+
+// One decoded IFD entry. data points into the buffer handed to the parser,
+// so an entry is only valid for as long as that buffer is.
+typedef struct {
+  uint16_t tag;
+  uint16_t type;          // One of ExifType, unknown types are passed through
+  uint32_t count;         // Number of components, not bytes
+  bool big_endian;        // Byte order of the bytes at data
+  uint8_t ifd;            // One of ExifIfd, where the entry was found
+  union {
+    uint32_t u;           // BYTE, SHORT, LONG and the first byte of ASCII/UNDEFINED
+    int32_t i;            // SBYTE, SSHORT, SLONG
+    struct {
+      uint32_t numerator;
+      uint32_t denominator;
+    } rational;
+    struct {
+      int32_t numerator;
+      int32_t denominator;
+    } srational;
+  } value;                // First component in host order, exif_entry_values decodes the rest
+  const uint8_t *data;    // Raw value bytes, inline or at the offset
+  uint32_t length;        // Bytes at data
+} ExifEntry;
 
 
 // ** Entry point ** //
@@ -104,22 +276,294 @@ static const ExifTag exif_tags[] = {
  */
 char *parse_jpeg(const uint8_t *buffer, size_t length);
 
+/**
+ * @brief parse_jpeg limited to a set of tags. Other tags are skipped without
+ * decoding their values, and the walk stops as soon as every selected tag
+ * has been seen, so looking up one tag near the start of IFD0 costs the
+ * same however large the rest of the EXIF is.
+ *
+ * @param buffer
+ * @param length
+ * @param tags NULL selects every tag
+ * @return char* same contract as parse_jpeg
+ */
+char *parse_jpeg_select(const uint8_t *buffer, size_t length, const ExifTagSet *tags);
+
+/**
+ * @brief parse_jpeg for a bare TIFF block, the EXIF payload every container
+ * format wraps
+ *
+ * @param tiff starts at the byte order mark
+ * @param tiff_length
+ * @return char* same contract as parse_jpeg
+ */
+char *parse_tiff(const uint8_t *tiff, size_t tiff_length);
+
+/**
+ * @brief Appends the JSON for the selected tags to a caller's builder, for
+ * callers that manage their own output memory
+ *
+ * @param buffer
+ * @param length
+ * @param tags NULL selects every tag
+ * @param output
+ * @return ErrorCode ERR_MALLOC when a growable builder could not grow
+ */
+ErrorCode parse_jpeg_to_builder(const uint8_t *buffer, size_t length, const ExifTagSet *tags, OutputBuilder *output);
+
+/**
+ * @brief parse_jpeg_to_builder for a bare TIFF block
+ *
+ * @param tiff starts at the byte order mark
+ * @param tiff_length
+ * @param tags NULL selects every tag
+ * @param output
+ * @return ErrorCode ERR_MALLOC when a growable builder could not grow
+ */
+ErrorCode parse_tiff_to_builder(const uint8_t *tiff, size_t tiff_length, const ExifTagSet *tags, OutputBuilder *output);
+
+/**
+ * @brief Parses the exif data into a caller supplied buffer, nothing is
+ * allocated. Pass a NULL output and a cap of 0 to only query the size.
+ *
+ * @param buffer
+ * @param length
+ * @param output caller owned memory, left NUL terminated like snprintf
+ * @param output_cap size of output in bytes
+ * @param required set to the bytes needed including the NUL terminator, 0 when
+ * the image could not be parsed
+ * @return ErrorCode ERR_TOO_SMALL when output_cap is less than *required
+ */
+ErrorCode parse_jpeg_into(const uint8_t *buffer, size_t length, char *output, size_t output_cap, size_t *required);
+
+/**
+ * @brief Decodes the known exif tags into typed entries without formatting
+ * any text. Entries point into buffer, so buffer must outlive them.
+ *
+ * @param buffer
+ * @param length
+ * @param entries caller owned array, may be NULL when capacity is 0
+ * @param capacity number of entries that fit in the array
+ * @param count set to the number of entries found, even past capacity
+ * @return ErrorCode ERR_TOO_SMALL when capacity is less than *count
+ */
+ErrorCode parse_jpeg_entries(const uint8_t *buffer, size_t length, ExifEntry *entries, size_t capacity, size_t *count);
+
+/**
+ * @brief parse_jpeg_entries limited to a set of tags, see parse_jpeg_select
+ *
+ * @param buffer
+ * @param length
+ * @param tags NULL selects every tag
+ * @param entries caller owned array, may be NULL when capacity is 0
+ * @param capacity number of entries that fit in the array
+ * @param count set to the number of entries found, even past capacity
+ * @return ErrorCode ERR_TOO_SMALL when capacity is less than *count
+ */
+ErrorCode parse_jpeg_entries_select(const uint8_t *buffer, size_t length, const ExifTagSet *tags, ExifEntry *entries,
+                                    size_t capacity, size_t *count);
+
+typedef ErrorCode (*EntryVisitor)(const ExifEntry *entry, void *ctx);   // Returning anything but ERR_OK stops the crawl
+
+/**
+ * @brief Calls visit with each selected entry in file order, without
+ * formatting anything. Entries point into buffer.
+ *
+ * @param buffer
+ * @param length
+ * @param tags NULL selects every tag
+ * @param visit
+ * @param ctx handed to visit
+ * @return ErrorCode the first status visit returns other than ERR_OK
+ */
+ErrorCode exif_visit_entries(const uint8_t *buffer, size_t length, const ExifTagSet *tags, EntryVisitor visit, void *ctx);
+
+// ** Lazy index ** //
+
+// One IFD record as the index keeps it, decoded only when it is asked for
+typedef struct {
+  uint16_t tag;
+  uint16_t type;
+  uint32_t count;
+  uint32_t record;        // Offset of the 12 byte record in the TIFF block
+  uint8_t ifd;            // One of ExifIfd
+} ExifIndexRecord;
+
+// The known tags of one image, at most one record per tag key, so it fits
+// in fixed arrays and lives in caller memory. It points into the buffer it
+// was built from. exif_get fills the cache, so an index is not shared
+// between threads without a lock.
+typedef struct {
+  const uint8_t *tiff;
+  size_t tiff_length;
+  bool big_endian;
+  size_t count;                           // Records in use
+  ExifIndexRecord records[EXIF_TAG_KEYS];
+  uint16_t slots[EXIF_TAG_KEYS];          // Record index + 1 per tag key, 0 when absent
+  char *values[EXIF_TAG_KEYS];            // Formatted values by record, NULL until requested
+} ExifIndex;
+
+/**
+ * @brief Records the tag, type, count and position of every known entry in
+ * every IFD without decoding or formatting any value. A built index can be
+ * built again for another image, the values cached for the last one are
+ * freed first.
+ *
+ * @param index caller owned and zero initialised before its first build,
+ * release it with exif_index_free
+ * @param buffer must outlive the index
+ * @param length
+ * @return ErrorCode
+ */
+ErrorCode exif_index_build(ExifIndex *index, const uint8_t *buffer, size_t length);
+
+/**
+ * @brief Decodes one tag of IFD0 or the Exif IFD from the index into a
+ * typed entry
+ *
+ * @param index
+ * @param tag
+ * @param entry
+ * @return ErrorCode ERR_INVALID_TAG when the image does not have the tag
+ */
+ErrorCode exif_get_entry(const ExifIndex *index, uint16_t tag, ExifEntry *entry);
+
+/**
+ * @brief exif_get_entry for a tag of any IFD
+ *
+ * @param index
+ * @param ifd
+ * @param tag
+ * @param entry
+ * @return ErrorCode ERR_INVALID_TAG when the IFD does not have the tag
+ */
+ErrorCode exif_get_entry_in(const ExifIndex *index, ExifIfd ifd, uint16_t tag, ExifEntry *entry);
+
+/**
+ * @brief Formats one tag of IFD0 or the Exif IFD the first time it is
+ * requested and caches it. The text is the value exactly as parse_jpeg
+ * writes it after "Name":
+ *
+ * @param index
+ * @param tag
+ * @param value set to text owned by the index, valid until exif_index_free
+ * @return ErrorCode ERR_INVALID_TAG when the image does not have the tag
+ */
+ErrorCode exif_get(ExifIndex *index, uint16_t tag, const char **value);
+
+/**
+ * @brief exif_get for a tag of any IFD
+ *
+ * @param index
+ * @param ifd
+ * @param tag
+ * @param value set to text owned by the index, valid until exif_index_free
+ * @return ErrorCode ERR_INVALID_TAG when the IFD does not have the tag
+ */
+ErrorCode exif_get_in(ExifIndex *index, ExifIfd ifd, uint16_t tag, const char **value);
+
+/**
+ * @brief Releases the cached values, the index itself is caller memory
+ *
+ * @param index
+ */
+void exif_index_free(ExifIndex *index);
+
+// ** Thumbnail ** //
+
+// The JPEG thumbnail that IFD1 points to, as a span of the caller's buffer
+typedef struct {
+  const uint8_t *data;    // Into the buffer handed in, NULL when read from a file
+  size_t offset;          // From the start of the buffer, which is the file offset for a file prefix
+  size_t length;          // Bytes of the thumbnail JPEG, SOI through EOI
+  uint16_t orientation;   // IFD0 Orientation, 1 when the image has none
+} ExifThumbnail;
+
+/**
+ * @brief Finds the thumbnail from ThumbnailOffset and ThumbnailLength
+ * (0x0201 and 0x0202) in IFD1 and the Orientation in IFD0. Nothing is copied
+ * or decoded, and only IFD0 and IFD1 are walked.
+ *
+ * @param buffer
+ * @param length
+ * @param thumbnail set to a span of buffer, the orientation is set even
+ * when there is no thumbnail
+ * @return ErrorCode ERR_INVALID_TAG when there is no JPEG thumbnail,
+ * ERR_EXIF_OVERFLOW when it lies outside the APP1 segment
+ */
+ErrorCode exif_thumbnail(const uint8_t *buffer, size_t length, ExifThumbnail *thumbnail);
+
+/**
+ * @brief Serialises entries into the same JSON parse_jpeg produces, with the
+ * same buffer contract as parse_jpeg_into
+ *
+ * @param entries
+ * @param count
+ * @param output caller owned memory, left NUL terminated like snprintf
+ * @param output_cap size of output in bytes
+ * @param required set to the bytes needed including the NUL terminator
+ * @return ErrorCode ERR_TOO_SMALL when output_cap is less than *required
+ */
+ErrorCode exif_entries_to_json(const ExifEntry *entries, size_t count, char *output, size_t output_cap, size_t *required);
+
+/**
+ * @brief Appends one entry as a JSON member, the way parse_jpeg writes it,
+ * for visitors that build their own object. Entries parse_jpeg skips write
+ * nothing.
+ *
+ * @param entry
+ * @param output
+ * @param written members already in the object, for the separator, counts up
+ * when the entry is written
+ * @return ErrorCode ERR_MALLOC when a growable builder could not grow
+ */
+ErrorCode exif_entry_to_builder(const ExifEntry *entry, OutputBuilder *output, size_t *written);
+
+/**
+ * @brief Decodes the components of a SHORT, LONG, SLONG, RATIONAL or SRATIONAL
+ * entry to host order, however many it has. Large arrays are converted with
+ * the SIMD loaders in exif_swap.h.
+ *
+ * @param entry
+ * @param first component to start at
+ * @param values caller owned, SHORTs are widened and signed types keep their
+ * two's complement bits. A rational fills two slots, numerator first.
+ * @param capacity slots in values, only whole components are written
+ * @return size_t slots written, 0 for any other type or when first is past
+ * the last component
+ */
+size_t exif_entry_values(const ExifEntry *entry, size_t first, uint32_t *values, size_t capacity);
+
+/**
+ * @brief Walks the JPEG markers to the APP1 EXIF segment. Works on a prefix
+ * of the file: when the walk runs off the end of buffer, needed says how many
+ * bytes from the start of the file are required to continue.
+ *
+ * @param buffer
+ * @param length
+ * @param tiff_offset set to where the TIFF header starts in buffer
+ * @param tiff_length set to the bytes of TIFF data in the segment
+ * @param needed may be NULL, set when ERR_TRUNCATED or ERR_TIFF_OVERFLOW
+ * @return ErrorCode ERR_EXIF_MISSING once SOS or EOI is reached first
+ */
+ErrorCode jpeg_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed);
+
 // **** STATIC FUNCTIONS **** //
 
 // ** Helper Functions ** //
 static char *get_error_string(ErrorCode code);
-static const char *get_exif_tag_name(uint16_t tag);
 
 // ** Parsing functions ** //
-static ErrorCode u8_crawler(const uint8_t *buffer, uint16_t seg_length, size_t offset, char **output);
-static ErrorCode translate_byte(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian);
-static ErrorCode translate_ascii(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian);
-static ErrorCode translate_short(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian, const uint16_t tag);
-static ErrorCode translate_long(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian);
-static ErrorCode translate_rational(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian);
-static ErrorCode translate_undefined(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian, const uint16_t tag);
-static ErrorCode translate_slong(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian);
-static ErrorCode translate_srational(const uint8_t *buffer, const uint32_t count, const uint8_t *val_or_off, size_t offset, char **response, const bool big_endian);
+
+static ErrorCode u8_crawler(const uint8_t *tiff, size_t tiff_length, const ExifTagSet *tags, EntryVisitor visit, void *ctx);
+static ErrorCode translate_byte(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_ascii(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_short(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_long(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_rational(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_undefined(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_slong(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode translate_srational(const ExifEntry *entry, OutputBuilder *output);
 
 
 #endif // EXIF_PARSER_H
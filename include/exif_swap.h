@@ -0,0 +1,60 @@
+/*
+ * @file            include/exif_swap.h
+ * @description     Bulk byte order conversion of SHORT, LONG and RATIONAL arrays
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 15:40:22
+ * @lastModified    2026-10-17 15:40:22
+ */
+
+#ifndef EXIF_SWAP_H
+#define EXIF_SWAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// **** Host byte order **** //
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define EXIF_HOST_BIG_ENDIAN true
+#else
+#define EXIF_HOST_BIG_ENDIAN false
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define EXIF_BSWAP16(x) __builtin_bswap16(x)
+#define EXIF_BSWAP32(x) __builtin_bswap32(x)
+#else
+#define EXIF_BSWAP16(x) ((uint16_t)(((x) >> 8) | ((x) << 8)))
+#define EXIF_BSWAP32(x) ((((x) >> 24) & 0xFFu) | (((x) >> 8) & 0xFF00u) | (((x) << 8) & 0xFF0000u) | ((x) << 24))
+#endif
+
+// **** Array Loaders **** //
+
+// Both loaders copy straight through when the data is already in host order.
+// Otherwise the bulk of the array goes through the widest byte shuffle the
+// target has (AVX2 when the CPU reports it, SSE2, WASM SIMD128) and the tail
+// through the scalar swap. src needs no particular alignment.
+
+/**
+ * @brief Converts count 16 bit components to host order
+ *
+ * @param dst room for count values, must not overlap src
+ * @param src raw component bytes, 2 * count of them
+ * @param count
+ * @param big_endian byte order of src
+ */
+void exif_load_u16(uint16_t *dst, const uint8_t *src, size_t count, bool big_endian);
+
+/**
+ * @brief Converts count 32 bit components to host order. A RATIONAL is two
+ * components, numerator first.
+ *
+ * @param dst room for count values, must not overlap src
+ * @param src raw component bytes, 4 * count of them
+ * @param count
+ * @param big_endian byte order of src
+ */
+void exif_load_u32(uint32_t *dst, const uint8_t *src, size_t count, bool big_endian);
+
+#endif // EXIF_SWAP_H
@@ -0,0 +1,48 @@
+/*
+ * @file            include/exif_uring.h
+ * @description     Batch prefix reader that keeps many reads in flight on io_uring
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 12:48:20
+ * @lastModified    2026-10-17 12:48:20
+ */
+
+#ifndef EXIF_URING_H
+#define EXIF_URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "exif_batch.h"
+#include "exif_parser.h"
+
+// Reads kept in flight when the caller does not pick a queue depth
+#define EXIF_URING_DEPTH 128
+#define EXIF_URING_MAX_DEPTH 256
+
+// **** io_uring Reader **** //
+
+/**
+ * @brief True when this build has the io_uring reader and the kernel lets
+ * this process create a ring. Seccomp filters and the io_uring_disabled
+ * sysctl both make it unavailable on kernels that otherwise support it.
+ *
+ * @return bool
+ */
+bool exif_uring_available(void);
+
+/**
+ * @brief Parses every path from a single thread with up to depth prefix reads
+ * in flight. Files are opened depth paths ahead of their read and advised
+ * with POSIX_FADV_WILLNEED, finished prefixes go straight to parse_jpeg.
+ *
+ * @param paths
+ * @param count
+ * @param depth reads in flight, 0 for EXIF_URING_DEPTH
+ * @param callback same contract as exif_parse_batch
+ * @param user
+ * @return ErrorCode ERR_IO when no ring could be created, in which case no
+ * path has been reported yet and the caller can fall back to pread
+ */
+ErrorCode exif_uring_batch(const char *const *paths, size_t count, unsigned depth, ExifBatchCallback callback, void *user);
+
+#endif // EXIF_URING_H
@@ -0,0 +1,76 @@
+/*
+ * @file            include/exif_writer.h
+ * @description     Writes TIFF blocks and JPEG files holding chosen EXIF entries
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 14:05:37
+ * @lastModified    2026-10-17 14:05:37
+ */
+
+#ifndef EXIF_WRITER_H
+#define EXIF_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+#include "output_builder.h"
+
+// Largest TIFF block an APP1 segment holds, its length field also counts
+// itself and the "Exif\0\0" header
+#define EXIF_WRITER_MAX_TIFF (0xFFFF - 2 - 6)
+
+// **** Entries **** //
+
+// One IFD entry to write. values holds count components in host byte order,
+// a RATIONAL or SRATIONAL component is two uint32_t, numerator first.
+typedef struct {
+  uint16_t tag;
+  uint16_t type;        // One of ExifType
+  uint32_t count;       // Number of components, not bytes
+  const void *values;
+} ExifWriterEntry;
+
+// Segments written around the EXIF, in file order
+typedef struct {
+  size_t app2_count;    // APP2 blocks written before APP1
+  size_t app2_size;     // Payload bytes of each APP2 block
+  bool exif;            // Write the APP1 segment, false leaves the EXIF out
+  size_t scan_size;     // Bytes of entropy coded data after SOS
+} ExifJpegLayout;
+
+// **** TIFF and JPEG Writers **** //
+
+/**
+ * @brief Appends a TIFF block with IFD0 and, when exif_count is not 0, an
+ * Exif IFD that IFD0 points to through a trailing ExifOffset entry. Values
+ * wider than 4 bytes are stored after their IFD at word aligned offsets.
+ *
+ * @param output receives the TIFF bytes
+ * @param big_endian write an "MM" block instead of "II"
+ * @param ifd0
+ * @param ifd0_count
+ * @param exif may be NULL when exif_count is 0
+ * @param exif_count
+ * @return ErrorCode ERR_INVALID_TAG for an unknown type, ERR_MALLOC or
+ * ERR_TOO_SMALL when the builder could not hold the block
+ */
+ErrorCode exif_write_tiff(OutputBuilder *output, bool big_endian, const ExifWriterEntry *ifd0, size_t ifd0_count,
+                          const ExifWriterEntry *exif, size_t exif_count);
+
+/**
+ * @brief Appends a baseline JPEG skeleton: SOI, the APP2 blocks, APP1 with
+ * the TIFF block, an 8x8 SOF0 frame header, SOS with filler scan data and
+ * EOI. The markers pass is_jpeg, the scan data does not decode.
+ *
+ * @param output receives the JPEG bytes
+ * @param tiff TIFF block from exif_write_tiff, unused when layout->exif is false
+ * @param tiff_length
+ * @param layout
+ * @return ErrorCode ERR_EXIF_OVERFLOW when the TIFF block or an APP2 block
+ * does not fit in one segment, ERR_MALLOC or ERR_TOO_SMALL when the builder
+ * could not hold the file
+ */
+ErrorCode exif_write_jpeg(OutputBuilder *output, const uint8_t *tiff, size_t tiff_length, const ExifJpegLayout *layout);
+
+#endif // EXIF_WRITER_H
@@ -6,22 +6,89 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "exif_parser.h"
+#include "jpeg_segments.h"
+
+// Bytes of the file start that identify every format, nothing past them is
+// read to tell formats apart
+#define FORMAT_SNIFF_BYTES 32
+
+typedef enum {
+    IMAGE_FORMAT_UNKNOWN = 0,
+    IMAGE_FORMAT_JPEG,
+    IMAGE_FORMAT_PNG,
+    IMAGE_FORMAT_WEBP,
+    IMAGE_FORMAT_HEIC,
+    IMAGE_FORMAT_AVIF,
+    IMAGE_FORMAT_JXL,
+    IMAGE_FORMAT_TIFF,
+} ImageFormat;
+
+// Finds the TIFF block holding the EXIF of one format. Same contract as
+// jpeg_find_exif: needed says how long a prefix to read when the buffer ends
+// before the EXIF does.
+typedef ErrorCode (*ExifLocator)(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length,
+                                 size_t *needed);
 
 
 //////// ** ////////
 // FORMAT READERS //
 //////// ** ////////
 
+// Walks and validates the whole marker structure, see jpeg_index_build
 bool is_jpeg(const uint8_t *buffer, size_t length);
 
-bool is_png();
+// is_jpeg that keeps the segment table for parse_jpeg_indexed
+bool is_jpeg_indexed(const uint8_t *buffer, size_t length, JpegIndex *index);
+
+// The others only look at the signature in the first FORMAT_SNIFF_BYTES
+bool is_png(const uint8_t *buffer, size_t length);
+
+bool is_avif(const uint8_t *buffer, size_t length);
+
+bool is_heic(const uint8_t *buffer, size_t length);
+
+bool is_webp(const uint8_t *buffer, size_t length);
 
-bool is_avif();
+/**
+ * @brief Identifies the format from the signature at the start of the file.
+ * Works on any prefix, a prefix shorter than a signature does not match it.
+ *
+ * @param buffer
+ * @param length
+ * @return ImageFormat IMAGE_FORMAT_UNKNOWN when no signature matches
+ */
+ImageFormat readImageFormat(const uint8_t *buffer, size_t length);
 
-bool is_heic();
+/**
+ * @brief The EXIF locator for a format
+ *
+ * @param format
+ * @return ExifLocator NULL for IMAGE_FORMAT_UNKNOWN
+ */
+ExifLocator exif_locator(ImageFormat format);
 
-bool is_webp();
+/**
+ * @brief Identifies the format and finds its EXIF TIFF block
+ *
+ * @param buffer
+ * @param length
+ * @param format may be NULL, set to the format found
+ * @param tiff_offset set to where the TIFF header starts in buffer
+ * @param tiff_length set to the bytes of TIFF data
+ * @param needed may be NULL, see ExifLocator
+ * @return ErrorCode ERR_EXIF_MISSING for unknown formats and images without EXIF
+ */
+ErrorCode exif_locate(const uint8_t *buffer, size_t length, ImageFormat *format, size_t *tiff_offset, size_t *tiff_length,
+                      size_t *needed);
 
-uint8_t readImageFormat(const uint8_t *buffer, size_t length);
+/**
+ * @brief parse_jpeg for any supported format
+ *
+ * @param buffer
+ * @param length
+ * @return char* same contract as parse_jpeg
+ */
+char *parse_image(const uint8_t *buffer, size_t length);
 
-#endif // FORMAT_READER_H
\ No newline at end of file
+#endif // FORMAT_READER_H
@@ -0,0 +1,126 @@
+/*
+ * @file            include/heif_boxes.h
+ * @description     Finds the Exif item of a HEIC or AVIF through the meta, iinf and iloc boxes,
+ *                  and the Exif box of a JPEG XL container
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 20:41:18
+ * @lastModified    2026-10-17 20:41:18
+ */
+
+#ifndef HEIF_BOXES_H
+#define HEIF_BOXES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+
+// Size and type, a 64 bit size follows them when the 32 bit one is 1
+#define HEIF_BOX_HEADER 8
+#define HEIF_LARGE_BOX_HEADER 16
+
+// A meta box or Exif item larger than this is taken as corrupt rather than
+// read. iPhone HEICs keep a few dozen KiB in meta.
+#define HEIF_MAX_METADATA (16 * 1024 * 1024)
+
+// The signature box that starts a JPEG XL container, a bare codestream has
+// no boxes and so no EXIF
+#define JXL_SIGNATURE "\x00\x00\x00\x0CJXL \r\n\x87\n"
+#define JXL_SIGNATURE_LENGTH 12
+
+// **** Items **** //
+
+// Where the data of an item is, as iloc gives it
+typedef struct {
+  uint64_t offset;        // From the start of the file, or of the meta payload when in_meta
+  uint64_t length;
+  bool in_meta;           // Stored in the idat box of meta rather than in the file
+} HeifItem;
+
+// **** Box Walk **** //
+
+/**
+ * @brief Jumps over the top level boxes by their sizes until meta. The
+ * payload of mdat and every other box is skipped unread. Works on any window
+ * of the file that starts at a box, see png_scan_chunks.
+ *
+ * @param buffer
+ * @param length
+ * @param offset where the first box starts in buffer, set to where the walk
+ * stopped: the meta box or the next box header, which may lie past length
+ * @param meta_offset set to where the meta payload starts in buffer
+ * @param meta_length set to the bytes of meta payload, which may run past length
+ * @return ErrorCode ERR_TRUNCATED when the next box header is not in buffer,
+ * ERR_EXIF_MISSING when a box runs to the end of the file first or a size is
+ * corrupt
+ */
+ErrorCode heif_scan_boxes(const uint8_t *buffer, size_t length, size_t *offset, size_t *meta_offset, size_t *meta_length);
+
+/**
+ * @brief Finds the item of type Exif in iinf and its extents in iloc
+ *
+ * @param meta payload of the meta box, from its version byte
+ * @param meta_length
+ * @param item set to where the item data is
+ * @return ErrorCode ERR_EXIF_MISSING when there is no Exif item, or its
+ * location cannot be read as one run of bytes
+ */
+ErrorCode heif_exif_item(const uint8_t *meta, size_t meta_length, HeifItem *item);
+
+/**
+ * @brief Skips the header of Exif item data, a 32 bit offset to the TIFF
+ * header that usually covers an "Exif\0\0" prefix
+ *
+ * @param data item data
+ * @param length
+ * @param tiff_offset set to where the TIFF header starts in data
+ * @param tiff_length set to the bytes of TIFF data
+ * @return ErrorCode ERR_TIFF_MISSING when the offset points past the item
+ */
+ErrorCode heif_exif_payload(const uint8_t *data, size_t length, size_t *tiff_offset, size_t *tiff_length);
+
+/**
+ * @brief ExifLocator for HEIC and AVIF, same contract as jpeg_find_exif
+ *
+ * @param buffer starts at the ftyp box
+ * @param length
+ * @param tiff_offset set to where the TIFF header starts
+ * @param tiff_length set to the bytes of TIFF data
+ * @param needed may be NULL, set to the prefix length to read next when
+ * ERR_TRUNCATED or ERR_TIFF_OVERFLOW
+ * @return ErrorCode ERR_EXIF_MISSING when the image has no Exif item
+ */
+ErrorCode heif_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed);
+
+// **** JPEG XL **** //
+
+/**
+ * @brief heif_scan_boxes for JPEG XL, stops at the Exif box instead of meta.
+ * An Exif box compressed into a brob box is not recognised.
+ *
+ * @param buffer
+ * @param length
+ * @param offset see heif_scan_boxes
+ * @param exif_offset set to where the Exif payload starts in buffer
+ * @param exif_length set to the bytes of Exif payload, which may run past length
+ * @return ErrorCode same as heif_scan_boxes
+ */
+ErrorCode jxl_scan_boxes(const uint8_t *buffer, size_t length, size_t *offset, size_t *exif_offset, size_t *exif_length);
+
+/**
+ * @brief ExifLocator for JPEG XL, same contract as jpeg_find_exif. The Exif
+ * box payload has the layout of a HEIF Exif item, see heif_exif_payload.
+ *
+ * @param buffer starts at the signature box
+ * @param length
+ * @param tiff_offset set to where the TIFF header starts
+ * @param tiff_length set to the bytes of TIFF data
+ * @param needed may be NULL, set to the prefix length to read next when
+ * ERR_TRUNCATED or ERR_TIFF_OVERFLOW
+ * @return ErrorCode ERR_EXIF_MISSING for a bare codestream or a container
+ * without an Exif box
+ */
+ErrorCode jxl_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed);
+
+#endif // HEIF_BOXES_H
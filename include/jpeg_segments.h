@@ -0,0 +1,127 @@
+/*
+ * @file            include/jpeg_segments.h
+ * @description     One pass over the JPEG markers that validates them and records every segment
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 18:02:11
+ * @lastModified    2026-10-17 18:02:11
+ */
+
+#ifndef JPEG_SEGMENTS_H
+#define JPEG_SEGMENTS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+
+// Segments kept in the table. Headers rarely hold more than a few dozen,
+// past this they are still walked and validated but no longer recorded.
+#define JPEG_MAX_SEGMENTS 64
+
+// **** Segment Table **** //
+
+typedef struct {
+  uint8_t marker;         // Second marker byte, 0xE1 for APP1
+  uint16_t length;        // Length field, counts itself, 0 for markers without one
+  uint32_t offset;        // Of the 0xFF that starts the marker, the payload is at offset + 4
+} JpegSegment;
+
+// Every segment from SOI up to and including SOS, in file order
+typedef struct {
+  JpegSegment segments[JPEG_MAX_SEGMENTS];
+  size_t count;           // Segments recorded
+  size_t total;           // Segments walked, more than count once the table is full
+  size_t scan;            // Where the entropy coded data starts, 0 until SOS has been read
+  size_t garbage;         // Bytes between segments that were not a marker
+  bool frame;             // A SOFn header came before SOS
+  bool exif;              // An APP1 Exif segment was found, see tiff_offset
+  size_t tiff_offset;     // Where the TIFF header of the first APP1 Exif segment starts
+  size_t tiff_length;     // Bytes of TIFF data in that segment
+} JpegIndex;
+
+/**
+ * @brief Walks the markers from SOI to SOS once, checking every length, and
+ * records each segment. The table is filled as far as the walk got even
+ * when it fails, so a truncated prefix still reports the segments it holds.
+ *
+ * @param buffer
+ * @param length
+ * @param index caller owned
+ * @param needed may be NULL, set to the prefix length to read next when
+ * ERR_TRUNCATED
+ * @return ErrorCode ERR_OK once a frame header and a complete SOS header
+ * were read without stray bytes, ERR_TRUNCATED when the buffer ends first,
+ * ERR_JPEG_INVALID otherwise
+ */
+ErrorCode jpeg_index_build(const uint8_t *buffer, size_t length, JpegIndex *index, size_t *needed);
+
+/**
+ * @brief The verdict of jpeg_index_build from a table that is already built,
+ * for callers that walked with jpeg_index_locate
+ *
+ * @param index
+ * @return bool true once the walk reached SOS past a frame header without
+ * stray bytes
+ */
+bool jpeg_index_valid(const JpegIndex *index);
+
+/**
+ * @brief jpeg_find_exif that walks on to SOS and keeps the segment table, so
+ * one walk serves the parse, jpeg_index_valid and the APP segment readers
+ *
+ * @param buffer
+ * @param length
+ * @param index caller owned, filled as far as the walk got
+ * @param tiff_offset set to where the TIFF header starts in buffer
+ * @param tiff_length set to the bytes of TIFF data in the segment
+ * @return ErrorCode same as jpeg_find_exif, the Exif segment is used even
+ * when the file fails jpeg_index_valid
+ */
+ErrorCode jpeg_index_locate(const uint8_t *buffer, size_t length, JpegIndex *index, size_t *tiff_offset,
+                            size_t *tiff_length);
+
+/**
+ * @brief The APP1 Exif segment from a built table, without walking again
+ *
+ * @param index
+ * @param tiff_offset set to where the TIFF header starts in the buffer
+ * @param tiff_length set to the bytes of TIFF data in the segment
+ * @return ErrorCode ERR_EXIF_MISSING when the walk found none
+ */
+ErrorCode jpeg_index_exif(const JpegIndex *index, size_t *tiff_offset, size_t *tiff_length);
+
+/**
+ * @brief The first recorded segment with a marker, for APP segment readers
+ *
+ * @param index
+ * @param marker
+ * @return const JpegSegment* NULL when the table has none
+ */
+const JpegSegment *jpeg_index_find(const JpegIndex *index, uint8_t marker);
+
+// **** Parsing **** //
+
+/**
+ * @brief parse_jpeg with the Exif segment taken from a table built over the
+ * same buffer, so the markers are not walked a second time
+ *
+ * @param buffer
+ * @param length
+ * @param index from jpeg_index_build over buffer
+ * @return char* same contract as parse_jpeg
+ */
+char *parse_jpeg_indexed(const uint8_t *buffer, size_t length, const JpegIndex *index);
+
+/**
+ * @brief parse_jpeg that leaves the segment table of its walk in index, the
+ * entry point for JPEG in parse_image
+ *
+ * @param buffer
+ * @param length
+ * @param index caller owned, see jpeg_index_locate
+ * @return char* same contract as parse_jpeg
+ */
+char *parse_jpeg_keep_index(const uint8_t *buffer, size_t length, JpegIndex *index);
+
+#endif // JPEG_SEGMENTS_H
@@ -0,0 +1,175 @@
+/*
+ * @file            include/output_builder.h
+ * @description     Growable character buffer used to assemble parser output
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 09:12:40
+ * @lastModified    2026-10-17 00:31:14
+ */
+
+#ifndef OUTPUT_BUILDER_H
+#define OUTPUT_BUILDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// **** Output Builder **** //
+
+// Tracks its own length and capacity so appends never rescan the string.
+// A fixed builder writes into caller memory and never grows, once it runs
+// out of room it keeps counting len so the caller learns the size it needs.
+typedef struct {
+  char *data;   // Start of the buffer, always NUL terminated while valid
+  size_t len;   // Bytes written, excluding the NUL terminator
+  size_t cap;   // Bytes available in data, including the NUL terminator
+  bool failed;  // Set once an allocation fails or the buffer is released, all later writes are dropped
+  bool fixed;   // Backed by caller memory, writes past cap are only counted
+} OutputBuilder;
+
+/**
+ * @brief Allocates the initial buffer for the builder
+ *
+ * @param builder
+ * @param initial_cap starting capacity in bytes, grows geometrically after
+ * @return true on success, false when the allocation fails
+ */
+bool builder_init(OutputBuilder *builder, size_t initial_cap);
+
+/**
+ * @brief Wraps caller memory, the builder never allocates or grows it
+ *
+ * @param builder
+ * @param buffer caller owned memory, may be NULL when cap is 0
+ * @param cap size of buffer in bytes
+ */
+void builder_init_fixed(OutputBuilder *builder, char *buffer, size_t cap);
+
+/**
+ * @brief Bytes needed to hold everything written so far, NUL included
+ *
+ * @param builder
+ * @return size_t
+ */
+static inline size_t builder_needed(const OutputBuilder *builder) {
+  return builder->len + 1;
+}
+
+/**
+ * @brief True when a fixed builder ran out of room and dropped output
+ *
+ * @param builder
+ * @return bool
+ */
+static inline bool builder_overflowed(const OutputBuilder *builder) {
+  return builder_needed(builder) > builder->cap;
+}
+
+/**
+ * @brief Releases the buffer held by the builder. It takes no more writes
+ * until builder_init.
+ *
+ * @param builder
+ */
+void builder_free(OutputBuilder *builder);
+
+/**
+ * @brief Hands the buffer over to the caller, who must free it. The builder
+ * takes no more writes until builder_init.
+ *
+ * @param builder
+ * @return char* NUL terminated string, or NULL if any allocation failed
+ */
+char *builder_finish(OutputBuilder *builder);
+
+/**
+ * @brief Grows the buffer so that at least extra more bytes fit
+ *
+ * @param builder
+ * @param extra
+ * @return true when the bytes fit, false when the allocation fails or a
+ * fixed builder is out of room
+ */
+bool builder_grow(OutputBuilder *builder, size_t extra);
+
+// ** Number writers ** //
+
+// Decimal and hex formatting without going through printf. Each writes
+// straight into the buffer and returns the bytes it added, a fixed builder
+// that ran out of room still counts them. 0 once an allocation has failed.
+
+size_t builder_put_u32(OutputBuilder *builder, uint32_t value);
+size_t builder_put_i32(OutputBuilder *builder, int32_t value);
+
+/**
+ * @brief Writes a rational as "numerator/denominator", unquoted
+ *
+ * @param builder
+ * @param numerator
+ * @param denominator
+ * @return size_t bytes added
+ */
+size_t builder_put_rational(OutputBuilder *builder, uint32_t numerator, uint32_t denominator);
+size_t builder_put_srational(OutputBuilder *builder, int32_t numerator, int32_t denominator);
+
+/**
+ * @brief Writes a byte as 0x followed by two upper case hex digits
+ *
+ * @param builder
+ * @param value
+ * @return size_t bytes added, always 4 unless an allocation failed
+ */
+size_t builder_put_hex8(OutputBuilder *builder, uint8_t value);
+
+static inline size_t builder_put_u16(OutputBuilder *builder, uint16_t value) {
+  return builder_put_u32(builder, value);
+}
+
+// ** Inline writers ** //
+
+static inline bool builder_reserve(OutputBuilder *builder, size_t extra) {
+  if (builder->len + extra < builder->cap) {
+    return true;
+  }
+  return builder_grow(builder, extra);
+}
+
+static inline void builder_append(OutputBuilder *builder, const char *str, size_t len) {
+  if (!builder_reserve(builder, len)) {
+    if (builder->fixed) {
+      if (builder->len + 1 < builder->cap) {    // Keep the prefix that fits, like snprintf
+        size_t fit = builder->cap - builder->len - 1;
+        memcpy(builder->data + builder->len, str, fit);
+        builder->data[builder->cap - 1] = '\0';
+      }
+      builder->len += len;    // Keep counting so the caller learns the size
+    }
+    return;
+  }
+  memcpy(builder->data + builder->len, str, len);
+  builder->len += len;
+  builder->data[builder->len] = '\0';
+}
+
+static inline void builder_putc(OutputBuilder *builder, char c) {
+  if (!builder_reserve(builder, 1)) {
+    if (builder->fixed) {
+      builder->len++;
+    }
+    return;
+  }
+  builder->data[builder->len++] = c;
+  builder->data[builder->len] = '\0';
+}
+
+// Drops everything written after mark, used to undo a partially written entry
+static inline void builder_rewind(OutputBuilder *builder, size_t mark) {
+  if (mark < builder->len) {
+    builder->len = mark;
+    if (mark < builder->cap) {
+      builder->data[mark] = '\0';
+    }
+  }
+}
+
+#endif // OUTPUT_BUILDER_H
@@ -0,0 +1,79 @@
+/*
+ * @file            include/png_chunks.h
+ * @description     Finds the eXIf chunk of a PNG by skipping over the chunks before it
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 19:12:40
+ * @lastModified    2026-10-17 19:12:40
+ */
+
+#ifndef PNG_CHUNKS_H
+#define PNG_CHUNKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+
+#define PNG_SIGNATURE "\x89PNG\r\n\x1A\n"
+#define PNG_SIGNATURE_LENGTH 8
+
+// Length and type before the data, CRC after it
+#define PNG_CHUNK_HEADER 8
+#define PNG_CHUNK_CRC 4
+
+// **** Chunk Walk **** //
+
+/**
+ * @brief Jumps from chunk to chunk by their length fields until eXIf or IEND.
+ * No chunk data is read and no CRC is checked, so IDAT costs one length
+ * field per chunk however large the image is. Works on any window of the
+ * file that starts at a chunk, for readers that fetch the headers themselves.
+ *
+ * @param buffer
+ * @param length
+ * @param offset where the first chunk starts in buffer, set to where the walk
+ * stopped: the eXIf chunk, IEND, or the next chunk header, which may lie past
+ * length when a chunk was skipped
+ * @param tiff_offset set to where the eXIf data starts in buffer
+ * @param tiff_length set to the bytes of eXIf data, which may run past length
+ * @return ErrorCode ERR_TRUNCATED when the next chunk header is not in buffer,
+ * ERR_EXIF_MISSING at IEND or a corrupt chunk length
+ */
+ErrorCode png_scan_chunks(const uint8_t *buffer, size_t length, size_t *offset, size_t *tiff_offset, size_t *tiff_length);
+
+/**
+ * @brief ExifLocator for PNG, same contract as jpeg_find_exif
+ *
+ * @param buffer starts at the PNG signature
+ * @param length
+ * @param tiff_offset set to where the eXIf data starts
+ * @param tiff_length set to the bytes of eXIf data
+ * @param needed may be NULL, set to the prefix length to read next when
+ * ERR_TRUNCATED or ERR_TIFF_OVERFLOW, the latter covers the chunk CRC too
+ * @return ErrorCode ERR_EXIF_MISSING when the image has no eXIf chunk
+ */
+ErrorCode png_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed);
+
+/**
+ * @brief Checks the CRC of the eXIf chunk png_find_exif found. Not part of
+ * the walk, for callers that want to reject corrupt metadata.
+ *
+ * @param buffer
+ * @param length
+ * @param tiff_offset from png_find_exif
+ * @param tiff_length from png_find_exif
+ * @return ErrorCode ERR_CHECKSUM on a mismatch, ERR_TRUNCATED when the CRC
+ * is not in buffer
+ */
+ErrorCode png_check_exif(const uint8_t *buffer, size_t length, size_t tiff_offset, size_t tiff_length);
+
+/**
+ * @brief The CRC-32 of PNG chunks, over the chunk type and data
+ *
+ * @param data
+ * @param length
+ * @return uint32_t
+ */
+uint32_t png_crc(const uint8_t *data, size_t length);
+
+#endif // PNG_CHUNKS_H
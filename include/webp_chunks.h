@@ -0,0 +1,74 @@
+/*
+ * @file            include/webp_chunks.h
+ * @description     Finds the EXIF chunk of a WebP from the VP8X flags and the RIFF chunk sizes
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 20:03:55
+ * @lastModified    2026-10-17 20:03:55
+ */
+
+#ifndef WEBP_CHUNKS_H
+#define WEBP_CHUNKS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "exif_parser.h"
+
+// "RIFF", the file size and "WEBP"
+#define WEBP_HEADER_LENGTH 12
+
+// FourCC and size before the data, which is padded to an even length
+#define WEBP_CHUNK_HEADER 8
+
+// Bytes that hold the header, the VP8X chunk header and its flags
+#define WEBP_FLAGS_LENGTH (WEBP_HEADER_LENGTH + WEBP_CHUNK_HEADER + 1)
+
+// VP8X flag set when the file carries an EXIF chunk
+#define WEBP_FLAG_EXIF 0x08
+
+// **** Chunk Walk **** //
+
+/**
+ * @brief Reads the RIFF header and the VP8X flags. Simple lossy and lossless
+ * files start with VP8 or VP8L and cannot hold EXIF, extended files say in
+ * their flags whether they do, so no chunk is walked to find out.
+ *
+ * @param buffer
+ * @param length at least WEBP_FLAGS_LENGTH
+ * @param riff_end set to where the RIFF data ends, may be NULL
+ * @return ErrorCode ERR_OK when the flags announce an EXIF chunk,
+ * ERR_TRUNCATED when length is too short to tell, ERR_EXIF_MISSING otherwise
+ */
+ErrorCode webp_has_exif(const uint8_t *buffer, size_t length, size_t *riff_end);
+
+/**
+ * @brief Jumps from chunk to chunk by their sizes until the EXIF chunk. The
+ * bitstream and every other chunk is skipped unread. Works on any window of
+ * the file that starts at a chunk, see png_scan_chunks.
+ *
+ * @param buffer
+ * @param length
+ * @param offset where the first chunk starts in buffer, set to where the walk
+ * stopped: the EXIF chunk or the next chunk header, which may lie past length
+ * @param tiff_offset set to where the TIFF header starts in buffer, past an
+ * "Exif\0\0" prefix some writers add
+ * @param tiff_length set to the bytes of TIFF data, which may run past length
+ * @return ErrorCode ERR_TRUNCATED when the next chunk header is not in buffer
+ */
+ErrorCode webp_scan_chunks(const uint8_t *buffer, size_t length, size_t *offset, size_t *tiff_offset, size_t *tiff_length);
+
+/**
+ * @brief ExifLocator for WebP, same contract as jpeg_find_exif. Returns at
+ * once when the VP8X flags rule out EXIF.
+ *
+ * @param buffer starts at "RIFF"
+ * @param length
+ * @param tiff_offset set to where the TIFF header starts
+ * @param tiff_length set to the bytes of TIFF data
+ * @param needed may be NULL, set to the prefix length to read next when
+ * ERR_TRUNCATED or ERR_TIFF_OVERFLOW
+ * @return ErrorCode ERR_EXIF_MISSING when the image has no EXIF chunk
+ */
+ErrorCode webp_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed);
+
+#endif // WEBP_CHUNKS_H
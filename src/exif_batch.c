@@ -0,0 +1,229 @@
+/*
+ * @file            src/exif_batch.c
+ * @description     Parses many files at once on a pool of worker threads
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 12:03:51
+ * @lastModified    2026-10-17 00:17:50
+ */
+
+#define _POSIX_C_SOURCE 200809L                                         // sysconf, posix_fadvise
+
+#include "exif_batch.h"
+#include "exif_io.h"
+#include "exif_parser.h"
+#include "exif_uring.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// ** Scheduler state ** //
+
+// A contiguous slice of the path list. The owner takes from head, thieves
+// take the back half, both under lock. Padded so deques of neighbouring
+// workers do not share a cache line.
+typedef struct {
+    pthread_mutex_t lock;
+    size_t head;                                                        // Next index the owner parses
+    size_t tail;                                                        // One past the last index in the slice
+    char pad[64];
+} WorkDeque;
+
+typedef struct {
+    const char *const *paths;
+    const ExifBatchOptions *options;
+    ExifBatchCallback callback;
+    void *user;
+    WorkDeque *deques;
+    unsigned workers;
+} BatchPool;
+
+typedef struct {
+    BatchPool *pool;
+    unsigned id;
+} Worker;
+
+// **** HELPERS **** //
+
+// Opens a path and asks the kernel to start reading its first window
+static int open_advised(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, EXIF_READ_WINDOW, POSIX_FADV_WILLNEED);
+    }
+    return fd;
+}
+
+// Parses one path, fd is the path opened by open_advised and unused with mmap
+static void parse_one(const BatchPool *pool, size_t index, int fd) {
+    const char *path = pool->paths[index];
+    char *json = NULL;
+    ErrorCode status = ERR_IO;
+
+    if (pool->options->use_mmap) {
+        status = exif_json_mmap(path, &json);
+    } else if (fd >= 0) {
+        status = exif_json_fd(fd, &json);
+        close(fd);
+    }
+
+    pool->callback(index, path, status, json, pool->user);
+}
+
+// Takes the next index and peeks at the one after it, which is the owner's
+// next path unless a thief takes it first
+static bool pop_own(WorkDeque *deque, size_t *index, size_t *upcoming) {
+    bool found = false;
+
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *index = deque->head++;
+        *upcoming = (deque->head < deque->tail) ? deque->head : SIZE_MAX;
+        found = true;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+// Moves the back half of a victim's slice into the thief's own deque
+static bool steal(BatchPool *pool, unsigned thief) {
+
+    for (unsigned step = 1; step < pool->workers; step++) {            // Visit the others once, starting next door
+        WorkDeque *victim = &pool->deques[(thief + step) % pool->workers];
+        size_t head = 0;
+        size_t tail = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail) {
+            size_t left = victim->tail - victim->head;
+            head = victim->tail - (left + 1) / 2;                       // Take the larger half, at least one path
+            tail = victim->tail;
+            victim->tail = head;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (head < tail) {
+            WorkDeque *own = &pool->deques[thief];
+            pthread_mutex_lock(&own->lock);
+            own->head = head;
+            own->tail = tail;
+            pthread_mutex_unlock(&own->lock);
+            return true;
+        }
+    }
+    return false;                                                       // Nothing left anywhere, the batch is drained
+}
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    BatchPool *pool = worker->pool;
+    bool prefetch = !pool->options->use_mmap;
+    size_t index = 0;
+    size_t upcoming = SIZE_MAX;
+    size_t ahead = SIZE_MAX;                                            // Path opened early while the previous one parsed
+    int ahead_fd = -1;
+
+    for (;;) {
+        while (pop_own(&pool->deques[worker->id], &index, &upcoming)) {
+            int fd = -1;
+            if (index == ahead) {
+                fd = ahead_fd;
+            } else if (ahead_fd >= 0) {                                 // Stolen before we got to it
+                close(ahead_fd);
+            }
+            ahead = SIZE_MAX;
+            ahead_fd = -1;
+
+            if (prefetch) {
+                if (fd < 0) {
+                    fd = open_advised(pool->paths[index]);
+                }
+                if (upcoming != SIZE_MAX) {                             // Let the next read overlap this parse
+                    ahead = upcoming;
+                    ahead_fd = open_advised(pool->paths[upcoming]);
+                }
+            }
+            parse_one(pool, index, fd);
+        }
+        if (ahead_fd >= 0) {
+            close(ahead_fd);
+            ahead = SIZE_MAX;
+            ahead_fd = -1;
+        }
+        if (!steal(pool, worker->id)) {
+            return NULL;
+        }
+    }
+}
+
+// **** BATCH EXTRACTION **** //
+
+ErrorCode exif_parse_batch(const char *const *paths, size_t count, const ExifBatchOptions *options, ExifBatchCallback callback, void *user) {
+
+    ExifBatchOptions defaults = { 0, false, false, 0 };
+    if (options == NULL) {
+        options = &defaults;
+    }
+    if (count == 0) {
+        return ERR_OK;
+    }
+
+    if (options->use_uring && !options->use_mmap) {
+        ErrorCode status = exif_uring_batch(paths, count, options->queue_depth, callback, user);
+        if (status != ERR_IO) {                                         // ERR_IO means no ring, use the pool instead
+            return status;
+        }
+    }
+
+    unsigned workers = options->threads;
+    if (workers == 0) {                                                 // One worker per online CPU
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = (cpus > 0) ? (unsigned)cpus : 1;
+    }
+    if (workers > count) {
+        workers = (unsigned)count;
+    }
+
+    BatchPool pool = { paths, options, callback, user, NULL, workers };
+    pool.deques = calloc(workers, sizeof(WorkDeque));
+    Worker *states = calloc(workers, sizeof(Worker));
+    pthread_t *threads = calloc(workers, sizeof(pthread_t));
+    if (pool.deques == NULL || states == NULL || threads == NULL) {
+        free(pool.deques);
+        free(states);
+        free(threads);
+        return ERR_MALLOC;
+    }
+
+    for (unsigned w = 0; w < workers; w++) {                            // Deal the list out in equal slices
+        pthread_mutex_init(&pool.deques[w].lock, NULL);
+        pool.deques[w].head = count * w / workers;
+        pool.deques[w].tail = count * (w + 1) / workers;
+        states[w].pool = &pool;
+        states[w].id = w;
+    }
+
+    unsigned started = 1;                                               // Worker 0 runs on the calling thread
+    for (unsigned w = 1; w < workers; w++) {
+        if (pthread_create(&threads[w], NULL, worker_main, &states[w]) != 0) {
+            break;                                                      // Fewer threads is fine, the rest gets stolen
+        }
+        started++;
+    }
+    worker_main(&states[0]);
+
+    for (unsigned w = 1; w < started; w++) {
+        pthread_join(threads[w], NULL);
+    }
+
+    for (unsigned w = 0; w < workers; w++) {
+        pthread_mutex_destroy(&pool.deques[w].lock);
+    }
+    free(pool.deques);
+    free(states);
+    free(threads);
+    return ERR_OK;
+}
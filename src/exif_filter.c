@@ -0,0 +1,367 @@
+/*
+ * @file            src/exif_filter.c
+ * @description     Filters over EXIF tags that are evaluated while the IFDs are walked
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 16:21:48
+ * @lastModified    2026-10-17 16:21:48
+ */
+
+#include "exif_filter.h"
+#include "exif_parser.h"
+#include "output_builder.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Three valued results, a leaf stays unknown until its tag has been seen
+#define FILTER_UNKNOWN (-1)
+#define FILTER_FALSE 0
+#define FILTER_TRUE 1
+
+// Evaluation state for one image
+typedef struct {
+    const ExifFilter *filter;
+    int8_t leaves[EXIF_FILTER_MAX_NODES];                               // Leaf results, ignored for AND and OR
+} FilterState;
+
+// **** BUILDERS **** //
+
+void exif_filter_init(ExifFilter *filter) {
+    filter->count = 0;
+    filter->invalid = false;
+    exif_tagset_clear(&filter->tags);
+}
+
+// Takes the next free node, or marks the filter invalid when it is full
+static ExifFilterNode *add_node(ExifFilter *filter, ExifNodeKind kind) {
+    if (filter->count >= EXIF_FILTER_MAX_NODES) {
+        filter->invalid = true;
+        return NULL;
+    }
+    ExifFilterNode *node = &filter->nodes[filter->count];
+    memset(node, 0, sizeof(*node));
+    node->kind = (uint8_t)kind;
+    return node;
+}
+
+static int add_leaf(ExifFilter *filter, ExifNodeKind kind, uint16_t tag, ExifCompare compare) {
+    if ((unsigned)compare > EXIF_CMP_GE || !exif_tagset_add(&filter->tags, tag)) {
+        filter->invalid = true;
+        return -1;
+    }
+    ExifFilterNode *node = add_node(filter, kind);
+    if (node == NULL) {
+        return -1;
+    }
+    node->tag = tag;
+    node->compare = (uint8_t)compare;
+    return (int)filter->count++;
+}
+
+int exif_filter_number(ExifFilter *filter, uint16_t tag, ExifCompare compare, double number) {
+    int index = add_leaf(filter, EXIF_NODE_NUMBER, tag, compare);
+    if (index >= 0) {
+        filter->nodes[index].number = number;
+    }
+    return index;
+}
+
+int exif_filter_text(ExifFilter *filter, uint16_t tag, ExifCompare compare, const char *text) {
+    size_t len = strlen(text);
+    if (len > EXIF_FILTER_MAX_TEXT) {
+        filter->invalid = true;
+        return -1;
+    }
+
+    int index = add_leaf(filter, EXIF_NODE_TEXT, tag, compare);
+    if (index >= 0) {
+        memcpy(filter->nodes[index].text, text, len);
+        filter->nodes[index].text_len = (uint8_t)len;
+    }
+    return index;
+}
+
+static int add_branch(ExifFilter *filter, ExifNodeKind kind, int left, int right) {
+    if (left < 0 || right < 0 || (size_t)left >= filter->count || (size_t)right >= filter->count) {
+        filter->invalid = true;
+        return -1;
+    }
+    ExifFilterNode *node = add_node(filter, kind);
+    if (node == NULL) {
+        return -1;
+    }
+    node->left = (int16_t)left;
+    node->right = (int16_t)right;
+    return (int)filter->count++;
+}
+
+int exif_filter_and(ExifFilter *filter, int left, int right) {
+    return add_branch(filter, EXIF_NODE_AND, left, right);
+}
+
+int exif_filter_or(ExifFilter *filter, int left, int right) {
+    return add_branch(filter, EXIF_NODE_OR, left, right);
+}
+
+// **** LEAVES **** //
+
+static bool compare_holds(int order, uint8_t compare) {
+    switch (compare) {
+        case EXIF_CMP_EQ:
+            return order == 0;
+        case EXIF_CMP_NE:
+            return order != 0;
+        case EXIF_CMP_LT:
+            return order < 0;
+        case EXIF_CMP_LE:
+            return order <= 0;
+        case EXIF_CMP_GT:
+            return order > 0;
+        default:                                                        // EXIF_CMP_GE
+            return order >= 0;
+    }
+}
+
+// The value a numeric leaf compares, false when the entry has none
+static bool entry_number(const ExifEntry *entry, double *number) {
+    if (entry->count == 0) {
+        return false;
+    }
+
+    switch (entry->type) {
+        case EXIF_TYPE_BYTE:
+        case EXIF_TYPE_SHORT:
+        case EXIF_TYPE_LONG:
+            *number = entry->value.u;
+            return true;
+        case EXIF_TYPE_SBYTE:
+        case EXIF_TYPE_SSHORT:
+        case EXIF_TYPE_SLONG:
+            *number = entry->value.i;
+            return true;
+        case EXIF_TYPE_RATIONAL:
+            if (entry->value.rational.denominator == 0) {
+                return false;
+            }
+            *number = (double)entry->value.rational.numerator / entry->value.rational.denominator;
+            return true;
+        case EXIF_TYPE_SRATIONAL:
+            if (entry->value.srational.denominator == 0) {
+                return false;
+            }
+            *number = (double)entry->value.srational.numerator / entry->value.srational.denominator;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool test_leaf(const ExifFilterNode *node, const ExifEntry *entry) {
+
+    if (node->kind == EXIF_NODE_NUMBER) {
+        double number = 0.0;
+        if (!entry_number(entry, &number)) {
+            return false;
+        }
+        return compare_holds((number > node->number) - (number < node->number), node->compare);
+    }
+
+    if (entry->type != EXIF_TYPE_ASCII) {
+        return false;
+    }
+
+    size_t len = 0;                                                     // Up to the NUL, without the trailing padding
+    while (len < entry->count && entry->data[len] != '\0') {
+        len++;
+    }
+    while (len > 0 && entry->data[len - 1] == ' ') {
+        len--;
+    }
+
+    size_t common = (len < node->text_len) ? len : node->text_len;
+    int order = memcmp(entry->data, node->text, common);
+    if (order == 0) {
+        order = (len > node->text_len) - (len < node->text_len);
+    }
+    return compare_holds(order, node->compare);
+}
+
+// **** EVALUATION **** //
+
+// Children come before their parents, so one pass in node order evaluates
+// the whole tree. AND is decided by one false child, OR by one true child.
+static int evaluate(const FilterState *state) {
+    const ExifFilter *filter = state->filter;
+    int8_t results[EXIF_FILTER_MAX_NODES];
+
+    for (size_t i = 0; i < filter->count; i++) {
+        const ExifFilterNode *node = &filter->nodes[i];
+        if (node->kind != EXIF_NODE_AND && node->kind != EXIF_NODE_OR) {
+            results[i] = state->leaves[i];
+            continue;
+        }
+
+        int8_t left = results[node->left];
+        int8_t right = results[node->right];
+        if (node->kind == EXIF_NODE_AND) {
+            results[i] = (left == FILTER_FALSE || right == FILTER_FALSE) ? FILTER_FALSE
+                       : (left == FILTER_TRUE && right == FILTER_TRUE) ? FILTER_TRUE : FILTER_UNKNOWN;
+        } else {
+            results[i] = (left == FILTER_TRUE || right == FILTER_TRUE) ? FILTER_TRUE
+                       : (left == FILTER_FALSE && right == FILTER_FALSE) ? FILTER_FALSE : FILTER_UNKNOWN;
+        }
+    }
+    return results[filter->count - 1];
+}
+
+// Tests every leaf that reads the entry's tag, ERR_FILTERED once that
+// decides the filter false
+static ErrorCode update_leaves(FilterState *state, const ExifEntry *entry) {
+    const ExifFilter *filter = state->filter;
+    bool touched = false;
+
+    for (size_t i = 0; i < filter->count; i++) {                        // Every leaf that reads this tag
+        const ExifFilterNode *node = &filter->nodes[i];
+        if ((node->kind == EXIF_NODE_NUMBER || node->kind == EXIF_NODE_TEXT) && node->tag == entry->tag) {
+            state->leaves[i] = test_leaf(node, entry) ? FILTER_TRUE : FILTER_FALSE;
+            touched = true;
+        }
+    }
+
+    if (touched && evaluate(state) == FILTER_FALSE) {                   // Decided, stop the walk here
+        return ERR_FILTERED;
+    }
+    return ERR_OK;
+}
+
+// The final result once the walk is over, tags the image does not have
+// make their comparisons false
+static bool filter_holds(FilterState *state) {
+    for (size_t i = 0; i < state->filter->count; i++) {
+        if (state->leaves[i] == FILTER_UNKNOWN) {
+            state->leaves[i] = FILTER_FALSE;
+        }
+    }
+    return evaluate(state) == FILTER_TRUE;
+}
+
+static ErrorCode filter_visit(const ExifEntry *entry, void *ctx) {
+    return update_leaves(ctx, entry);
+}
+
+// Filters and collects in the same walk for parse_jpeg_where. Entries are
+// only kept, formatting waits until the filter has matched.
+typedef struct {
+    FilterState state;
+    const ExifTagSet *tags;                                             // Output selection, NULL for every tag
+    ExifEntry *entries;
+    size_t count;
+    size_t capacity;
+} FilterCollector;
+
+static ErrorCode filter_collect_visit(const ExifEntry *entry, void *ctx) {
+    FilterCollector *collector = ctx;
+
+    if (exif_tagset_has_in(&collector->state.filter->tags, (ExifIfd)entry->ifd, entry->tag) &&
+        update_leaves(&collector->state, entry) != ERR_OK) {
+        return ERR_FILTERED;
+    }
+    if (collector->tags != NULL && !exif_tagset_has_in(collector->tags, (ExifIfd)entry->ifd, entry->tag)) {
+        return ERR_OK;                                                  // Walked for the filter only
+    }
+
+    if (collector->count == collector->capacity) {                      // Grow by doubling, entries point into the image
+        size_t capacity = collector->capacity ? collector->capacity * 2 : 32;
+        ExifEntry *temp = realloc(collector->entries, capacity * sizeof(ExifEntry));
+        if (temp == NULL) {
+            return ERR_MALLOC;
+        }
+        collector->entries = temp;
+        collector->capacity = capacity;
+    }
+    collector->entries[collector->count++] = *entry;
+    return ERR_OK;
+}
+
+ErrorCode exif_filter_match(const ExifFilter *filter, const uint8_t *buffer, size_t length) {
+
+    if (filter->invalid || filter->count == 0) {
+        return ERR_INVALID_TAG;
+    }
+
+    FilterState state;
+    state.filter = filter;
+    memset(state.leaves, FILTER_UNKNOWN, sizeof(state.leaves));
+
+    ErrorCode status = exif_visit_entries(buffer, length, &filter->tags, filter_visit, &state);
+    if (status != ERR_OK) {
+        return status;
+    }
+    return filter_holds(&state) ? ERR_OK : ERR_FILTERED;
+}
+
+ErrorCode parse_jpeg_where(const ExifFilter *filter, const uint8_t *buffer, size_t length, const ExifTagSet *tags,
+                           char **json) {
+
+    *json = NULL;
+    if (filter->invalid || filter->count == 0) {
+        return ERR_INVALID_TAG;
+    }
+
+    ExifTagSet walk;                                                    // The output tags and the ones the filter reads
+    const ExifTagSet *walk_tags = NULL;                                 // Every tag already covers the filter's
+    if (tags != NULL) {
+        walk = *tags;
+        for (size_t i = 0; i < filter->count; i++) {
+            const ExifFilterNode *node = &filter->nodes[i];
+            if (node->kind == EXIF_NODE_NUMBER || node->kind == EXIF_NODE_TEXT) {
+                exif_tagset_add(&walk, node->tag);
+            }
+        }
+        walk.ifds |= filter->tags.ifds;
+        walk_tags = &walk;
+    }
+
+    FilterCollector collector;
+    collector.state.filter = filter;
+    memset(collector.state.leaves, FILTER_UNKNOWN, sizeof(collector.state.leaves));
+    collector.tags = tags;
+    collector.entries = NULL;
+    collector.count = 0;
+    collector.capacity = 0;
+
+    ErrorCode status = exif_visit_entries(buffer, length, walk_tags, filter_collect_visit, &collector);
+    if (status == ERR_OK && !filter_holds(&collector.state)) {          // Rejected once the last tag was seen
+        status = ERR_FILTERED;
+    }
+
+    OutputBuilder output;                                               // Only matching images get this far
+    if (status == ERR_OK && !builder_init(&output, 512)) {
+        status = ERR_MALLOC;
+    }
+    if (status != ERR_OK) {
+        free(collector.entries);
+        return status;
+    }
+
+    size_t written = 0;
+    builder_putc(&output, '{');
+    for (size_t i = 0; i < collector.count && status == ERR_OK; i++) {
+        status = exif_entry_to_builder(&collector.entries[i], &output, &written);
+    }
+    builder_putc(&output, '}');
+    free(collector.entries);
+
+    if (status == ERR_OK && output.failed) {
+        status = ERR_MALLOC;
+    }
+    if (status != ERR_OK) {
+        builder_free(&output);
+        return status;
+    }
+
+    *json = builder_finish(&output);
+    return (*json != NULL) ? ERR_OK : ERR_MALLOC;
+}
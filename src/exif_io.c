@@ -0,0 +1,656 @@
+/*
+ * @file            src/exif_io.c
+ * @description     Reads just enough of an image file to parse its EXIF
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 10:41:07
+ * @lastModified    2026-10-17 00:44:01
+ */
+
+#define _POSIX_C_SOURCE 200809L                                         // pread, posix_madvise
+
+#include "exif_io.h"
+#include "exif_parser.h"
+#include "exif_swap.h"
+#include "format_reader.h"
+#include "heif_boxes.h"
+#include "png_chunks.h"
+#include "webp_chunks.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// **** HELPERS **** //
+
+// Reads up to length bytes at offset, retrying short reads. Returns the bytes
+// read, which is only less than length at end of file, or -1 on error.
+static ssize_t pread_full(int fd, uint8_t *buffer, size_t length, off_t offset) {
+    size_t done = 0;
+
+    while (done < length) {
+        ssize_t got = pread(fd, buffer + done, length - done, offset + (off_t)done);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (got == 0) {                                                 // End of file
+            break;
+        }
+        done += (size_t)got;
+    }
+    return (ssize_t)done;
+}
+
+// Same contract as png_scan_chunks and webp_scan_chunks
+typedef ErrorCode (*ChunkScanner)(const uint8_t *buffer, size_t length, size_t *offset, size_t *tiff_offset,
+                                  size_t *tiff_length);
+
+// Writes the JSON into a fresh builder and hands it over only on success,
+// so no caller sees the messages parse_jpeg returns for its errors
+static ErrorCode build_json(ErrorCode (*parse)(const uint8_t *, size_t, const ExifTagSet *, OutputBuilder *),
+                            const uint8_t *data, size_t length, char **json) {
+    OutputBuilder output;
+
+    if (!builder_init(&output, 512)) {
+        return ERR_MALLOC;
+    }
+
+    ErrorCode status = parse(data, length, NULL, &output);
+    if (status != ERR_OK) {
+        builder_free(&output);
+        return status;
+    }
+
+    *json = builder_finish(&output);
+    return (*json != NULL) ? ERR_OK : ERR_MALLOC;
+}
+
+// **** FILE READERS **** //
+
+ErrorCode exif_prefix_step(const uint8_t *data, size_t have, size_t window, size_t file_size, size_t *next_window,
+                           size_t *tiff_offset, size_t *tiff_length) {
+
+    size_t needed = 0;
+    bool at_eof = have < window || have == file_size;
+    ErrorCode status = jpeg_find_exif(data, have, tiff_offset, tiff_length, &needed);
+
+    *next_window = 0;
+    if (status == ERR_OK || (status != ERR_TRUNCATED && status != ERR_TIFF_OVERFLOW) || at_eof) {
+        return status;
+    }
+
+    if (status == ERR_TRUNCATED) {                                      // Still walking, read ahead past the next marker too
+        needed += EXIF_READ_WINDOW;
+    }
+    *next_window = (needed < file_size) ? needed : file_size;           // APP1 is read up to its declared length only
+    return ERR_TRUNCATED;
+}
+
+// exif_read_prefix that also hands back where the TIFF block is, as the walk
+// that found the end of the prefix located it
+static ErrorCode read_prefix(int fd, uint8_t **buffer, size_t *length, size_t *tiff_offset, size_t *tiff_length) {
+
+    struct stat st;
+    size_t file_size = SIZE_MAX;                                        // Size unknown, a short read marks the end
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        file_size = (size_t)st.st_size;
+    }
+
+    size_t window = (file_size < EXIF_READ_WINDOW) ? file_size : EXIF_READ_WINDOW;
+    size_t have = 0;                                                    // Bytes of the prefix read so far
+    uint8_t *data = NULL;
+
+    for (;;) {
+        uint8_t *temp = realloc(data, window ? window : 1);             // Grow the prefix to the new window
+        if (temp == NULL) {
+            free(data);
+            return ERR_MALLOC;
+        }
+        data = temp;
+
+        ssize_t got = pread_full(fd, data + have, window - have, (off_t)have);
+        if (got < 0) {
+            free(data);
+            return ERR_IO;
+        }
+        have += (size_t)got;
+
+        ErrorCode status = exif_prefix_step(data, have, window, file_size, &window, tiff_offset, tiff_length);
+        if (status != ERR_TRUNCATED || window == 0) {                   // Done, with the prefix or with an error
+            if (status == ERR_OK) {
+                *buffer = data;
+                *length = have;
+            } else {
+                free(data);
+            }
+            return status;
+        }
+    }
+}
+
+ErrorCode exif_read_prefix(int fd, uint8_t **buffer, size_t *length) {
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+    return read_prefix(fd, buffer, length, &tiff_offset, &tiff_length);
+}
+
+// The JPEG reader in the shape of the container readers, so the markers are
+// walked once rather than again by the parse
+static ErrorCode read_jpeg(int fd, uint8_t **tiff, size_t *length) {
+    uint8_t *prefix = NULL;
+    size_t prefix_length = 0;
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+
+    ErrorCode status = read_prefix(fd, &prefix, &prefix_length, &tiff_offset, &tiff_length);
+    if (status != ERR_OK) {
+        return status;
+    }
+
+    memmove(prefix, prefix + tiff_offset, tiff_length);                 // Drop the markers ahead of the TIFF header
+    *tiff = prefix;
+    *length = tiff_length;
+    return ERR_OK;
+}
+
+// Walks the chunks of a PNG or WebP from offset in a window read at file
+// offset 0, refilling the window at each header that does not fit in it,
+// then reads the data of the chunk the scanner stopped at. Nothing past
+// end, the end of the container data, is looked at.
+static ErrorCode read_chunk_data(int fd, ChunkScanner scan, uint8_t *window, size_t got, size_t offset, size_t end,
+                                 uint8_t **tiff, size_t *length) {
+
+    size_t base = 0;                                                    // File offset of window[0]
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+
+    for (;;) {
+        ErrorCode status = scan(window, got, &offset, &tiff_offset, &tiff_length);
+        if (status == ERR_OK) {
+            break;
+        }
+        if (status != ERR_TRUNCATED || got < EXIF_CHUNK_WINDOW ||       // At the last chunk, or the file ended first
+            base + offset + 8 > end) {
+            return (status == ERR_TRUNCATED) ? ERR_EXIF_MISSING : status;
+        }
+
+        base += offset;                                                 // Seek to the next header, past any image data
+        offset = 0;
+        ssize_t read = pread_full(fd, window, EXIF_CHUNK_WINDOW, (off_t)base);
+        if (read < 0) {
+            return ERR_IO;
+        }
+        got = (size_t)read;
+    }
+
+    uint8_t *data = malloc(tiff_length ? tiff_length : 1);
+    if (data == NULL) {
+        return ERR_MALLOC;
+    }
+
+    size_t held = (got > tiff_offset) ? got - tiff_offset : 0;
+    if (held > tiff_length) {
+        held = tiff_length;
+    }
+    memcpy(data, window + tiff_offset, held);                           // The start of the data is usually in the window
+
+    if (held < tiff_length) {
+        ssize_t rest = pread_full(fd, data + held, tiff_length - held, (off_t)(base + tiff_offset + held));
+        if (rest < 0 || (size_t)rest < tiff_length - held) {
+            free(data);
+            return (rest < 0) ? ERR_IO : ERR_TIFF_OVERFLOW;
+        }
+    }
+
+    *tiff = data;
+    *length = tiff_length;
+    return ERR_OK;
+}
+
+ErrorCode exif_read_png(int fd, uint8_t **tiff, size_t *length) {
+
+    uint8_t window[EXIF_CHUNK_WINDOW];
+
+    ssize_t got = pread_full(fd, window, sizeof(window), 0);
+    if (got < 0) {
+        return ERR_IO;
+    }
+    if ((size_t)got < PNG_SIGNATURE_LENGTH || memcmp(window, PNG_SIGNATURE, PNG_SIGNATURE_LENGTH) != 0) {
+        return ERR_EXIF_MISSING;
+    }
+    return read_chunk_data(fd, png_scan_chunks, window, (size_t)got, PNG_SIGNATURE_LENGTH, SIZE_MAX, tiff, length);
+}
+
+ErrorCode exif_read_webp(int fd, uint8_t **tiff, size_t *length) {
+
+    uint8_t window[EXIF_CHUNK_WINDOW];
+    size_t riff_end = 0;
+
+    ssize_t got = pread_full(fd, window, sizeof(window), 0);
+    if (got < 0) {
+        return ERR_IO;
+    }
+
+    ErrorCode status = webp_has_exif(window, (size_t)got, &riff_end);  // One read decides most files
+    if (status != ERR_OK) {
+        return (status == ERR_TRUNCATED) ? ERR_EXIF_MISSING : status;
+    }
+    return read_chunk_data(fd, webp_scan_chunks, window, (size_t)got, WEBP_HEADER_LENGTH, riff_end, tiff, length);
+}
+
+ErrorCode exif_read_heif(int fd, uint8_t **tiff, size_t *length) {
+
+    uint8_t window[EXIF_CHUNK_WINDOW];
+    uint8_t *meta = NULL;
+    size_t meta_length = 0;
+    uint8_t *data = NULL;
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+    HeifItem item;
+
+    ssize_t got = pread_full(fd, window, sizeof(window), 0);
+    if (got < 0) {
+        return ERR_IO;
+    }
+    if ((size_t)got < HEIF_BOX_HEADER || memcmp(window + 4, "ftyp", 4) != 0) {
+        return ERR_EXIF_MISSING;
+    }
+
+    ErrorCode status = read_chunk_data(fd, heif_scan_boxes, window, (size_t)got, 0, SIZE_MAX, &meta, &meta_length);
+    if (status != ERR_OK) {                                             // Only the meta box has been read
+        return status;
+    }
+
+    status = heif_exif_item(meta, meta_length, &item);
+    if (status == ERR_OK) {
+        data = malloc(item.length ? (size_t)item.length : 1);
+        if (data == NULL) {
+            status = ERR_MALLOC;
+        } else if (item.in_meta) {                                      // Already read with meta
+            memcpy(data, meta + item.offset, (size_t)item.length);
+        } else {                                                        // One positioned read of the item, mdat is not touched otherwise
+            ssize_t read = pread_full(fd, data, (size_t)item.length, (off_t)item.offset);
+            if (read < 0 || (size_t)read < item.length) {
+                status = (read < 0) ? ERR_IO : ERR_TIFF_OVERFLOW;
+            }
+        }
+    }
+    free(meta);
+
+    if (status == ERR_OK) {
+        status = heif_exif_payload(data, (size_t)item.length, &tiff_offset, &tiff_length);
+    }
+    if (status != ERR_OK) {
+        free(data);
+        return status;
+    }
+
+    memmove(data, data + tiff_offset, tiff_length);                     // Drop the TIFF header offset and its prefix
+    *tiff = data;
+    *length = tiff_length;
+    return ERR_OK;
+}
+
+ErrorCode exif_read_jxl(int fd, uint8_t **tiff, size_t *length) {
+
+    uint8_t window[EXIF_CHUNK_WINDOW];
+    uint8_t *data = NULL;
+    size_t exif_length = 0;
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+
+    ssize_t got = pread_full(fd, window, sizeof(window), 0);
+    if (got < 0) {
+        return ERR_IO;
+    }
+    if ((size_t)got < JXL_SIGNATURE_LENGTH || memcmp(window, JXL_SIGNATURE, JXL_SIGNATURE_LENGTH) != 0) {
+        return ERR_EXIF_MISSING;
+    }
+
+    ErrorCode status = read_chunk_data(fd, jxl_scan_boxes, window, (size_t)got, 0, SIZE_MAX, &data, &exif_length);
+    if (status == ERR_OK) {
+        status = heif_exif_payload(data, exif_length, &tiff_offset, &tiff_length);
+    }
+    if (status != ERR_OK) {
+        free(data);
+        return status;
+    }
+
+    memmove(data, data + tiff_offset, tiff_length);                     // Drop the TIFF header offset and its prefix
+    *tiff = data;
+    *length = tiff_length;
+    return ERR_OK;
+}
+
+#define TIFF_MAX_IFDS 16                                                // As the walk of the parse
+
+// Queues an IFD for exif_read_tiff unless it was queued before
+static void queue_tiff_ifd(uint32_t *links, uint8_t *kinds, size_t *tail, uint32_t offset, ExifIfd ifd) {
+    for (size_t i = 0; i < *tail; i++) {
+        if (links[i] == offset) {
+            return;
+        }
+    }
+    if (*tail < TIFF_MAX_IFDS) {
+        links[*tail] = offset;
+        kinds[(*tail)++] = (uint8_t)ifd;
+    }
+}
+
+// The TIFF block exif_read_tiff builds, sparse where the file holds no IFD
+// or value the parse reads
+typedef struct {
+    int fd;
+    uint8_t *data;
+    size_t size;                                                        // Up to the end of the last span read
+    size_t capacity;
+    size_t file_size;                                                   // SIZE_MAX when unknown
+    bool big_endian;
+} TiffBlock;
+
+// Reads length bytes at file offset into the block at the same offset,
+// zero filling the gap before it. The block ends where the last byte the file
+// held was read, so a span past the end of the file fails the bounds checks
+// of the parse exactly as it would in the whole file.
+static ErrorCode read_tiff_span(TiffBlock *block, size_t offset, size_t length) {
+
+    if (offset >= block->file_size) {
+        return ERR_OK;
+    }
+    if (length > block->file_size - offset) {                           // A bogus count never allocates past the file
+        length = block->file_size - offset;
+    }
+
+    if (offset + length > block->capacity) {
+        uint8_t *temp = realloc(block->data, offset + length);
+        if (temp == NULL) {
+            return ERR_MALLOC;
+        }
+        block->data = temp;
+        block->capacity = offset + length;
+    }
+    if (offset > block->size) {                                         // Nothing the parse reads lies in the gap
+        memset(block->data + block->size, 0, offset - block->size);
+    }
+
+    ssize_t got = pread_full(block->fd, block->data + offset, length, (off_t)offset);
+    if (got < 0) {
+        return ERR_IO;
+    }
+    if (offset + (size_t)got > block->size) {
+        block->size = offset + (size_t)got;
+    }
+    return ERR_OK;
+}
+
+// The value span of the field at pos that the parse decodes, false for
+// unknown tags and for values held in the field itself
+static bool tiff_value_span(const TiffBlock *block, size_t pos, ExifIfd ifd, size_t *offset, size_t *length) {
+
+    static const uint8_t type_sizes[13] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8 };  // As decode_field
+    uint16_t head[2];                                                   // Tag and type
+    uint32_t body[2];                                                   // Count and value offset
+
+    exif_load_u16(head, block->data + pos, 2, block->big_endian);
+    exif_load_u32(body, block->data + pos + 4, 2, block->big_endian);
+
+    uint8_t size = (head[1] < 13) ? type_sizes[head[1]] : 0;
+    if (size == 0 || exif_tag_key(ifd, head[0]) < 0 || body[0] > UINT32_MAX / size || body[0] * size <= 4) {
+        return false;
+    }
+    *offset = body[1];
+    *length = (size_t)body[0] * size;
+    return true;
+}
+
+// The IFD a pointer tag leads to, EXIF_IFD_0 for every other field. Same
+// rules as the walk of the parse.
+static ExifIfd tiff_pointer(const TiffBlock *block, size_t pos, ExifIfd ifd, uint32_t *target) {
+
+    uint16_t head[2];                                                   // Tag and type
+    uint32_t body[2];                                                   // Count and IFD offset
+
+    if (ifd == EXIF_IFD_GPS || ifd == EXIF_IFD_INTEROP) {
+        return EXIF_IFD_0;
+    }
+    exif_load_u16(head, block->data + pos, 2, block->big_endian);
+    exif_load_u32(body, block->data + pos + 4, 2, block->big_endian);
+
+    ExifIfd child = (head[0] == 0x8769) ? EXIF_IFD_EXIF
+                  : (head[0] == 0x8825) ? EXIF_IFD_GPS
+                  : (head[0] == 0xA005) ? EXIF_IFD_INTEROP
+                  : EXIF_IFD_0;
+    *target = body[1];
+    return (child != EXIF_IFD_0 && (head[1] == EXIF_TYPE_LONG || head[1] == 13) && body[0] >= 1) ? child : EXIF_IFD_0;
+}
+
+// Reads the IFD at offset, then the values its known tags point to, and
+// queues the IFDs it leads to
+static ErrorCode read_tiff_ifd(TiffBlock *block, size_t offset, ExifIfd ifd, uint32_t *links, uint8_t *kinds, size_t *tail) {
+
+    uint16_t entries = 0;
+    size_t low = SIZE_MAX;                                              // Range of the values of this IFD
+    size_t high = 0;
+    size_t value_offset = 0;
+    size_t value_length = 0;
+    uint32_t target = 0;
+
+    ErrorCode status = read_tiff_span(block, offset, 2);
+    if (status != ERR_OK || offset + 2 > block->size) {                 // The parse reports this, not the reader
+        return status;
+    }
+    exif_load_u16(&entries, block->data + offset, 1, block->big_endian);
+
+    size_t fields = offset + 2;
+    size_t fields_end = fields + 12 * (size_t)entries;
+    size_t table_end = fields_end + ((ifd == EXIF_IFD_0) ? 4 : 0);     // IFD0 ends with the offset of IFD1
+    status = read_tiff_span(block, fields, table_end - fields);
+    if (status != ERR_OK) {
+        return status;
+    }
+    if (fields_end > block->size) {                                     // Cut off by the end of the file
+        fields_end = fields + (block->size - fields) / 12 * 12;
+    }
+
+    for (size_t pos = fields; pos < fields_end; pos += 12) {
+        ExifIfd child = tiff_pointer(block, pos, ifd, &target);
+        if (child != EXIF_IFD_0) {
+            queue_tiff_ifd(links, kinds, tail, target, child);
+        } else if (tiff_value_span(block, pos, ifd, &value_offset, &value_length)) {
+            low = (value_offset < low) ? value_offset : low;
+            high = (value_offset + value_length > high) ? value_offset + value_length : high;
+        }
+    }
+
+    if (low < high && high - low <= EXIF_CHUNK_WINDOW) {                // Values packed after the table, one read
+        status = read_tiff_span(block, low, high - low);
+    } else if (low < high) {                                            // Spread out, only the referenced bytes
+        for (size_t pos = fields; status == ERR_OK && pos < fields_end; pos += 12) {
+            if (tiff_value_span(block, pos, ifd, &value_offset, &value_length)) {
+                status = read_tiff_span(block, value_offset, value_length);
+            }
+        }
+    }
+
+    if (status == ERR_OK && ifd == EXIF_IFD_0 && table_end <= block->size) {
+        exif_load_u32(&target, block->data + fields_end, 1, block->big_endian);
+        if (target != 0) {
+            queue_tiff_ifd(links, kinds, tail, target, EXIF_IFD_1);
+        }
+    }
+    return status;
+}
+
+ErrorCode exif_read_tiff(int fd, uint8_t **tiff, size_t *length) {
+
+    TiffBlock block = { fd, NULL, 0, 0, SIZE_MAX, false };
+    uint32_t links[TIFF_MAX_IFDS];                                      // IFD offsets in the order they were found
+    uint8_t kinds[TIFF_MAX_IFDS];                                       // The ExifIfd of each
+    uint32_t ifd0 = 0;
+    size_t tail = 0;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        block.file_size = (size_t)st.st_size;
+    }
+
+    ErrorCode status = read_tiff_span(&block, 0, 8);
+    if (status != ERR_OK || block.size < 8 || readImageFormat(block.data, block.size) != IMAGE_FORMAT_TIFF) {
+        free(block.data);
+        return (status != ERR_OK) ? status : ERR_EXIF_MISSING;
+    }
+
+    block.big_endian = block.data[0] == 'M';
+    exif_load_u32(&ifd0, block.data + 4, 1, block.big_endian);
+    queue_tiff_ifd(links, kinds, &tail, ifd0, EXIF_IFD_0);
+
+    for (size_t head = 0; status == ERR_OK && head < tail; head++) {   // Only the IFD chain and what it references
+        status = read_tiff_ifd(&block, links[head], (ExifIfd)kinds[head], links, kinds, &tail);
+    }
+
+    if (status != ERR_OK) {
+        free(block.data);
+        return status;
+    }
+    *tiff = block.data;
+    *length = block.size;
+    return ERR_OK;
+}
+
+ErrorCode exif_json_fd(int fd, char **json) {
+    uint8_t *tiff = NULL;
+    size_t length = 0;
+    uint8_t head[FORMAT_SNIFF_BYTES];
+
+    *json = NULL;
+    ssize_t got = pread_full(fd, head, sizeof(head), 0);
+    if (got < 0) {
+        return ERR_IO;
+    }
+
+    ErrorCode (*read_tiff)(int, uint8_t **, size_t *) = read_jpeg;     // Each reader hands back the bare TIFF block
+    switch (readImageFormat(head, (size_t)got)) {
+        case IMAGE_FORMAT_PNG:
+            read_tiff = exif_read_png;
+            break;
+        case IMAGE_FORMAT_WEBP:
+            read_tiff = exif_read_webp;
+            break;
+        case IMAGE_FORMAT_HEIC:
+        case IMAGE_FORMAT_AVIF:
+            read_tiff = exif_read_heif;
+            break;
+        case IMAGE_FORMAT_JXL:
+            read_tiff = exif_read_jxl;
+            break;
+        case IMAGE_FORMAT_TIFF:
+            read_tiff = exif_read_tiff;
+            break;
+        default:
+            break;
+    }
+
+    ErrorCode status = read_tiff(fd, &tiff, &length);
+    if (status == ERR_OK) {
+        status = exif_json_tiff(tiff, length, json);
+    }
+    free(tiff);
+    return status;
+}
+
+ErrorCode exif_json_tiff(const uint8_t *tiff, size_t length, char **json) {
+    *json = NULL;
+    return build_json(parse_tiff_to_builder, tiff, length, json);
+}
+
+char *exif_parse_fd(int fd) {
+    char *json = NULL;
+    exif_json_fd(fd, &json);
+    return json;
+}
+
+ErrorCode exif_thumbnail_fd(int fd, ExifThumbnail *thumbnail) {
+    uint8_t *prefix = NULL;
+    size_t length = 0;
+
+    ErrorCode status = exif_read_prefix(fd, &prefix, &length);
+    if (status != ERR_OK) {
+        memset(thumbnail, 0, sizeof(*thumbnail));
+        thumbnail->orientation = 1;
+        return status;
+    }
+
+    status = exif_thumbnail(prefix, length, thumbnail);                 // The prefix starts at file offset 0
+    thumbnail->data = NULL;
+    free(prefix);
+    return status;
+}
+
+char *exif_parse_path(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    char *output = exif_parse_fd(fd);
+    close(fd);
+    return output;
+}
+
+ErrorCode exif_json_mmap(const char *path, char **json) {
+    *json = NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ERR_IO;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return ERR_IO;
+    }
+    size_t file_size = (size_t)st.st_size;
+
+    uint8_t *map = mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);                                                          // The mapping keeps the file alive
+    if (map == MAP_FAILED) {
+        return ERR_IO;
+    }
+
+    size_t window = (file_size < EXIF_READ_WINDOW) ? file_size : EXIF_READ_WINDOW;
+    posix_madvise(map, file_size, POSIX_MADV_RANDOM);                   // No readahead into the image data
+    posix_madvise(map, window, POSIX_MADV_SEQUENTIAL);                  // The header walk reads the start in order
+    posix_madvise(map, window, POSIX_MADV_WILLNEED);
+
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+
+    ErrorCode status = exif_locate(map, file_size, NULL, &tiff_offset, &tiff_length, NULL);
+    if (status == ERR_OK) {
+
+        if (tiff_offset + tiff_length > window) {                       // EXIF lies past the window, prefetch it too
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t start = tiff_offset - (tiff_offset % page);          // madvise needs a page aligned start
+            posix_madvise(map + start, tiff_offset + tiff_length - start, POSIX_MADV_WILLNEED);
+        }
+
+        status = build_json(parse_tiff_to_builder, map + tiff_offset, tiff_length, json);
+    }
+
+    munmap(map, file_size);
+    return status;
+}
+
+char *exif_parse_mmap(const char *path) {
+    char *json = NULL;
+    exif_json_mmap(path, &json);
+    return json;
+}
@@ -3,10 +3,12 @@
  * @description
  * @author          Jesse Peterson
  * @createTime      2025-06-27 22:51:55
- * @lastModified    2025-07-18 09:33:03
+ * @lastModified    2026-10-17 00:47:03
  */
 
 #include "exif_parser.h"
+#include "exif_swap.h"
+#include "jpeg_segments.h"
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -14,6 +16,23 @@
 #include <stdlib.h>
 #include <string.h>
 
+// ** File-private prototypes ** //
+
+static ErrorCode jpeg_to_json(const uint8_t *buffer, size_t length, const ExifTagSet *tags, JpegIndex *index, OutputBuilder *output);
+static ErrorCode tiff_to_json(const uint8_t *tiff, size_t tiff_length, const ExifTagSet *tags, OutputBuilder *output);
+static char *finish_json(OutputBuilder *output, ErrorCode status);
+static ErrorCode crawl_ifds_mm(const uint8_t *tiff, size_t tiff_length, size_t ifd0, const ExifTagSet *tags, EntryVisitor visit, void *ctx);   // "MM" blocks
+static ErrorCode crawl_ifds_ii(const uint8_t *tiff, size_t tiff_length, size_t ifd0, const ExifTagSet *tags, EntryVisitor visit, void *ctx);   // "II" blocks
+static ErrorCode collect_entry(const ExifEntry *entry, void *ctx);
+static ErrorCode collect_thumbnail(const ExifEntry *entry, void *ctx);
+static ErrorCode write_json_entry(const ExifEntry *entry, void *ctx);
+static ErrorCode write_value(const ExifEntry *entry, OutputBuilder *output);
+static ErrorCode decode_record(const uint8_t *tiff, size_t tiff_length, size_t pos, bool big_endian, ExifEntry *entry);
+static ErrorCode tiff_header(const uint8_t *tiff, size_t tiff_length, bool *big_endian, size_t *ifd0);
+static ErrorCode index_ifds_mm(const uint8_t *tiff, size_t tiff_length, size_t ifd0, ExifIndex *index);   // "MM" blocks
+static ErrorCode index_ifds_ii(const uint8_t *tiff, size_t tiff_length, size_t ifd0, ExifIndex *index);   // "II" blocks
+static ErrorCode translate_array(const ExifEntry *entry, OutputBuilder *output);
+
 // ** COMPILE WITH VERBOSE ** //
 #ifdef VERBOSE
 #define VPRINT(...) printf(__VA_ARGS__)
@@ -23,12 +42,47 @@
   } while (0)
 #endif
 
+// Components converted per batch when writing arrays, keeps stack use bounded
+#define EXIF_ARRAY_CHUNK 256
+
+// Types written as a JSON array when they hold more than one component
+static inline bool is_numeric_type(uint16_t type) {
+    return type == EXIF_TYPE_SHORT || type == EXIF_TYPE_LONG || type == EXIF_TYPE_RATIONAL ||
+           type == EXIF_TYPE_SLONG || type == EXIF_TYPE_SRATIONAL;
+}
+
+// ** Visitor state ** //
+
+// Stores entries into caller memory for parse_jpeg_entries
+typedef struct {
+    ExifEntry *entries;
+    size_t capacity;
+    size_t count;                                                       // May exceed capacity, then only counted
+} EntryList;
+
+// The IFD1 thumbnail tags for exif_thumbnail
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint16_t orientation;
+    bool has_offset;
+    bool has_length;
+} ThumbnailTags;
+
+// Serialises entries as JSON members
+typedef struct {
+    OutputBuilder *output;
+    size_t written;                                                     // Members written so far, for separators
+} JsonWriter;
+
 // **** ERROR HANDLING **** //
 
 static char *get_error_string(ErrorCode code) {
 switch (code) {
     case ERR_OK:
         return "No Error";
+    case ERR_TOO_SMALL:
+        return "Output buffer is too small";
     case ERR_EXIF_MISSING:
         return "Missing EXIF data";
     case ERR_TIFF_OVERFLOW: 
@@ -44,13 +98,23 @@ switch (code) {
     case ERR_MALLOC:
         return "Error during malloc";
     case ERR_SHORT_COUNT:
-        return "The count of a short item exceeds 1";
+        return "The short item has no components";
     case ERR_LONG_COUNT:
-        return "The count of a long item exceeds 1";
+        return "The long item has no components";
     case ERR_RATIONAL_COUNT:
-        return "The count of rational items exceeds 1";
+        return "The rational item has no components";
     case ERR_UNKNOWN_UNDEFINED:
         return "The tag of type undefined is unknown";
+    case ERR_TRUNCATED:
+        return "Image ends before the EXIF segment was found";
+    case ERR_IO:
+        return "Error reading the image file";
+    case ERR_FILTERED:
+        return "Image rejected by the filter";
+    case ERR_JPEG_INVALID:
+        return "Malformed JPEG marker structure";
+    case ERR_CHECKSUM:
+        return "Chunk checksum mismatch";
     case ERR_UNKNOWN:
         return "Unkown Error";
     default:
@@ -60,684 +124,1158 @@ switch (code) {
 
 // **** EXIF TAGS **** //
 
-static const char *get_exif_tag_name(uint16_t tag) {
-
-  size_t count = sizeof(exif_tags) / sizeof(exif_tags[0]);
-  for (size_t i = 0; i < count; i++) {
-    if (exif_tags[i].tag == tag) {
-      return exif_tags[i].name;
+// Each tag is placed in the slot its hash selects. Two tags landing in the same
+// slot is a build error, pick a new EXIF_TAG_HASH_MUL if a new tag collides.
+#define TAG(tag, name) [EXIF_TAG_SLOT(tag)] = { (tag), sizeof(name) - 1, (name) }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic error "-Woverride-init"
+const ExifTag exif_tag_table[EXIF_TAG_SLOTS] = {
+    TAG(0x0102, "BitsPerSample"),
+    TAG(0x0103, "Compression"),
+    TAG(0x010F, "Make"),
+    TAG(0x0110, "Model"),
+    TAG(0x0111, "StripOffsets"),
+    TAG(0x0112, "Orientation"),
+    TAG(0x0117, "StripByteCounts"),
+    // TAG(0x011A, "XResolution"),
+    // TAG(0x011B, "YResolution"),
+    // TAG(0x0128, "ResolutionUnit"),
+    // TAG(0x0131, "Software"),
+    TAG(0x0132, "ModifyDate"),
+    TAG(0x0201, "ThumbnailOffset"),
+    TAG(0x0202, "ThumbnailLength"),
+    TAG(0x8298, "Copyright"),
+    TAG(0x8769, "ExifOffset"),
+
+    TAG(0x829A, "ExposureTime"),
+    TAG(0x829D, "FNumber"),
+    TAG(0x8822, "ExposureProgram"),
+    TAG(0x8827, "ISO"),
+    TAG(0x8830, "SensitivityType"),
+    TAG(0x8831, "StandardOutputSensitivity"),
+    // TAG(0x9000, "ExifVersion"),
+    TAG(0x9003, "DateTimeOriginal"),
+    TAG(0x9004, "CreateDate"),
+    // TAG(0x9101, "ComponentsConfiguration"),
+    // TAG(0x9204, "ExposureCompensation"),
+    // TAG(0x9207, "MeteringMode"),
+    // TAG(0x9209, "Flash"),
+    TAG(0x920A, "FocalLength"),
+    // TAG(0xA000, "FlashpixVersion"),
+    TAG(0xA001, "ColorSpace"),
+    TAG(0xA002, "ExifImageWidth"),
+    TAG(0xA003, "ExifImageHeight"),
+    // TAG(0xA217, "SensingMethod"),
+    // TAG(0xA300, "FileSource"),
+    // TAG(0xA301, "SceneType"),
+    // TAG(0xA401, "CustomRendered"),
+    // TAG(0xA402, "ExposureMode"),
+    // TAG(0xA403, "WhiteBalanced"),
+    TAG(0xA405, "FocalLengthIn35mmFormat"),
+    // TAG(0xA406, "SceneCaptureType"),
+    TAG(0xA408, "Contrast"),
+    TAG(0xA409, "Saturation"),
+    TAG(0xA40A, "Sharpness"),
+    // TAG(0xA40C, "SubjectDistanceRange"),
+    TAG(0xA432, "LensSpecification"),
+    TAG(0xA500, "Gamma"),
+};
+#pragma GCC diagnostic pop
+
+#undef TAG
+
+// GPS and Interop tags are the index into their table
+#define TAG(tag, name) [(tag)] = { (tag), sizeof(name) - 1, (name) }
+
+const ExifTag exif_gps_tag_table[EXIF_GPS_TAGS] = {
+    TAG(0x0000, "GPSVersionID"),
+    TAG(0x0001, "GPSLatitudeRef"),
+    TAG(0x0002, "GPSLatitude"),
+    TAG(0x0003, "GPSLongitudeRef"),
+    TAG(0x0004, "GPSLongitude"),
+    TAG(0x0005, "GPSAltitudeRef"),
+    TAG(0x0006, "GPSAltitude"),
+    TAG(0x0007, "GPSTimeStamp"),
+    TAG(0x0008, "GPSSatellites"),
+    TAG(0x0009, "GPSStatus"),
+    TAG(0x000A, "GPSMeasureMode"),
+    TAG(0x000B, "GPSDOP"),
+    TAG(0x000C, "GPSSpeedRef"),
+    TAG(0x000D, "GPSSpeed"),
+    TAG(0x000E, "GPSTrackRef"),
+    TAG(0x000F, "GPSTrack"),
+    TAG(0x0010, "GPSImgDirectionRef"),
+    TAG(0x0011, "GPSImgDirection"),
+    TAG(0x0012, "GPSMapDatum"),
+    TAG(0x0013, "GPSDestLatitudeRef"),
+    TAG(0x0014, "GPSDestLatitude"),
+    TAG(0x0015, "GPSDestLongitudeRef"),
+    TAG(0x0016, "GPSDestLongitude"),
+    TAG(0x0017, "GPSDestBearingRef"),
+    TAG(0x0018, "GPSDestBearing"),
+    TAG(0x0019, "GPSDestDistanceRef"),
+    TAG(0x001A, "GPSDestDistance"),
+    TAG(0x001B, "GPSProcessingMethod"),
+    TAG(0x001C, "GPSAreaInformation"),
+    TAG(0x001D, "GPSDateStamp"),
+    TAG(0x001E, "GPSDifferential"),
+    TAG(0x001F, "GPSHPositioningError"),
+};
+
+const ExifTag exif_interop_tag_table[EXIF_INTEROP_TAGS] = {
+    TAG(0x0001, "InteropIndex"),
+    TAG(0x0002, "InteropVersion"),
+};
+
+#undef TAG
+
+void exif_tagset_add_ifds(ExifTagSet *set, unsigned ifds) {
+
+    for (uint32_t slot = 0; slot < EXIF_TAG_SLOTS; slot++) {            // IFD0, Exif and IFD1 share the main table
+        uint16_t tag = exif_tag_table[slot].tag;
+        if (exif_tag_table[slot].name == NULL) {
+            continue;
+        }
+        if (ifds & (EXIF_IFD_BIT(EXIF_IFD_0) | EXIF_IFD_BIT(EXIF_IFD_EXIF))) {
+            exif_tagset_add_in(set, EXIF_IFD_0, tag);
+        }
+        if (ifds & EXIF_IFD_BIT(EXIF_IFD_1)) {
+            exif_tagset_add_in(set, EXIF_IFD_1, tag);
+        }
     }
-  }
-
-  return "unknown";
+    for (uint16_t tag = 0; tag < EXIF_GPS_TAGS && (ifds & EXIF_IFD_BIT(EXIF_IFD_GPS)); tag++) {
+        exif_tagset_add_in(set, EXIF_IFD_GPS, tag);                     // Gaps in the table are refused
+    }
+    for (uint16_t tag = 0; tag < EXIF_INTEROP_TAGS && (ifds & EXIF_IFD_BIT(EXIF_IFD_INTEROP)); tag++) {
+        exif_tagset_add_in(set, EXIF_IFD_INTEROP, tag);
+    }
+    set->ifds |= ifds & EXIF_IFDS_ALL;
 }
 
 // **** PARSER **** //
 char *parse_jpeg(const uint8_t *buffer, size_t length) {
+    return parse_jpeg_select(buffer, length, NULL);
+}
 
-    size_t i = 2;                                                       // SKIP SOI (0xFF, 0xD8)
-    uint16_t seg_length = 0;                                            // Track how long the Exif chunk is
-    char *output = malloc(2);                                           // Allocate memory to storing the output
-    output[0] = '{';
-    output[1] = '\0';
+char *parse_jpeg_select(const uint8_t *buffer, size_t length, const ExifTagSet *tags) {
 
-    if (*output == NULL) {                                              // If Malloc fails
+    OutputBuilder output;                                               // Accumulates the JSON output
+
+    if (!builder_init(&output, 512)) {                                  // If Malloc fails
         return get_error_string(ERR_MALLOC);
     }
 
-    while (i + 4 < length) {                                            // i + 4 to SOI EOI and JFIF
-        
-        if (((buffer[i] << 8) | buffer[i + 1]) == 0xFFE0) {             // If JFIF is present look for the offset
-            i += (((buffer[i + 2] << 8) | buffer[i + 3]) + 1);
-        }
+    JpegIndex index;
+    return finish_json(&output, jpeg_to_json(buffer, length, tags, &index, &output));
+}
 
-        if (((buffer[i] << 8) | buffer[i + 1]) == 0xFFE1) {             // EXIF MARKER
-            seg_length = buffer[i + 2] << 8 | buffer[i + 3];            // Set the segment length to the length outlined here
+char *parse_jpeg_keep_index(const uint8_t *buffer, size_t length, JpegIndex *index) {
 
-            if(i + seg_length > length - 2 ) {                          // If the Tiff segment extends past image buffer
-                return get_error_string(ERR_TIFF_OVERFLOW);
-            }
+    OutputBuilder output;                                               // Accumulates the JSON output
 
-            if ((i + 9 < seg_length) && (                               // Checks that we do not extend past seg_length
-                buffer[i + 4] == 'E' &&
-                buffer[i + 5] == 'x' && 
-                buffer[i + 6] == 'i' &&
-                buffer[i + 7] == 'f' &&
-                buffer[i + 8] == 0x00 && 
-                buffer[i + 9] == 0x00)) {
-                    i += 10;                                            // Accounts for our checks
-                    u8_crawler(buffer, seg_length, i, &output);
-                    return output;
-            }
+    if (!builder_init(&output, 512)) {                                  // If Malloc fails
+        return get_error_string(ERR_MALLOC);
+    }
+    return finish_json(&output, jpeg_to_json(buffer, length, NULL, index, &output));
+}
+
+char *parse_tiff(const uint8_t *tiff, size_t tiff_length) {
+
+    OutputBuilder output;                                               // Accumulates the JSON output
+
+    if (!builder_init(&output, 512)) {                                  // If Malloc fails
+        return get_error_string(ERR_MALLOC);
+    }
+    return finish_json(&output, tiff_to_json(tiff, tiff_length, NULL, &output));
+}
+
+ErrorCode parse_jpeg_to_builder(const uint8_t *buffer, size_t length, const ExifTagSet *tags, OutputBuilder *output) {
+    JpegIndex index;
+    return jpeg_to_json(buffer, length, tags, &index, output);
+}
+
+ErrorCode parse_tiff_to_builder(const uint8_t *tiff, size_t tiff_length, const ExifTagSet *tags, OutputBuilder *output) {
+    return tiff_to_json(tiff, tiff_length, tags, output);
+}
+
+ErrorCode parse_jpeg_into(const uint8_t *buffer, size_t length, char *output, size_t output_cap, size_t *required) {
+
+    OutputBuilder builder;                                              // Writes into the callers memory only
+    builder_init_fixed(&builder, output, output_cap);
+
+    JpegIndex index;
+    ErrorCode status = jpeg_to_json(buffer, length, NULL, &index, &builder);
+
+    if (required != NULL) {
+        *required = (status == ERR_OK) ? builder_needed(&builder) : 0;
+    }
+
+    if (status == ERR_OK && builder_overflowed(&builder)) {            // Like snprintf, keep the output terminated
+        if (output_cap > 0 && output != NULL) {
+            output[output_cap - 1] = '\0';
         }
-        i++;
+        return ERR_TOO_SMALL;
     }
-    return NULL;
+    return status;
 }
 
-static ErrorCode u8_crawler(const uint8_t *buffer, uint16_t seg_length, size_t offset, char **output) {
+ErrorCode parse_jpeg_entries(const uint8_t *buffer, size_t length, ExifEntry *entries, size_t capacity, size_t *count) {
+    return parse_jpeg_entries_select(buffer, length, NULL, entries, capacity, count);
+}
 
-    uint16_t tiff_tags = 0;                                             // Length of tiff tags
-    uint16_t exif_tags = 0;                                             // Length of exif tags
-    bool big_endian = false;                                            // Tracks the endianess
-    size_t itt = offset;                                                // Itterator
+ErrorCode parse_jpeg_entries_select(const uint8_t *buffer, size_t length, const ExifTagSet *tags, ExifEntry *entries,
+                                    size_t capacity, size_t *count) {
 
+    EntryList list = { entries, capacity, 0 };
+    ErrorCode status = exif_visit_entries(buffer, length, tags, collect_entry, &list);
 
-    VPRINT("| Endian bytes: 0x%04X ", ((buffer[itt] << 8)| buffer[itt + 1]));
+    if (count != NULL) {
+        *count = (status == ERR_OK) ? list.count : 0;
+    }
 
-    switch((buffer[itt] << 8) | buffer[itt + 1]) {                      // Tracks the endianess
-        case (0x4D4D):
-            big_endian = true;
-            break;
-        case (0x4949):
-            big_endian = false;
-            break;
-        default:
-            return ERR_ENDIAN_MISSING;
+    if (status == ERR_OK && list.count > capacity) {                    // Only the first capacity entries were stored
+        return ERR_TOO_SMALL;
     }
-    itt += 2;
+    return status;
+}
 
-    VPRINT("| big_endian: %d |\n", big_endian);                         // Verbose logging
+ErrorCode exif_visit_entries(const uint8_t *buffer, size_t length, const ExifTagSet *tags, EntryVisitor visit, void *ctx) {
 
-    if(                                                                 // IF TIFF magic number is missing
-        (big_endian && ((buffer[itt] << 8) | buffer[itt + 1]) != 0x002A) ||
-        (!big_endian &&((buffer[itt + 1] << 8) | buffer[itt]) != 0x002A)) {  
-        return ERR_TIFF_MISSING;
+    size_t tiff_offset = 0;                                             // Where the TIFF header starts in buffer
+    size_t tiff_length = 0;                                             // Bytes of TIFF data in the APP1 segment
+
+    ErrorCode status = jpeg_find_exif(buffer, length, &tiff_offset, &tiff_length, NULL);
+    if (status != ERR_OK) {
+        return status;
     }
-    itt += 6;                                                           // jump number and offset to first IFD
+    return u8_crawler(buffer + tiff_offset, tiff_length, tags, visit, ctx);
+}
 
-    if (big_endian) {
-        tiff_tags = ((buffer[itt] << 8) | buffer[itt + 1]);             // Set the tiff_tags
-    } else {
-        tiff_tags = ((buffer[itt + 1] << 8) | buffer[itt]);             // Set the tiff_tags
+ErrorCode exif_index_build(ExifIndex *index, const uint8_t *buffer, size_t length) {
+
+    size_t tiff_offset = 0;                                             // Where the TIFF header starts in buffer
+    size_t tiff_length = 0;                                             // Bytes of TIFF data in the APP1 segment
+    size_t ifd0 = 0;
+
+    exif_index_free(index);                                             // Values cached for the last image
+    index->tiff = NULL;                                                 // Empty, so lookups fail cleanly on error
+    index->tiff_length = 0;
+    index->count = 0;
+    memset(index->slots, 0, sizeof(index->slots));
+
+    ErrorCode status = jpeg_find_exif(buffer, length, &tiff_offset, &tiff_length, NULL);
+    if (status == ERR_OK) {
+        status = tiff_header(buffer + tiff_offset, tiff_length, &index->big_endian, &ifd0);
+    }
+    if (status != ERR_OK) {
+        return status;
     }
-    itt += 2;
 
-    VPRINT("| # of tiff_tags: %d |\n", tiff_tags);
+    index->tiff = buffer + tiff_offset;
+    index->tiff_length = tiff_length;
+    if (index->big_endian) {
+        return index_ifds_mm(index->tiff, tiff_length, ifd0, index);
+    }
+    return index_ifds_ii(index->tiff, tiff_length, ifd0, index);
+}
 
-    for(int i = 0; i < tiff_tags + exif_tags; i++) {                    // Iterates through Tiff then exif tags
+ErrorCode exif_get_entry(const ExifIndex *index, uint16_t tag, ExifEntry *entry) {
+    return exif_get_entry_in(index, EXIF_IFD_0, tag, entry);
+}
 
-        // ** TAG ** //
-        uint16_t tag = 0;
-        if (big_endian) {
-            tag = (buffer[itt] << 8) | buffer[itt + 1];                 // Gets the tag
-        } else {
-            tag = (buffer[itt + 1] << 8) | buffer[itt];                 // Gets the tag
-        }
-        itt += 2;
+ErrorCode exif_get_entry_in(const ExifIndex *index, ExifIfd ifd, uint16_t tag, ExifEntry *entry) {
 
-        if (strcmp(get_exif_tag_name(tag), "unknown") == 0) {
-            itt += 10;                                                  // Update itt to match what it would be
-            continue;                                                   // Skip to next iteration
-        }
+    int key = exif_tag_key(ifd, tag);
+    if (key < 0 || index->slots[key] == 0) {
+        return ERR_INVALID_TAG;
+    }
 
-        VPRINT("| Tag: %s ", get_exif_tag_name(tag));
+    const ExifIndexRecord *record = &index->records[index->slots[key] - 1];
+    ErrorCode status = decode_record(index->tiff, index->tiff_length, record->record, index->big_endian, entry);
+    entry->ifd = record->ifd;
+    return status;
+}
 
-        // ** TYPE ** //
-        uint16_t type = 0;
-        if (big_endian) {
-            type = (buffer[itt] << 8) | buffer[itt + 1];                // Gets the type
-        } else {
-            type = (buffer[itt + 1] << 8) | buffer[itt];                // Gets the type
-        }
-        itt += 2;
+ErrorCode exif_get(ExifIndex *index, uint16_t tag, const char **value) {
+    return exif_get_in(index, EXIF_IFD_0, tag, value);
+}
 
-        VPRINT("| Type: 0x%04X ", type);
-
-        // ** COUNT ** //
-        uint32_t count = 0;
-        if (big_endian) {
-            count = (                                                   // Gets the count
-                (buffer[itt] << 24) | 
-                (buffer[itt + 1] << 16) |
-                (buffer[itt + 2] << 8) |
-                (buffer[itt + 3])
-            ); 
-        } else {
-            count = (                                                   // Gets the count
-                (buffer[itt + 3] << 24) | 
-                (buffer[itt + 2] << 16) |
-                (buffer[itt + 1] << 8) |
-                (buffer[itt + 0])
-            ); 
+ErrorCode exif_get_in(ExifIndex *index, ExifIfd ifd, uint16_t tag, const char **value) {
+
+    ExifEntry entry;
+    ErrorCode status = exif_get_entry_in(index, ifd, tag, &entry);
+    if (status != ERR_OK) {
+        return status;
+    }
+
+    size_t i = index->slots[exif_tag_key(ifd, tag)] - 1;
+    if (index->values[i] == NULL) {                                     // First request, format and keep it
+        OutputBuilder output;
+        if (!builder_init(&output, 32)) {
+            return ERR_MALLOC;
+        }
+        status = write_value(&entry, &output);
+        if (status != ERR_OK) {
+            builder_free(&output);
+            return status;
+        }
+        index->values[i] = builder_finish(&output);
+        if (index->values[i] == NULL) {
+            return ERR_MALLOC;
         }
-        itt += 4;
+    }
+
+    *value = index->values[i];
+    return ERR_OK;
+}
+
+void exif_index_free(ExifIndex *index) {
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->values[i]);
+        index->values[i] = NULL;
+    }
+}
+
+ErrorCode exif_thumbnail(const uint8_t *buffer, size_t length, ExifThumbnail *thumbnail) {
+
+    size_t tiff_offset = 0;                                             // Where the TIFF header starts in buffer
+    size_t tiff_length = 0;                                             // Bytes of TIFF data in the APP1 segment
+    ThumbnailTags found = { 0, 0, 1, false, false };                    // Orientation defaults to 1
+    ExifTagSet tags;
+
+    memset(thumbnail, 0, sizeof(*thumbnail));
+    thumbnail->orientation = 1;
+
+    ErrorCode status = jpeg_find_exif(buffer, length, &tiff_offset, &tiff_length, NULL);
+    if (status != ERR_OK) {
+        return status;
+    }
+
+    exif_tagset_clear(&tags);
+    tags.ifds = EXIF_IFD_BIT(EXIF_IFD_0);                               // Not the Exif or GPS IFDs, add_in adds IFD1
+    exif_tagset_add_in(&tags, EXIF_IFD_0, 0x0112);
+    exif_tagset_add_in(&tags, EXIF_IFD_1, 0x0201);
+    exif_tagset_add_in(&tags, EXIF_IFD_1, 0x0202);
+
+    status = u8_crawler(buffer + tiff_offset, tiff_length, &tags, collect_thumbnail, &found);
+    if (status != ERR_OK) {
+        return status;
+    }
+    thumbnail->orientation = found.orientation;
+
+    if (!found.has_offset || !found.has_length) {
+        return ERR_INVALID_TAG;
+    }
+    if (found.offset > tiff_length || found.length > tiff_length - found.offset) {
+        return ERR_EXIF_OVERFLOW;
+    }
+
+    const uint8_t *data = buffer + tiff_offset + found.offset;
+    if (found.length < 2 || data[0] != 0xFF || data[1] != 0xD8) {       // Only JPEG thumbnails are usable as they are
+        return ERR_INVALID_TAG;
+    }
+
+    thumbnail->data = data;
+    thumbnail->offset = tiff_offset + found.offset;
+    thumbnail->length = found.length;
+    return ERR_OK;
+}
+
+ErrorCode exif_entry_to_builder(const ExifEntry *entry, OutputBuilder *output, size_t *written) {
+    JsonWriter writer = { output, *written };
+
+    write_json_entry(entry, &writer);
+    *written = writer.written;
+    return output->failed ? ERR_MALLOC : ERR_OK;
+}
+
+ErrorCode exif_entries_to_json(const ExifEntry *entries, size_t count, char *output, size_t output_cap, size_t *required) {
 
-        VPRINT("| Count: %d ", type);
+    OutputBuilder builder;                                              // Writes into the callers memory only
+    builder_init_fixed(&builder, output, output_cap);
+    JsonWriter writer = { &builder, 0 };
+
+    builder_putc(&builder, '{');
+    for (size_t i = 0; i < count; i++) {
+        write_json_entry(&entries[i], &writer);
+    }
+    builder_putc(&builder, '}');
 
-        // ** VALUE ** //
-        uint8_t value[20];                                              // Gets the value in UINT_8
-        for (int j = 0; j < 4; j++) {
-            value[j] = buffer[itt++];
+    if (required != NULL) {
+        *required = builder_needed(&builder);
+    }
+
+    if (builder_overflowed(&builder)) {                                 // Like snprintf, keep the output terminated
+        if (output_cap > 0 && output != NULL) {
+            output[output_cap - 1] = '\0';
         }
+        return ERR_TOO_SMALL;
+    }
+    return ERR_OK;
+}
 
+size_t exif_entry_values(const ExifEntry *entry, size_t first, uint32_t *values, size_t capacity) {
 
-        ErrorCode status;                                               // Use this for tracking error codes
-        char *response = malloc(1);                                     // Use this char string to track responses
-        response[0] = '\0';
+    if (!is_numeric_type(entry->type) || first >= entry->count) {
+        return 0;
+    }
 
-        // **** Inline-Data parsing**** //
-        switch (type) {
-            // ** BYTE ** //
-            case 0x0001: {
-                status = translate_byte(buffer, count, value, offset, &response, big_endian);
-                break;
-            }
-            // ** ASCII ** //
-            case 0x0002: {
-                status = translate_ascii(buffer, count, value, offset, &response, big_endian);
-                break;
-            }
-            // ** SHORT ** //
-            case 0x0003: {
-                status = translate_short(buffer, count, value, offset, &response, big_endian, tag);
-                break;
-            }
-            // ** LONG ** //
-            case 0x0004: {
-
-                if (exif_tags == 0 && tag == 0x8769) {                  // If the tag is ExifOffset then jump the iterator to our exif data
-                    if(big_endian) {
-                        itt = offset + ((value[0] << 24) |
-                                        (value[1] << 16) |
-                                        (value[2] << 8) |
-                                        (value[3]));
-                        exif_tags = ((buffer[itt] << 8) | buffer[itt + 1]);
-
-                    } else {
-                        itt = offset + ((value[3] << 24) |
-                                        (value[2] << 16) |
-                                        (value[1] << 8) |
-                                        (value[0]));
-                        exif_tags = ((buffer[itt + 1] << 8) | buffer[itt]);
-                    }
-                    itt += 2;
-                    
-                }
+    size_t per = (entry->type == EXIF_TYPE_RATIONAL || entry->type == EXIF_TYPE_SRATIONAL) ? 2 : 1;
+    size_t n = entry->count - first;                                    // Whole components that fit
+    if (n > capacity / per) {
+        n = capacity / per;
+    }
 
-                status = translate_long(buffer, count, value, offset, &response, big_endian);
-                break;
-            }
-            // ** RATIONAL ** //
-            case 0x0005: {
-                status = translate_rational(buffer, count, value, offset, &response, big_endian);
-                break;
-            }
-            // ** UNDEFINED ** //
-            case 0x0007: {
-                status = translate_undefined(buffer, count, value, offset, &response, big_endian, tag);
-                break;
-            }
-            // ** SLONG ** //
-            case 0x0009: {
-                status = translate_slong(buffer, count, value, offset, &response, big_endian);
-                break;
-            } 
-            // ** SRATIONAL ** //
-            case 0x000A: {
-                status = translate_srational(buffer, count, value, offset, &response, big_endian);
-                break;
-            }
+    if (entry->type != EXIF_TYPE_SHORT) {                               // 32 bit words straight into values
+        exif_load_u32(values, entry->data + 4 * per * first, n * per, entry->big_endian);
+        return n * per;
+    }
 
+    uint16_t shorts[EXIF_ARRAY_CHUNK];                                  // Swapped in chunks, then widened
+    for (size_t done = 0; done < n;) {
+        size_t chunk = (n - done < EXIF_ARRAY_CHUNK) ? n - done : EXIF_ARRAY_CHUNK;
+        exif_load_u16(shorts, entry->data + 2 * (first + done), chunk, entry->big_endian);
+        for (size_t i = 0; i < chunk; i++) {
+            values[done + i] = shorts[i];
         }
-                                    //TEMP DISABLE UNDEFINED
-        if(status == ERR_OK && type != 0x0007) {                        // If the response is valid
-            const char *tagName = get_exif_tag_name(tag);
+        done += chunk;
+    }
+    return n;
+}
 
+// The markers are walked once, into index, and the Exif segment is taken
+// from that table
+static ErrorCode jpeg_to_json(const uint8_t *buffer, size_t length, const ExifTagSet *tags, JpegIndex *index, OutputBuilder *output) {
 
-            if(tag != 0x8769 && (strcmp(tagName, "unknown") != 0)) {    // If the tag is not exifOffset and not unkown
+    size_t tiff_offset = 0;                                             // Where the TIFF header starts in buffer
+    size_t tiff_length = 0;                                             // Bytes of TIFF data in the APP1 segment
 
-                size_t valLen = strlen(response);                       // Get the length of response string
-                size_t tagLen = strlen(tagName);                        // Get the length of tagName
-                char str[1024];                                         // Create a new string to format the data
+    ErrorCode status = jpeg_index_locate(buffer, length, index, &tiff_offset, &tiff_length);
+    if (status != ERR_OK) {
+        return status;
+    }
+    return tiff_to_json(buffer + tiff_offset, tiff_length, tags, output);
+}
 
+static ErrorCode tiff_to_json(const uint8_t *tiff, size_t tiff_length, const ExifTagSet *tags, OutputBuilder *output) {
 
-                if(tag != 0xA001 && (type == 0x03 || type == 0x04)) {
-                    snprintf(str, 1024, "\"%s\":%s,", tagName, response);
-                } else {
-                    snprintf(str, 1024, "\"%s\":\"%s\",", tagName, response);
-                }
-            
-                size_t new_len = (strlen(*output) + strlen(str) + 1);
+    JsonWriter writer = { output, 0 };
 
-                char *tmp = realloc(*output, new_len);
-                if (tmp == NULL) {
-                    fprintf(stderr, "Memory allocation failed\n");
-                    return ERR_UNKNOWN;                                 // or handle the error as needed
-                }
-                *output = tmp;
+    builder_putc(output, '{');
+    ErrorCode status = u8_crawler(tiff, tiff_length, tags, write_json_entry, &writer);
+    builder_putc(output, '}');
 
-                strcat(*output, str);
-                VPRINT("| %s |\n", str);
-            }
+    if (status == ERR_OK && output->failed) {
+        return ERR_MALLOC;
+    }
+    return status;
+}
+
+// Hands over the JSON, or frees it and reports the error the way parse_jpeg
+// always has: a message for overflow and malloc failures, NULL otherwise
+static char *finish_json(OutputBuilder *output, ErrorCode status) {
+
+    if (status != ERR_OK) {
+        builder_free(output);
+        if (status == ERR_TIFF_OVERFLOW || status == ERR_MALLOC) {
+            return get_error_string(status);
         }
-        free(response);
+        return NULL;
     }
+    return builder_finish(output);
+}
 
-    if (strlen(*output) >= 1) {
-        (*output)[strlen(*output) - 1] = '}';
-    };
+// **** ENTRY VISITORS **** //
 
+static ErrorCode collect_entry(const ExifEntry *entry, void *ctx) {
+    EntryList *list = ctx;
+
+    if (list->count < list->capacity) {                                 // Past capacity we only count
+        list->entries[list->count] = *entry;
+    }
+    list->count++;
     return ERR_OK;
-    
 }
 
-static ErrorCode translate_byte(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian) {
-    
-    if (count <= 4) {
-        
-        for(uint8_t i = 0; i < count; i++) {
-            char hexString[7];
-                                                            
-            if (i == count - 1) {                                       // Just format the bytes to string and return
-                snprintf(hexString, 7, "0x%02X", val_or_off[i]);
-            } else {
-                snprintf(hexString, 7, "0x%02X, ", val_or_off[i]);
-            }
+static ErrorCode collect_thumbnail(const ExifEntry *entry, void *ctx) {
+    ThumbnailTags *found = ctx;
+
+    if (entry->count == 0 || (entry->type != EXIF_TYPE_SHORT && entry->type != EXIF_TYPE_LONG)) {
+        return ERR_OK;
+    }
 
-            size_t new_len = (strlen(*response) + strlen(hexString) + 1);
+    if (entry->ifd == EXIF_IFD_0) {                                     // Orientation
+        found->orientation = (uint16_t)entry->value.u;
+    } else if (entry->tag == 0x0201) {
+        found->offset = entry->value.u;
+        found->has_offset = true;
+    } else {
+        found->length = entry->value.u;
+        found->has_length = true;
+    }
+    return ERR_OK;
+}
 
-            char *temp = realloc(*response, new_len);
-            if (!temp) {
-                perror("realloc failed");
-                return ERR_UNKNOWN;
-            }
-            *response = temp;
-            
-            strcat(*response, hexString);
-        }
+static ErrorCode write_json_entry(const ExifEntry *entry, void *ctx) {
+    JsonWriter *writer = ctx;
+    OutputBuilder *output = writer->output;
+    const ExifTag *known = exif_ifd_tag_lookup((ExifIfd)entry->ifd, entry->tag);
 
-        VPRINT("| BYTE: %s | ", *response);
+    if (entry->type == EXIF_TYPE_UNDEFINED || known == NULL) {          // TEMP DISABLE UNDEFINED
         return ERR_OK;
-    } else {
-        return ERR_UNKNOWN;                                             // Can be changes later, dont believe there are any tags we use that are bytes                                                                      
     }
+
+    size_t mark = output->len;                                          // Rewind here if the value cannot be translated
+
+    if (writer->written > 0) {
+        builder_putc(output, ',');
+    }
+    builder_putc(output, '"');
+    if (entry->ifd == EXIF_IFD_1) {                                     // Thumbnail tags repeat names from IFD0
+        builder_append(output, "IFD1:", 5);
+    }
+    builder_append(output, known->name, known->name_len);
+    builder_append(output, "\":", 2);
+
+    if (write_value(entry, output) != ERR_OK) {                         // Drop the partially written entry
+        builder_rewind(output, mark);
+        return ERR_OK;
+    }
+
+    writer->written++;
+    VPRINT("| %s |\n", output->data + mark);
+    return ERR_OK;
 }
 
-static ErrorCode translate_ascii(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian) {
-    char str[count + 1];                                                // For storing the string for concatenation
-    size_t pos = 0;                                                     // Tracks our current location on the str
+// Writes the JSON value of an entry, the text after "Name": in the output
+static ErrorCode write_value(const ExifEntry *entry, OutputBuilder *output) {
 
-    if (count <= 4) {                                                   // If value is inside of the inline-value
+    bool array = entry->count > 1 && is_numeric_type(entry->type);      // Arrays quote their own elements
+    bool quoted = !array && !(entry->tag != 0xA001 &&                   // Plain numbers are written without quotes
+                              (entry->type == EXIF_TYPE_SHORT || entry->type == EXIF_TYPE_LONG));
 
-        for(size_t i = 0; i < count; i++) {                             // Iterate over all of items BUT break when meeting a null terminator '\0
-            
-            if(val_or_off[i] == '\0') break;
+    if (quoted) {
+        builder_putc(output, '"');
+    }
 
-            char c = (char)val_or_off[i];                               // Cast the current byte to a character
-            if(isprint(c)) {                                            // Check if it is a character
-                str[pos++] = c;                                         // Add it to the str
-            } else {
-                str[pos++] = '.';                                       // Otherwise add a '.'
-            }
+    ErrorCode status;                                                   // Use this for tracking error codes
+
+    switch (entry->type) {
+        // ** BYTE ** //
+        case EXIF_TYPE_BYTE: {
+            status = translate_byte(entry, output);
+            break;
         }
-        str[pos] = '\0';                                                // Cap the item with a null terminator
+        // ** ASCII ** //
+        case EXIF_TYPE_ASCII: {
+            status = translate_ascii(entry, output);
+            break;
+        }
+        // ** SHORT ** //
+        case EXIF_TYPE_SHORT: {
+            status = translate_short(entry, output);
+            break;
+        }
+        // ** LONG ** //
+        case EXIF_TYPE_LONG: {
+            status = translate_long(entry, output);
+            break;
+        }
+        // ** RATIONAL ** //
+        case EXIF_TYPE_RATIONAL: {
+            status = translate_rational(entry, output);
+            break;
+        }
+        // ** UNDEFINED ** //
+        case EXIF_TYPE_UNDEFINED: {
+            status = translate_undefined(entry, output);
+            break;
+        }
+        // ** SLONG ** //
+        case EXIF_TYPE_SLONG: {
+            status = translate_slong(entry, output);
+            break;
+        }
+        // ** SRATIONAL ** //
+        case EXIF_TYPE_SRATIONAL: {
+            status = translate_srational(entry, output);
+            break;
+        }
+        default: {
+            status = ERR_INVALID_TAG;
+            break;
+        }
+    }
 
-    } else {
+    if (status == ERR_OK && quoted) {
+        builder_putc(output, '"');
+    }
+    return status;
+}
 
-        uint32_t value = 0;
+// **** IFD DECODING **** //
 
-        if (big_endian) {
-            value = (
-                (val_or_off[0] << 24) |
-                (val_or_off[1] << 16) |
-                (val_or_off[2] << 8) |
-                (val_or_off[3])
-            );
-        } else {
-            value = (
-                (val_or_off[3] << 24) |
-                (val_or_off[2] << 16) |
-                (val_or_off[1] << 8) |
-                (val_or_off[0])
-            );
-        }
+// Fields are loaded with memcpy, which compiles to one unaligned load, and
+// swapped only when the block's byte order differs from the host's. Callers
+// pass big_endian as a constant so the check folds away.
+#if defined(__GNUC__) || defined(__clang__)
+#define EXIF_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define EXIF_ALWAYS_INLINE inline
+#endif
 
-        for (size_t i = offset + value; i < ( offset + value + count); i++) {
-                                                                        // Iterate over all of items BUT break when meeting a null terminator '\0'
-            
-            if (buffer[i] == '\0') break;             
-            
-            char c = (char)buffer[i];                                   // Try to cast the byte to a character
-            if(isprint(c)) {                                            // If valid add to string else '.'
-                str[pos++] = c;
-            } else {
-                str[pos++] = '.';
-            }
-        }
-        str[pos] = '\0';
+static EXIF_ALWAYS_INLINE uint16_t read_u16(const uint8_t *p, const bool big_endian) {
+    uint16_t value;
+    memcpy(&value, p, sizeof(value));
+    return (big_endian != EXIF_HOST_BIG_ENDIAN) ? (uint16_t)EXIF_BSWAP16(value) : value;
+}
+
+static EXIF_ALWAYS_INLINE uint32_t read_u32(const uint8_t *p, const bool big_endian) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return (big_endian != EXIF_HOST_BIG_ENDIAN) ? EXIF_BSWAP32(value) : value;
+}
+
+static ErrorCode u8_crawler(const uint8_t *tiff, size_t tiff_length, const ExifTagSet *tags, EntryVisitor visit, void *ctx) {
+
+    bool big_endian = false;                                            // Tracks the endianess
+    size_t ifd0 = 0;                                                    // Offset of IFD0
+
+    ErrorCode status = tiff_header(tiff, tiff_length, &big_endian, &ifd0);
+    if (status != ERR_OK) {
+        return status;
     }
 
-    size_t new_len = ((strlen(*response) + strlen(str)) + 1);           // Calculates the new length of the string
-    char *temp = realloc(*response, new_len);
-    if (!temp) {
-        perror("realloc failed");
-        free(*response);
-        response = NULL;
-        return ERR_UNKNOWN;
+    if (big_endian) {                                                   // Pick the reader for this byte order once
+        return crawl_ifds_mm(tiff, tiff_length, ifd0, tags, visit, ctx);
     }
-    *response = temp;
+    return crawl_ifds_ii(tiff, tiff_length, ifd0, tags, visit, ctx);
+}
 
-    strcat(*response, str);                                             // Concatenate new data with response pointer
-    
-    VPRINT("| ASCII: %s | ", *response);
+// Checks the byte order mark and magic number, and finds IFD0
+static ErrorCode tiff_header(const uint8_t *tiff, size_t tiff_length, bool *big_endian, size_t *ifd0) {
+
+    if (tiff_length < 8) {                                              // Room for byte order, magic and IFD0 offset
+        return ERR_TIFF_MISSING;
+    }
+
+    VPRINT("| Endian bytes: 0x%04X ", ((tiff[0] << 8)| tiff[1]));
+
+    switch((tiff[0] << 8) | tiff[1]) {                                  // Tracks the endianess
+        case (0x4D4D):
+            *big_endian = true;
+            break;
+        case (0x4949):
+            *big_endian = false;
+            break;
+        default:
+            return ERR_ENDIAN_MISSING;
+    }
+
+    VPRINT("| big_endian: %d |\n", *big_endian);                        // Verbose logging
+
+    if (read_u16(tiff + 2, *big_endian) != 0x002A) {                    // IF TIFF magic number is missing
+        return ERR_TIFF_MISSING;
+    }
+
+    *ifd0 = read_u32(tiff + 4, *big_endian);                            // Jump to the first IFD
+    if (*ifd0 + 2 > tiff_length) {
+        return ERR_EXIF_OVERFLOW;
+    }
     return ERR_OK;
 }
 
+// Decodes the 12 byte field at pos. Inlined into each walk_ifds copy with a
+// constant byte order.
+static EXIF_ALWAYS_INLINE ErrorCode decode_field(const uint8_t *tiff, size_t tiff_length, size_t pos, const bool big_endian,
+                                                 ExifEntry *entry) {
+
+    // Bytes per component of each TIFF type, 0 for unknown types
+    static const uint8_t type_sizes[13] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8 };
 
-static ErrorCode translate_short(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian, const uint16_t tag) {
-    if (count > 1) return ERR_SHORT_COUNT;                              // If the count of the short is more than one return error
+    const uint8_t *field = tiff + pos;
+    entry->tag = read_u16(field, big_endian);
+    entry->type = read_u16(field + 2, big_endian);
+    entry->count = read_u32(field + 4, big_endian);
+    entry->big_endian = big_endian;
+    entry->value.rational.numerator = 0;
+    entry->value.rational.denominator = 0;
 
-    char str[16];
+    VPRINT("| Type: 0x%04X | Count: %u ", entry->type, entry->count);
 
-    uint16_t value = 0;         
-    if(big_endian) {                                                    // Get the value either big or little endian
-        value = ((val_or_off[0] << 8) | val_or_off[1]);
+    uint8_t size = (entry->type < 13) ? type_sizes[entry->type] : 0;
+    if (size == 0) {                                                    // Unknown types keep only the raw value field
+        entry->data = field + 8;
+        entry->length = 4;
+        return ERR_OK;
+    }
+
+    if (entry->count > UINT32_MAX / size) {
+        return ERR_EXIF_OVERFLOW;
+    }
+    entry->length = entry->count * size;
+
+    if (entry->length <= 4) {                                           // Small values are stored inline
+        entry->data = field + 8;
     } else {
-        value = ((val_or_off[1] << 8) | val_or_off[0]);
+        uint32_t value_offset = read_u32(field + 8, big_endian);
+        if (value_offset > tiff_length || entry->length > tiff_length - value_offset) {
+            return ERR_EXIF_OVERFLOW;
+        }
+        entry->data = tiff + value_offset;
     }
 
-    if (tag == 0xA001) {                                                // COLOR SPACE
-        switch ((val_or_off[0] << 8) | val_or_off[1]) {
-        case 0x1:
-            snprintf(str, 5, "%s", "sRGB");
+    if (entry->count == 0) {
+        return ERR_OK;
+    }
+
+    const uint8_t *data = entry->data;
+    switch (entry->type) {                                              // Decode the first component
+        case EXIF_TYPE_BYTE:
+        case EXIF_TYPE_ASCII:
+        case EXIF_TYPE_UNDEFINED:
+            entry->value.u = data[0];
             break;
-        case 0x2:
-            snprintf(str, 10, "%s", "Adobe RBG");
+        case EXIF_TYPE_SBYTE:
+            entry->value.i = (int8_t)data[0];
             break;
-        case 0xFFFD:
-            snprintf(str, 15, "%s", "Wide Gamut RGB");
+        case EXIF_TYPE_SHORT:
+            entry->value.u = read_u16(data, big_endian);
             break;
-        case 0xFFFE:
-            snprintf(str, 12, "%s", "ICC Profile");
+        case EXIF_TYPE_SSHORT:
+            entry->value.i = (int16_t)read_u16(data, big_endian);
             break;
-        case 0xFFFF:
-            snprintf(str, 13, "%s", "Uncalibrated");
+        case EXIF_TYPE_LONG:
+            entry->value.u = read_u32(data, big_endian);
             break;
-        default:
-            snprintf(str, 8, "%s", "Unknown");
+        case EXIF_TYPE_SLONG:
+            entry->value.i = (int32_t)read_u32(data, big_endian);
+            break;
+        case EXIF_TYPE_RATIONAL:
+            entry->value.rational.numerator = read_u32(data, big_endian);
+            entry->value.rational.denominator = read_u32(data + 4, big_endian);
+            break;
+        case EXIF_TYPE_SRATIONAL:
+            entry->value.srational.numerator = (int32_t)read_u32(data, big_endian);
+            entry->value.srational.denominator = (int32_t)read_u32(data + 4, big_endian);
+            break;
+        default:                                                        // FLOAT and DOUBLE stay raw
             break;
-        }
-    } else {                                                            // Otherwise append the number
-        snprintf(str, 6, "%d", (uint16_t)((val_or_off[0] << 8) | val_or_off[1]));
     }
+    return ERR_OK;
+}
 
-    size_t new_len = ((strlen(*response) + strlen(str)) + 1);           // Calculate the new length or response
-    char *temp = realloc(*response, new_len);
-    if (!temp) {
-        perror("realloc failed");
-        free(*response);
-        response = NULL;
-        return ERR_UNKNOWN;
+// Out of line decode_field for callers with a runtime byte order
+static ErrorCode decode_record(const uint8_t *tiff, size_t tiff_length, size_t pos, bool big_endian, ExifEntry *entry) {
+    return decode_field(tiff, tiff_length, pos, big_endian, entry);
+}
+
+// Removes a tag key from the selection, false when it was not selected
+static inline bool tagset_take(ExifTagSet *set, int key) {
+    uint64_t bit = (uint64_t)1 << (key & 63);
+    if ((set->bits[key >> 6] & bit) == 0) {
+        return false;
     }
-    *response = temp;
+    set->bits[key >> 6] &= ~bit;
+    set->count--;
+    return true;
+}
 
-    strcat(*response, str);                                             // Concatenate strings
+// ** IFD graph ** //
 
-    VPRINT("| SHORT: %s | ", *response);
+#define EXIF_MAX_IFDS 16                                                // More IFDs than this is a malformed block
 
+// An IFD found through a pointer tag or a next IFD offset
+typedef struct {
+    uint32_t offset;
+    uint8_t ifd;                                                        // One of ExifIfd
+} IfdLink;
 
-    return ERR_OK;
+// Work list of the walk. Links before head have been walked, the rest are
+// waiting. Nothing is ever removed, so the array is also the set of every
+// offset seen and a link back to one of them is dropped instead of looping.
+typedef struct {
+    IfdLink links[EXIF_MAX_IFDS];
+    size_t head;
+    size_t tail;
+} IfdQueue;
+
+// Queues the IFD at offset unless it has been seen. False when the offset
+// leaves no room for the entry count.
+static bool queue_ifd(IfdQueue *queue, size_t offset, ExifIfd ifd, size_t tiff_length) {
+
+    if (offset + 2 > tiff_length) {
+        return false;
+    }
+    for (size_t i = 0; i < queue->tail; i++) {                          // Cycle, or two pointers to one IFD
+        if (queue->links[i].offset == offset) {
+            return true;
+        }
+    }
+    if (queue->tail < EXIF_MAX_IFDS) {
+        queue->links[queue->tail].offset = (uint32_t)offset;
+        queue->links[queue->tail].ifd = (uint8_t)ifd;
+        queue->tail++;
+    }
+    return true;
 }
-static ErrorCode translate_long(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian) {
-    if (count > 1) return ERR_LONG_COUNT;                               // If count is more than 1 long
-
-    uint32_t value = 0;                                                 // Tracking the value
-    if (big_endian) {
-        value = (
-            (val_or_off[0] << 24) |
-            (val_or_off[1] << 16) |
-            (val_or_off[2] << 8) |
-            (val_or_off[3])
-        );
-    } else {
-        value = (
-            (val_or_off[3] << 24) |
-            (val_or_off[2] << 16) |
-            (val_or_off[1] << 8) |
-            (val_or_off[0])
-        );
+
+// The IFD a pointer tag leads to, EXIF_IFD_0 for every other tag
+static inline ExifIfd pointer_target(ExifIfd ifd, uint16_t tag) {
+    if (ifd == EXIF_IFD_GPS || ifd == EXIF_IFD_INTEROP) {               // Small tags there are not pointers
+        return EXIF_IFD_0;
+    }
+    switch (tag) {
+        case 0x8769:
+            return EXIF_IFD_EXIF;
+        case 0x8825:
+            return EXIF_IFD_GPS;
+        case 0xA005:
+            return EXIF_IFD_INTEROP;
+        default:
+            return EXIF_IFD_0;
+    }
+}
+
+// Whether the walk enters an IFD. The Interop IFD hangs off the Exif IFD, so
+// asking for it also walks that.
+static inline bool wants_ifd(unsigned ifds, ExifIfd ifd) {
+    if (ifd == EXIF_IFD_EXIF) {
+        ifds |= ifds >> (EXIF_IFD_INTEROP - EXIF_IFD_EXIF);
     }
+    return (ifds & EXIF_IFD_BIT(ifd)) != 0;
+}
 
-    char str[12];
-    snprintf(str, 12, "%u", value);                                     // Moves the value into a string
+// Walks every IFD in ifds reachable from IFD0, each once, in the order they
+// are found. Written once and inlined into one copy per byte order and per
+// caller: with an index the known records are only located, otherwise the
+// selected ones are decoded and handed to visit. With a tag selection the
+// walk ends once every selected tag has been seen.
+static EXIF_ALWAYS_INLINE ErrorCode walk_ifds(const uint8_t *tiff, size_t tiff_length, size_t ifd0, const ExifTagSet *tags,
+                                              unsigned ifds, EntryVisitor visit, void *ctx, ExifIndex *index,
+                                              const bool big_endian) {
 
-    size_t new_len = (strlen(*response) + strlen(str) + 1);             // Calculate the string length
-    char *temp = realloc(*response, new_len);
-    if (!temp) {
-        perror("realloc failed");
-        free(*response);
-        response = NULL;
-        return ERR_UNKNOWN;
+    ExifTagSet pending = {0};                                          // Selected tags not seen yet
+    IfdQueue queue = { .head = 0, .tail = 0 };
+
+    if (tags != NULL) {
+        pending = *tags;
     }
-    *response = temp;
+    queue_ifd(&queue, ifd0, EXIF_IFD_0, tiff_length);                   // Checked by tiff_header
+
+    while (queue.head < queue.tail) {
+
+        const IfdLink link = queue.links[queue.head++];
+        const ExifIfd ifd = (ExifIfd)link.ifd;
+        size_t itt = link.offset;
+        uint16_t entries = read_u16(tiff + itt, big_endian);
+        itt += 2;
+
+        VPRINT("| IFD %d at %zu: %d entries |\n", ifd, itt - 2, entries);
 
-    strcat(*response, str);                                             // Concatenate strings
+        for (uint16_t i = 0; i < entries; i++, itt += 12) {
+
+            if (tags != NULL && pending.count == 0) {                   // Every selected tag has been seen
+                return ERR_OK;
+            }
 
-    VPRINT("| LONG: %s | ", *response);
+            if (itt + 12 > tiff_length) {                               // The IFD runs past the TIFF data
+                if (ifd == EXIF_IFD_1) {                                // Only the rest of the thumbnail tags are lost
+                    break;
+                }
+                return ERR_EXIF_OVERFLOW;
+            }
+
+            const uint8_t *field = tiff + itt;
+            uint16_t tag = read_u16(field, big_endian);
+
+            ExifIfd child = pointer_target(ifd, tag);
+            if (child != EXIF_IFD_0) {                                  // Pointers are structural and never reported
+                uint16_t type = read_u16(field + 2, big_endian);
+                bool pointer = (type == EXIF_TYPE_LONG || type == 13) && read_u32(field + 4, big_endian) >= 1;
+                if (pointer && wants_ifd(ifds, child) &&
+                    !queue_ifd(&queue, read_u32(field + 8, big_endian), child, tiff_length)) {
+                    return ERR_EXIF_OVERFLOW;
+                }
+                continue;
+            }
+
+            int key = exif_tag_key(ifd, tag);
+            if (key < 0) {                                              // Unknown in this IFD
+                continue;
+            }
+
+            if (index != NULL) {                                        // Locate only, the first record of a key wins
+                if (index->slots[key] == 0) {
+                    ExifIndexRecord *record = &index->records[index->count++];
+                    record->tag = tag;
+                    record->type = read_u16(field + 2, big_endian);
+                    record->count = read_u32(field + 4, big_endian);
+                    record->record = (uint32_t)itt;
+                    record->ifd = (uint8_t)ifd;
+                    index->slots[key] = (uint16_t)index->count;
+                }
+                continue;
+            }
+
+            if (tags != NULL && !tagset_take(&pending, key)) {          // Skipped before its value is decoded
+                continue;
+            }
+
+            ExifEntry entry;
+            if (decode_field(tiff, tiff_length, itt, big_endian, &entry) != ERR_OK) {
+                continue;                                               // Value points outside the TIFF data
+            }
+            entry.ifd = (uint8_t)ifd;
+
+            ErrorCode status = visit(&entry, ctx);
+            if (status != ERR_OK) {
+                return status;
+            }
+        }
+
+        // IFD0 ends with the offset of IFD1. A bad offset only loses the
+        // thumbnail, so it ends the chain without an error.
+        if (ifd == EXIF_IFD_0 && (ifds & EXIF_IFD_BIT(EXIF_IFD_1)) && itt + 4 <= tiff_length) {
+            uint32_t next = read_u32(tiff + itt, big_endian);
+            if (next != 0) {
+                queue_ifd(&queue, next, EXIF_IFD_1, tiff_length);
+            }
+        }
+    }
 
     return ERR_OK;
+}
 
+static ErrorCode crawl_ifds_mm(const uint8_t *tiff, size_t tiff_length, size_t ifd0, const ExifTagSet *tags, EntryVisitor visit,
+                               void *ctx) {
+    unsigned ifds = (tags != NULL) ? tags->ifds : EXIF_IFDS_DEFAULT;
+    return walk_ifds(tiff, tiff_length, ifd0, tags, ifds, visit, ctx, NULL, true);
 }
-static ErrorCode translate_rational(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian) {
-    if( count > 1) return ERR_RATIONAL_COUNT;
 
-    uint32_t value = 0;                                                 // Stores the offset value
-    uint32_t numerator = 0;                                             // Stores the numerator
-    uint32_t denominator = 0;                                           // Stores the denominator
+static ErrorCode crawl_ifds_ii(const uint8_t *tiff, size_t tiff_length, size_t ifd0, const ExifTagSet *tags, EntryVisitor visit,
+                               void *ctx) {
+    unsigned ifds = (tags != NULL) ? tags->ifds : EXIF_IFDS_DEFAULT;
+    return walk_ifds(tiff, tiff_length, ifd0, tags, ifds, visit, ctx, NULL, false);
+}
 
-    if (big_endian) {                                                   // Gets the value depending on endianness
-        value = (
-            (val_or_off[0] << 24) |
-            (val_or_off[1] << 16) |
-            (val_or_off[2] << 8) |
-            (val_or_off[3])
-        );
+static ErrorCode index_ifds_mm(const uint8_t *tiff, size_t tiff_length, size_t ifd0, ExifIndex *index) {
+    return walk_ifds(tiff, tiff_length, ifd0, NULL, EXIF_IFDS_ALL, NULL, NULL, index, true);
+}
+
+static ErrorCode index_ifds_ii(const uint8_t *tiff, size_t tiff_length, size_t ifd0, ExifIndex *index) {
+    return walk_ifds(tiff, tiff_length, ifd0, NULL, EXIF_IFDS_ALL, NULL, NULL, index, false);
+}
+
+// **** TRANSLATORS **** //
+
+static ErrorCode translate_byte(const ExifEntry *entry, OutputBuilder *output) {
+    
+    if (entry->count <= 4) {
+        
+        for(uint8_t i = 0; i < entry->count; i++) {
+            builder_put_hex8(output, entry->data[i]);                   // Just format the bytes straight into the output
+            if (i != entry->count - 1) {
+                builder_append(output, ", ", 2);
+            }
+        }
+
+        VPRINT("| BYTE: %u | ", entry->count);
+        return ERR_OK;
     } else {
-        value = (
-            (val_or_off[3] << 24) |
-            (val_or_off[2] << 16) |
-            (val_or_off[1] << 8) |
-            (val_or_off[0])
-        );
+        return ERR_UNKNOWN;                                             // Can be changes later, dont believe there are any tags we use that are bytes                                                                      
     }
+}
+
+static ErrorCode translate_ascii(const ExifEntry *entry, OutputBuilder *output) {
+    const uint8_t *str = entry->data;                                   // Inline or not, data points at the characters
+    const uint32_t count = entry->count;
 
-    uint8_t *locale = &buffer[offset + value];                          // Creates a pointer to the rational location
+    if (!builder_reserve(output, (size_t)count * 2)) {                  // Worst case every character is escaped
+        if (!output->fixed) {
+            return ERR_MALLOC;
+        }
 
+        for (size_t i = 0; i < count && str[i] != '\0'; i++) {         // Out of caller memory, only count the length
+            char c = (char)str[i];
+            if (c == '"' || c == '\\') {
+                builder_putc(output, '\\');
+            }
+            builder_putc(output, (c == '"' || c == '\\' || isprint((unsigned char)c)) ? c : '.');
+        }
+        return ERR_OK;
+    }
 
-    if (big_endian) {                                                   // Gets the numerator and denominator
-        numerator = (
-            (locale[0] << 24) |
-            (locale[1] << 16) |
-            (locale[2] << 8) |
-            (locale[3]));
+    char *dst = output->data + output->len;                             // Write the characters in place
+    for (size_t i = 0; i < count; i++) {                                // Iterate over all of items BUT break when meeting a null terminator '\0'
 
-        denominator = (
-            (locale[4] << 24) |
-            (locale[5] << 16) |
-            (locale[6] << 8) |
-            (locale[7]));
-    } else {
-        numerator = (
-            (locale[3] << 24) |
-            (locale[2] << 16) |
-            (locale[1] << 8) |
-            (locale[0]));
+        if (str[i] == '\0') break;
 
-        denominator = (
-            (locale[7] << 24) |
-            (locale[6] << 16) |
-            (locale[5] << 8) |
-            (locale[4]));
+        char c = (char)str[i];                                          // Cast the current byte to a character
+        if (c == '"' || c == '\\') {                                    // Escape characters that would end the JSON string
+            *dst++ = '\\';
+            *dst++ = c;
+        } else if (isprint((unsigned char)c)) {                         // Check if it is a character
+            *dst++ = c;
+        } else {
+            *dst++ = '.';                                               // Otherwise add a '.'
+        }
     }
+    *dst = '\0';                                                        // Cap the item with a null terminator
+    output->len = (size_t)(dst - output->data);
+
+    VPRINT("| ASCII: %u | ", count);
+    return ERR_OK;
+}
 
-    char str[25];                                                       // String to format this item
-    snprintf(str, 25, "%u/%u", numerator, denominator);
 
-    size_t new_len = (strlen(*response) + strlen(str) + 1);             // Calculate the new length of response
-    char *temp = realloc(*response, new_len);
-    if (!temp) {
-        perror("realloc failed");
-        free(*response);
-        response = NULL;
-        return ERR_UNKNOWN;
+static ErrorCode translate_short(const ExifEntry *entry, OutputBuilder *output) {
+    if (entry->count == 0) return ERR_SHORT_COUNT;                      // Nothing to write
+    if (entry->count > 1) return translate_array(entry, output);        // BitsPerSample, StripByteCounts and the like
+
+    const uint32_t value = entry->value.u;
+
+    if (entry->tag == 0xA001) {                                         // COLOR SPACE
+        switch (value) {
+        case 0x1:
+            builder_append(output, "sRGB", 4);
+            break;
+        case 0x2:
+            builder_append(output, "Adobe RBG", 9);
+            break;
+        case 0xFFFD:
+            builder_append(output, "Wide Gamut RGB", 14);
+            break;
+        case 0xFFFE:
+            builder_append(output, "ICC Profile", 11);
+            break;
+        case 0xFFFF:
+            builder_append(output, "Uncalibrated", 12);
+            break;
+        default:
+            builder_append(output, "Unknown", 7);
+            break;
+        }
+    } else {                                                            // Otherwise append the number
+        builder_put_u16(output, (uint16_t)value);
     }
-    *response = temp;
 
-    strcat(*response, str);                                             // concatenate strings
+    VPRINT("| SHORT: %u | ", value);
 
-    VPRINT("| RATIONAL: %s | ", *response);
 
     return ERR_OK;
 }
+static ErrorCode translate_long(const ExifEntry *entry, OutputBuilder *output) {
+    if (entry->count == 0) return ERR_LONG_COUNT;                       // Nothing to write
+    if (entry->count > 1) return translate_array(entry, output);        // StripOffsets can run to thousands
 
-static ErrorCode translate_undefined(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian, const uint16_t tag) {
+    builder_put_u32(output, entry->value.u);                            // Moves the value into the output
 
-    switch(tag) {
-        case 0x9000:                                                    // ** ExifVersion
-        case 0xA000: {                                                  // ** FlashpixVersion
+    VPRINT("| LONG: %u | ", entry->value.u);
 
-            if (count > 4) return ERR_UNKNOWN_UNDEFINED;                // IF the length is more than 4 bytes then return error
+    return ERR_OK;
 
-            char str[10];                                               // Track string and the size of it
-            size_t pos = 0;
-            
-            for (int i = 0; i < 4; i++) {
-                char c = (char)val_or_off[i];                           // Iterate through all bytes
-                str[pos++] = c;
-                if (pos == 2) {                                         // When reaching second byte insert '.' in the middle of the string
-                    str[pos++] = '.';
-                }
-            }
+}
+static ErrorCode translate_rational(const ExifEntry *entry, OutputBuilder *output) {
+    if (entry->count == 0) return ERR_RATIONAL_COUNT;                   // Nothing to write
+    if (entry->count > 1) return translate_array(entry, output);        // LensSpecification, GPS coordinates
 
-            size_t new_len = (strlen(*response) + pos + 1);             // Calculate the new length of response
-            char *temp = realloc(*response, new_len);
-            if (!temp) {
-                perror("realloc failed");
-                free(*response);
-                response = NULL;
-                return ERR_UNKNOWN;
-            }
-            *response = temp;
+    const uint32_t numerator = entry->value.rational.numerator;         // Stores the numerator
+    const uint32_t denominator = entry->value.rational.denominator;     // Stores the denominator
+
+    builder_put_rational(output, numerator, denominator);               // Format this item into the output
+
+    VPRINT("| RATIONAL: %u/%u | ", numerator, denominator);
+
+    return ERR_OK;
+}
+
+static ErrorCode translate_undefined(const ExifEntry *entry, OutputBuilder *output) {
+
+    const uint8_t *val = entry->data;                                   // Every tag handled here is stored inline
+
+    switch(entry->tag) {
+        case 0x9000:                                                    // ** ExifVersion
+        case 0xA000: {                                                  // ** FlashpixVersion
 
-            strcat(*response, str);                                     // Concatenate strings
+            if (entry->count > 4) return ERR_UNKNOWN_UNDEFINED;         // IF the length is more than 4 bytes then return error
 
-            VPRINT("| UNDEFINED: %s | ", *response);
+            builder_append(output, (const char *)val, 2);               // Insert '.' in the middle of the version
+            builder_putc(output, '.');
+            builder_append(output, (const char *)val + 2, 2);
+
+            VPRINT("| UNDEFINED: %04X | ", entry->tag);
 
             return ERR_OK;
         }
         case 0x9101: {                                                  // ** ComponentConfiguration
 
-            if (count > 4) return ERR_UNKNOWN_UNDEFINED;                // If the length is more than 4 bytes then return error
-
-            char str[10];                                               // Track string and the size of it    
-            size_t pos = 0;
+            if (entry->count > 4) return ERR_UNKNOWN_UNDEFINED;         // If the length is more than 4 bytes then return error
 
             for (int it = 0; it < 4; it++) {                            // Iterate over ever byte and decode values
-                switch (val_or_off[it]) {
+                switch (val[it]) {
                 case 0:
-                    str[pos++] = '-';
+                    builder_putc(output, '-');
                     break;
                 case 1:
-                    str[pos++] = 'Y';
+                    builder_putc(output, 'Y');
                     break;
                 case 2:
-                    str[pos++] = 'C';
-                    str[pos++] = 'b';
+                    builder_append(output, "Cb", 2);
                     break;
                 case 3:
-                    str[pos++] = 'C';
-                    str[pos++] = 'r';
+                    builder_append(output, "Cr", 2);
                     break;
                 case 4:
-                    str[pos++] = 'R';
+                    builder_putc(output, 'R');
                     break;
                 case 5:
-                    str[pos++] = 'G';
+                    builder_putc(output, 'G');
                     break;
                 case 6:
-                    str[pos++] = 'B';
+                    builder_putc(output, 'B');
                     break;
                 }
             }
 
-            size_t new_len = (strlen(*response) + pos + 1);             // Calculate the new length of response
-            char *temp = realloc(*response, new_len);
-            if (!temp) {
-                perror("realloc failed");
-                free(*response);
-                response = NULL;
-                return ERR_UNKNOWN;
-            }
-            *response = temp;
-
-            strcat(*response, str);                                     // Concatenate strings
-
-            VPRINT("| UNDEFINED: %s | ", *response);
+            VPRINT("| UNDEFINED: %04X | ", entry->tag);
 
             return ERR_OK;
         }
         case 0xA300: {                                                  // ** FileSource
             
-            if (count > 4) return ERR_UNKNOWN_UNDEFINED;                // If length is more than 4 bytes then return error
-
-            char str[30];                                               // New string of max 30 characters
+            if (entry->count > 4) return ERR_UNKNOWN_UNDEFINED;         // If length is more than 4 bytes then return error
 
-            switch (val_or_off[0]) {                                    // Set the str to decoded string
+            switch (entry->value.u) {                                   // Write the decoded string
             case 1:
-                snprintf(str, 30, "%s", "Film Scanner");
+                builder_append(output, "Film Scanner", 12);
                 break;
             case 2:
-                snprintf(str, 30, "%s", "Reflection Print Scanner");
+                builder_append(output, "Reflection Print Scanner", 24);
                 break;
             case 3:
-                snprintf(str, 30, "%s", "Digital Camera");
+                builder_append(output, "Digital Camera", 14);
                 break;
             default:
-                snprintf(str, 30, "%s", "Unknown");
+                builder_append(output, "Unknown", 7);
             break;
             }
-            
-            size_t new_len = (strlen(*response) + strlen(str) + 1);     // Calculate the new length of response
-            char *temp = realloc(*response, new_len);
-            if (!temp) {
-                perror("realloc failed");
-                free(*response);
-                *response = NULL;
-                return ERR_UNKNOWN;
-            }
-            *response = temp;
-
-            strcat(*response, str);                                     // Concatenate strings
 
-            VPRINT("| UNDEFINED: %s | ", *response);
+            VPRINT("| UNDEFINED: %04X | ", entry->tag);
 
             return ERR_OK;                                     
         }
         case 0xA301: {                                                  // ** SceneType
-            if (count > 4) return ERR_UNKNOWN_UNDEFINED;                // If the length is more than 4 byte then return error
+            if (entry->count > 4) return ERR_UNKNOWN_UNDEFINED;         // If the length is more than 4 byte then return error
 
-            char str[25];
-            
-            if(val_or_off[0] == 1) {                                    // 1 if Directly Photographed otherwise something else
-                snprintf(str, 25, "%s", "Directly Photographed");
+            if(entry->value.u == 1) {                                   // 1 if Directly Photographed otherwise something else
+                builder_append(output, "Directly Photographed", 21);
             } else {
-                snprintf(str, 25, "%s", "Unknown");
-            }
-
-            size_t new_len = (strlen(*response) + strlen(str) + 1);     // Calculate the new length of response
-            char *temp = realloc(*response, new_len);
-            if (!temp) {
-                perror("realloc failed");
-                free(*response);
-                response = NULL;
-                return ERR_UNKNOWN;
+                builder_append(output, "Unknown", 7);
             }
-            *response = temp;
 
-            strcat(*response, str);                                     // Concatenate strings 
-
-            VPRINT("| UNDEFINED: %s | ", *response);
+            VPRINT("| UNDEFINED: %04X | ", entry->tag);
 
             return ERR_OK;
         }            
@@ -746,116 +1284,78 @@ static ErrorCode translate_undefined(const uint8_t *buffer, const uint32_t count
     }
     
 }
-static ErrorCode translate_slong(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian) {
-    if (count > 1) return ERR_LONG_COUNT;                               // If count is more than 1 long
-
-    int32_t value = 0;                                                  // Tracking the value
-    if (big_endian) {
-        value = (
-            (val_or_off[0] << 24) |
-            (val_or_off[1] << 16) |
-            (val_or_off[2] << 8) |
-            (val_or_off[3])
-        );
-    } else {
-        value = (
-            (val_or_off[3] << 24) |
-            (val_or_off[2] << 16) |
-            (val_or_off[1] << 8) |
-            (val_or_off[0])
-        );
-    }
-
-    char str[12];
-    snprintf(str, 12, "%d", value);                                     // Moves the value into a string
-
-    size_t new_len = (strlen(*response) + strlen(str) + 1);             // Calculate the string length
-    char *temp = realloc(*response, new_len);
-    if (!temp) {
-        perror("realloc failed");
-        free(*response);
-        response = NULL;
-        return ERR_UNKNOWN;
-    }
-    *response = temp;
+static ErrorCode translate_slong(const ExifEntry *entry, OutputBuilder *output) {
+    if (entry->count == 0) return ERR_LONG_COUNT;                       // Nothing to write
+    if (entry->count > 1) return translate_array(entry, output);
 
-    strcat(*response, str);                                             // Concatenate strings
+    builder_put_i32(output, entry->value.i);                            // Moves the value into the output
 
-    VPRINT("| SLONG: %s | ", *response);
+    VPRINT("| SLONG: %d | ", entry->value.i);
 
     return ERR_OK;
 
 }
-static ErrorCode translate_srational(const uint8_t *buffer, const uint32_t count, const uint8_t * val_or_off, size_t offset, char **response, const bool big_endian) {
+static ErrorCode translate_srational(const ExifEntry *entry, OutputBuilder *output) {
 
-    if( count > 1) return ERR_RATIONAL_COUNT;
+    if (entry->count == 0) return ERR_RATIONAL_COUNT;                   // Nothing to write
+    if (entry->count > 1) return translate_array(entry, output);
 
-    uint32_t value = 0;                                                 // Stores the offset value
-    int32_t numerator = 0;                                              // Stores the numerator
-    int32_t denominator = 0;                                            // Stores the denominator
+    const int32_t numerator = entry->value.srational.numerator;         // Stores the numerator
+    const int32_t denominator = entry->value.srational.denominator;     // Stores the denominator
 
-    if (big_endian) {                                                   // Gets the value depending on endianness
-        value = (
-            (val_or_off[0] << 24) |
-            (val_or_off[1] << 16) |
-            (val_or_off[2] << 8) |
-            (val_or_off[3])
-        );
-    } else {
-        value = (
-            (val_or_off[3] << 24) |
-            (val_or_off[2] << 16) |
-            (val_or_off[1] << 8) |
-            (val_or_off[0])
-        );
-    }
+    builder_put_srational(output, numerator, denominator);              // Format this item into the output
 
-    uint8_t *locale = &buffer[offset + value];                          // Creates a pointer to the rational location
+    VPRINT("| SRATIONAL: %d/%d | ", numerator, denominator);
 
+    return ERR_OK;
 
-    if (big_endian) {                                                   // Gets the numerator and denominator
-        numerator = (
-            (locale[0] << 24) |
-            (locale[1] << 16) |
-            (locale[2] << 8) |
-            (locale[3]));
+}
 
-        denominator = (
-            (locale[4] << 24) |
-            (locale[5] << 16) |
-            (locale[6] << 8) |
-            (locale[7]));
-    } else {
-        numerator = (
-            (locale[3] << 24) |
-            (locale[2] << 16) |
-            (locale[1] << 8) |
-            (locale[0]));
+// ** Arrays ** //
 
-        denominator = (
-            (locale[7] << 24) |
-            (locale[6] << 16) |
-            (locale[5] << 8) |
-            (locale[4]));
-    }
+// Writes a SHORT, LONG, SLONG, RATIONAL or SRATIONAL with more than one
+// component as a JSON array. Components are converted to host order a chunk
+// at a time by the bulk loaders, then formatted. Rationals stay quoted.
+static ErrorCode translate_array(const ExifEntry *entry, OutputBuilder *output) {
 
-    char str[25];                                                       // String to format this item
-    snprintf(str, 25, "%d/%d", numerator, denominator);
+    uint32_t values[2 * EXIF_ARRAY_CHUNK];                              // Room for a chunk of rationals
+    const size_t step = (entry->type == EXIF_TYPE_RATIONAL || entry->type == EXIF_TYPE_SRATIONAL) ? 2 : 1;
 
-    size_t new_len = (strlen(str) + strlen(*response) + 1);             // Calculate the new length of response
-    char *temp = realloc(*response, new_len);
-    if (!temp) {
-        perror("realloc failed");
-        free(*response);
-        response = NULL;
-        return ERR_UNKNOWN;
-    }
-    *response = temp;
+    builder_putc(output, '[');
+    for (size_t first = 0; first < entry->count; first += EXIF_ARRAY_CHUNK) {
+        size_t slots = exif_entry_values(entry, first, values, step * EXIF_ARRAY_CHUNK);
+
+        for (size_t i = 0; i < slots; i += step) {
+            if (first + i > 0) {
+                builder_putc(output, ',');
+            }
+            switch (entry->type) {
+                case EXIF_TYPE_SLONG:
+                    builder_put_i32(output, (int32_t)values[i]);
+                    break;
+                case EXIF_TYPE_RATIONAL:
+                    builder_putc(output, '"');
+                    builder_put_rational(output, values[i], values[i + 1]);
+                    builder_putc(output, '"');
+                    break;
+                case EXIF_TYPE_SRATIONAL:
+                    builder_putc(output, '"');
+                    builder_put_srational(output, (int32_t)values[i], (int32_t)values[i + 1]);
+                    builder_putc(output, '"');
+                    break;
+                default:                                                // SHORT and LONG
+                    builder_put_u32(output, values[i]);
+                    break;
+            }
+        }
 
-    strcat(*response, str);                                             // concatenate strings
+        if (output->failed) {                                           // No point formatting the rest
+            return ERR_MALLOC;
+        }
+    }
+    builder_putc(output, ']');
 
-    VPRINT("| SRATIONAL: %s | ", *response);
+    VPRINT("| ARRAY: %u | ", entry->count);
 
     return ERR_OK;
-
 }
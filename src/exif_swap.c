@@ -0,0 +1,186 @@
+/*
+ * @file            src/exif_swap.c
+ * @description     SIMD and scalar byte swap kernels behind exif_load_u16 and exif_load_u32
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 15:40:22
+ * @lastModified    2026-10-17 15:40:22
+ */
+
+#include "exif_swap.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Every kernel swaps as many whole vectors as fit and returns the number of
+// components it converted, the caller finishes the rest with the next one.
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EXIF_SWAP_SSE2 1
+#endif
+
+// AVX2 is compiled in with a target attribute and only picked when the CPU
+// reports it, so the default -march still gets it
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define EXIF_SWAP_AVX2 1
+#endif
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#define EXIF_SWAP_WASM 1
+#endif
+
+#define EXIF_SWAP_AVX2_MIN 32                                           // Below this many components the CPU check costs more than it saves
+
+// **** SCALAR **** //
+
+static void swap16_scalar(uint16_t *dst, const uint8_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint16_t value;
+        memcpy(&value, src + 2 * i, sizeof(value));
+        dst[i] = (uint16_t)EXIF_BSWAP16(value);
+    }
+}
+
+static void swap32_scalar(uint32_t *dst, const uint8_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t value;
+        memcpy(&value, src + 4 * i, sizeof(value));
+        dst[i] = EXIF_BSWAP32(value);
+    }
+}
+
+// **** AVX2 **** //
+
+#ifdef EXIF_SWAP_AVX2
+
+__attribute__((target("avx2")))
+static size_t swap16_avx2(uint16_t *dst, const uint8_t *src, size_t count) {
+    const __m256i order = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                                           1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {                                  // 16 components per 32 byte vector
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + 2 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(v, order));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t swap32_avx2(uint32_t *dst, const uint8_t *src, size_t count) {
+    const __m256i order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                           3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {                                    // 8 components per 32 byte vector
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + 4 * i));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_shuffle_epi8(v, order));
+    }
+    return i;
+}
+
+static bool have_avx2(void) {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // EXIF_SWAP_AVX2
+
+// **** SSE2 **** //
+
+#ifdef EXIF_SWAP_SSE2
+
+// SSE2 has no byte shuffle, so the bytes of each half word are swapped with
+// shifts and the half words of each word with the word shuffles
+static size_t swap16_sse2(uint16_t *dst, const uint8_t *src, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    return i;
+}
+
+static size_t swap32_sse2(uint32_t *dst, const uint8_t *src, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *)(dst + i), v);
+    }
+    return i;
+}
+
+#endif // EXIF_SWAP_SSE2
+
+// **** WASM SIMD128 **** //
+
+#ifdef EXIF_SWAP_WASM
+
+static size_t swap16_wasm(uint16_t *dst, const uint8_t *src, size_t count) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        v128_t v = wasm_v128_load(src + 2 * i);
+        wasm_v128_store(dst + i, wasm_i8x16_shuffle(v, v, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+    }
+    return i;
+}
+
+static size_t swap32_wasm(uint32_t *dst, const uint8_t *src, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        v128_t v = wasm_v128_load(src + 4 * i);
+        wasm_v128_store(dst + i, wasm_i8x16_shuffle(v, v, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    }
+    return i;
+}
+
+#endif // EXIF_SWAP_WASM
+
+// **** LOADERS **** //
+
+void exif_load_u16(uint16_t *dst, const uint8_t *src, size_t count, bool big_endian) {
+
+    if (big_endian == EXIF_HOST_BIG_ENDIAN) {                           // Already in host order
+        memcpy(dst, src, count * sizeof(uint16_t));
+        return;
+    }
+
+    size_t done = 0;
+#ifdef EXIF_SWAP_AVX2
+    if (count >= EXIF_SWAP_AVX2_MIN && have_avx2()) {
+        done = swap16_avx2(dst, src, count);
+    }
+#endif
+#ifdef EXIF_SWAP_SSE2
+    done += swap16_sse2(dst + done, src + 2 * done, count - done);
+#endif
+#ifdef EXIF_SWAP_WASM
+    done += swap16_wasm(dst + done, src + 2 * done, count - done);
+#endif
+    swap16_scalar(dst + done, src + 2 * done, count - done);            // Tail, or everything without SIMD
+}
+
+void exif_load_u32(uint32_t *dst, const uint8_t *src, size_t count, bool big_endian) {
+
+    if (big_endian == EXIF_HOST_BIG_ENDIAN) {                           // Already in host order
+        memcpy(dst, src, count * sizeof(uint32_t));
+        return;
+    }
+
+    size_t done = 0;
+#ifdef EXIF_SWAP_AVX2
+    if (count >= EXIF_SWAP_AVX2_MIN && have_avx2()) {
+        done = swap32_avx2(dst, src, count);
+    }
+#endif
+#ifdef EXIF_SWAP_SSE2
+    done += swap32_sse2(dst + done, src + 4 * done, count - done);
+#endif
+#ifdef EXIF_SWAP_WASM
+    done += swap32_wasm(dst + done, src + 4 * done, count - done);
+#endif
+    swap32_scalar(dst + done, src + 4 * done, count - done);            // Tail, or everything without SIMD
+}
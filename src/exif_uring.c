@@ -0,0 +1,417 @@
+/*
+ * @file            src/exif_uring.c
+ * @description     Batch prefix reader that keeps many reads in flight on io_uring
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 12:48:20
+ * @lastModified    2026-10-17 12:48:20
+ */
+
+#define _POSIX_C_SOURCE 200809L                                         // posix_fadvise
+#define _DEFAULT_SOURCE                                                 // syscall
+
+#include "exif_uring.h"
+#include "exif_batch.h"
+#include "exif_io.h"
+#include "exif_parser.h"
+#include "format_reader.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// The ring is driven with raw syscalls so liburing is not a dependency. Any
+// other platform, or kernel headers without io_uring, builds the stubs below.
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define EXIF_HAVE_URING 1
+#endif
+#endif
+#endif
+
+#ifdef EXIF_HAVE_URING
+
+// ** Ring state ** //
+
+// Submission and completion rings shared with the kernel
+typedef struct {
+    int fd;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    size_t sqes_size;
+    unsigned to_submit;                                                 // Queued since the last io_uring_enter
+} Ring;
+
+// One file being read, its prefix grows the same way exif_read_prefix does
+typedef struct {
+    size_t index;
+    int fd;
+    uint8_t *data;
+    size_t have;                                                        // Bytes of the prefix read so far
+    size_t window;                                                      // Bytes the current read is filling up to
+    size_t file_size;
+    struct iovec iov;
+} ReadSlot;
+
+typedef struct {
+    const char *const *paths;
+    ExifBatchCallback callback;
+    void *user;
+} Reporter;
+
+// **** RING HELPERS **** //
+
+static void ring_close(Ring *ring) {
+    if (ring->sqes != NULL) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_map != NULL && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if (ring->sq_map != NULL) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    close(ring->fd);
+}
+
+static void *ring_map(int fd, size_t size, off_t offset) {
+    void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    return (map == MAP_FAILED) ? NULL : map;
+}
+
+static bool ring_open(Ring *ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;  // Both rings share one mapping since 5.4
+
+    if (single_map && ring->cq_map_size > ring->sq_map_size) {
+        ring->sq_map_size = ring->cq_map_size;
+    }
+
+    ring->sq_map = ring_map(ring->fd, ring->sq_map_size, IORING_OFF_SQ_RING);
+    ring->cq_map = single_map ? ring->sq_map : ring_map(ring->fd, ring->cq_map_size, IORING_OFF_CQ_RING);
+    ring->sqes = ring_map(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+    if (ring->sq_map == NULL || ring->cq_map == NULL || ring->sqes == NULL) {
+        ring_close(ring);
+        return false;
+    }
+
+    char *sq = ring->sq_map;
+    char *cq = ring->cq_map;
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+}
+
+// Queues a read of the rest of the slot's window. Every slot has at most one
+// read outstanding and the ring has an entry per slot, so it never fills up.
+static void ring_queue_read(Ring *ring, ReadSlot *slot, unsigned id) {
+    unsigned tail = *ring->sq_tail;                                     // Only this thread moves the tail
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[idx];
+
+    slot->iov.iov_base = slot->data + slot->have;
+    slot->iov.iov_len = slot->window - slot->have;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;                                      // READV is in every io_uring kernel, READ needs 5.6
+    sqe->fd = slot->fd;
+    sqe->off = slot->have;
+    sqe->addr = (uint64_t)(uintptr_t)&slot->iov;
+    sqe->len = 1;
+    sqe->user_data = id;
+
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);        // Publish the entry before the kernel sees the tail
+    ring->to_submit++;
+}
+
+// **** HELPERS **** //
+
+static void report(const Reporter *reporter, size_t index, ErrorCode status, char *json) {
+    reporter->callback(index, reporter->paths[index], status, json, reporter->user);
+}
+
+static void finish_slot(const Reporter *reporter, ReadSlot *slot, ErrorCode status, char *json) {
+    report(reporter, slot->index, status, json);
+    free(slot->data);
+    slot->data = NULL;
+    close(slot->fd);
+}
+
+// Reads the whole prefix with pread, used once the ring can no longer be trusted
+static void finish_sync(const Reporter *reporter, size_t index, int fd) {
+    char *json = NULL;
+    ErrorCode status = ERR_IO;
+
+    if (fd >= 0) {
+        status = exif_json_fd(fd, &json);
+        close(fd);
+    }
+    report(reporter, index, status, json);
+}
+
+// Opens the paths up to depth ahead of the next read and asks the kernel to
+// start pulling their first window into the page cache
+static void open_ahead(const char *const *paths, size_t count, int *ahead, unsigned depth, size_t started, size_t *opened) {
+    while (*opened < count && *opened < started + depth) {
+        int fd = open(paths[*opened], O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, EXIF_READ_WINDOW, POSIX_FADV_WILLNEED);
+        }
+        ahead[*opened % depth] = fd;
+        (*opened)++;
+    }
+}
+
+// Handles a finished read. Returns true once the slot has been reported and
+// can take the next path, false while another read is outstanding.
+static bool read_done(Ring *ring, const Reporter *reporter, ReadSlot *slot, unsigned id, int res) {
+
+    if (res == -EINTR || res == -EAGAIN) {                              // Nothing was read, try again
+        ring_queue_read(ring, slot, id);
+        return false;
+    }
+    if (res < 0) {
+        finish_slot(reporter, slot, ERR_IO, NULL);
+        return true;
+    }
+
+    slot->have += (size_t)res;
+    if (res > 0 && slot->have < slot->window) {                         // Short read before end of file, read the rest
+        ring_queue_read(ring, slot, id);
+        return false;
+    }
+
+    // Other formats are only recognised from the first window, their readers
+    // then fetch the few headers and the EXIF block with pread
+    ImageFormat format = readImageFormat(slot->data, slot->have);
+    if (format != IMAGE_FORMAT_JPEG && format != IMAGE_FORMAT_UNKNOWN) {
+        char *json = NULL;
+        ErrorCode status = exif_json_fd(slot->fd, &json);
+        finish_slot(reporter, slot, status, json);
+        return true;
+    }
+
+    size_t next_window = 0;
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+    ErrorCode status = exif_prefix_step(slot->data, slot->have, slot->window, slot->file_size, &next_window, &tiff_offset,
+                                        &tiff_length);
+
+    if (status == ERR_TRUNCATED && next_window > 0) {                   // The prefix needs to grow
+        uint8_t *temp = realloc(slot->data, next_window);
+        if (temp == NULL) {
+            finish_slot(reporter, slot, ERR_MALLOC, NULL);
+            return true;
+        }
+        slot->data = temp;
+        slot->window = next_window;
+        ring_queue_read(ring, slot, id);
+        return false;
+    }
+
+    char *json = NULL;
+    if (status == ERR_OK) {
+        status = exif_json_tiff(slot->data + tiff_offset, tiff_length, &json);
+    }
+    finish_slot(reporter, slot, status, json);
+    return true;
+}
+
+// Starts reading a path. Returns true when a read is outstanding, false when
+// the path was reported straight away.
+static bool start_read(Ring *ring, const Reporter *reporter, ReadSlot *slot, unsigned id, size_t index, int fd) {
+
+    if (fd < 0) {
+        report(reporter, index, ERR_IO, NULL);
+        return false;
+    }
+
+    struct stat st;
+    slot->index = index;
+    slot->fd = fd;
+    slot->have = 0;
+    slot->file_size = SIZE_MAX;                                         // Size unknown, a short read marks the end
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        slot->file_size = (size_t)st.st_size;
+    }
+    slot->window = (slot->file_size < EXIF_READ_WINDOW) ? slot->file_size : EXIF_READ_WINDOW;
+
+    slot->data = malloc(slot->window ? slot->window : 1);
+    if (slot->data == NULL) {
+        finish_slot(reporter, slot, ERR_MALLOC, NULL);
+        return false;
+    }
+
+    if (slot->window == 0) {                                            // Empty file, nothing to read
+        return !read_done(ring, reporter, slot, id, 0);
+    }
+
+    ring_queue_read(ring, slot, id);
+    return true;
+}
+
+// **** BATCH READER **** //
+
+bool exif_uring_available(void) {
+    Ring ring;
+    if (!ring_open(&ring, 1)) {
+        return false;
+    }
+    ring_close(&ring);
+    return true;
+}
+
+ErrorCode exif_uring_batch(const char *const *paths, size_t count, unsigned depth, ExifBatchCallback callback, void *user) {
+
+    if (depth == 0) {
+        depth = EXIF_URING_DEPTH;
+    }
+    if (depth > EXIF_URING_MAX_DEPTH) {                                 // Open files are twice the depth, stay under the fd limit
+        depth = EXIF_URING_MAX_DEPTH;
+    }
+    if (depth > count) {
+        depth = (count > 0) ? (unsigned)count : 1;
+    }
+
+    Ring ring;
+    if (!ring_open(&ring, depth)) {
+        return ERR_IO;
+    }
+
+    ReadSlot *slots = calloc(depth, sizeof(ReadSlot));
+    unsigned *free_ids = malloc(depth * sizeof(unsigned));             // Slots not reading anything
+    int *ahead = malloc(depth * sizeof(int));                          // Files opened ahead, by path index modulo depth
+    if (slots == NULL || free_ids == NULL || ahead == NULL) {
+        free(slots);
+        free(free_ids);
+        free(ahead);
+        ring_close(&ring);
+        return ERR_MALLOC;
+    }
+
+    Reporter reporter = { paths, callback, user };
+    unsigned free_count = depth;
+    for (unsigned id = 0; id < depth; id++) {
+        free_ids[id] = depth - 1 - id;
+    }
+
+    size_t opened = 0;                                                  // Paths opened so far
+    size_t started = 0;                                                 // Paths handed to a slot so far
+    unsigned active = 0;
+    bool broken = false;
+
+    while (started < count || active > 0) {
+
+        while (free_count > 0 && started < count) {                     // Keep every slot busy
+            open_ahead(paths, count, ahead, depth, started, &opened);
+            unsigned id = free_ids[free_count - 1];
+            size_t index = started++;
+
+            if (start_read(&ring, &reporter, &slots[id], id, index, ahead[index % depth])) {
+                free_count--;
+                active++;
+            }
+        }
+        if (active == 0) {
+            continue;
+        }
+
+        int submitted = (int)syscall(__NR_io_uring_enter, ring.fd, ring.to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {  // Nothing was taken, the queue is still intact
+                continue;
+            }
+            broken = true;
+            break;
+        }
+        ring.to_submit -= (unsigned)submitted;
+
+        unsigned head = *ring.cq_head;                                  // Only this thread moves the head
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            unsigned id = (unsigned)cqe->user_data;
+            int res = cqe->res;
+
+            head++;
+            if (read_done(&ring, &reporter, &slots[id], id, res)) {
+                free_ids[free_count++] = id;
+                active--;
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);          // Hand the entries back to the kernel
+    }
+
+    if (broken) {                                                       // Finish everything left with plain pread
+        for (unsigned id = 0; id < depth; id++) {
+            ReadSlot *slot = &slots[id];
+            if (slot->data != NULL) {
+                slot->data = NULL;                                      // The kernel may still write here, leave it allocated
+                finish_sync(&reporter, slot->index, slot->fd);
+            }
+        }
+        for (size_t index = started; index < count; index++) {
+            int fd = (index < opened) ? ahead[index % depth] : open(paths[index], O_RDONLY);
+            finish_sync(&reporter, index, fd);
+        }
+    }
+
+    ring_close(&ring);
+    free(slots);
+    free(free_ids);
+    free(ahead);
+    return ERR_OK;
+}
+
+#else
+
+bool exif_uring_available(void) {
+    return false;
+}
+
+ErrorCode exif_uring_batch(const char *const *paths, size_t count, unsigned depth, ExifBatchCallback callback, void *user) {
+    (void)paths;
+    (void)count;
+    (void)depth;
+    (void)callback;
+    (void)user;
+    return ERR_IO;
+}
+
+#endif // EXIF_HAVE_URING
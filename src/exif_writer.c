@@ -0,0 +1,215 @@
+/*
+ * @file            src/exif_writer.c
+ * @description     Writes TIFF blocks and JPEG files holding chosen EXIF entries
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 14:05:37
+ * @lastModified    2026-10-17 14:05:37
+ */
+
+#include "exif_writer.h"
+#include "exif_parser.h"
+#include "output_builder.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// **** HELPERS **** //
+
+// Bytes per component of each TIFF type, 0 for unknown types
+static const uint8_t type_sizes[13] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8 };
+
+static size_t type_size(uint16_t type) {
+    return (type < sizeof(type_sizes)) ? type_sizes[type] : 0;
+}
+
+static size_t value_size(const ExifWriterEntry *entry) {
+    return type_size(entry->type) * entry->count;
+}
+
+static void put_u16(OutputBuilder *output, uint16_t value, bool big_endian) {
+    char bytes[2];
+    bytes[big_endian ? 0 : 1] = (char)(value >> 8);
+    bytes[big_endian ? 1 : 0] = (char)value;
+    builder_append(output, bytes, 2);
+}
+
+static void put_u32(OutputBuilder *output, uint32_t value, bool big_endian) {
+    put_u16(output, (uint16_t)(big_endian ? value >> 16 : value), big_endian);
+    put_u16(output, (uint16_t)(big_endian ? value : value >> 16), big_endian);
+}
+
+static void put_fill(OutputBuilder *output, char fill, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        builder_putc(output, fill);
+    }
+}
+
+// Writes the components of an entry in the block's byte order
+static void put_values(OutputBuilder *output, const ExifWriterEntry *entry, bool big_endian) {
+    const uint8_t *values = entry->values;
+    size_t size = value_size(entry);
+
+    switch (type_size(entry->type)) {
+        case 2: {
+            for (size_t i = 0; i < size; i += 2) {
+                uint16_t value;
+                memcpy(&value, values + i, 2);
+                put_u16(output, value, big_endian);
+            }
+            break;
+        }
+        case 4:
+        case 8: {
+            if (entry->type == EXIF_TYPE_DOUBLE) {                      // One 64 bit value, high word first in MM
+                for (size_t i = 0; i < size; i += 8) {
+                    uint64_t value;
+                    memcpy(&value, values + i, 8);
+                    put_u32(output, (uint32_t)(big_endian ? value >> 32 : value), big_endian);
+                    put_u32(output, (uint32_t)(big_endian ? value : value >> 32), big_endian);
+                }
+                break;
+            }
+            for (size_t i = 0; i < size; i += 4) {                      // LONG, FLOAT and both halves of a RATIONAL
+                uint32_t value;
+                memcpy(&value, values + i, 4);
+                put_u32(output, value, big_endian);
+            }
+            break;
+        }
+        default: {
+            builder_append(output, (const char *)values, size);
+            break;
+        }
+    }
+}
+
+// Bytes an IFD takes including its out of line values, each kept word aligned
+static size_t ifd_size(const ExifWriterEntry *entries, size_t count, bool pointer) {
+    size_t size = 2 + 12 * (count + (pointer ? 1 : 0)) + 4;
+
+    for (size_t i = 0; i < count; i++) {
+        size_t bytes = value_size(&entries[i]);
+        if (bytes > 4) {
+            size += bytes + (bytes & 1);
+        }
+    }
+    return size;
+}
+
+// Writes an IFD that starts at offset within the TIFF block, followed by its
+// out of line values. A pointer entry is appended last when pointer_tag is set.
+static void put_ifd(OutputBuilder *output, size_t offset, const ExifWriterEntry *entries, size_t count,
+                    uint16_t pointer_tag, uint32_t pointer, bool big_endian) {
+
+    size_t total = count + (pointer_tag ? 1 : 0);
+    size_t data_offset = offset + 2 + 12 * total + 4;                   // Values follow the next IFD offset
+
+    put_u16(output, (uint16_t)total, big_endian);
+    for (size_t i = 0; i < count; i++) {
+        const ExifWriterEntry *entry = &entries[i];
+        size_t bytes = value_size(entry);
+
+        put_u16(output, entry->tag, big_endian);
+        put_u16(output, entry->type, big_endian);
+        put_u32(output, entry->count, big_endian);
+
+        if (bytes > 4) {
+            put_u32(output, (uint32_t)data_offset, big_endian);
+            data_offset += bytes + (bytes & 1);
+        } else {                                                        // Inline and left aligned in the field
+            put_values(output, entry, big_endian);
+            put_fill(output, 0, 4 - bytes);
+        }
+    }
+
+    if (pointer_tag) {
+        put_u16(output, pointer_tag, big_endian);
+        put_u16(output, EXIF_TYPE_LONG, big_endian);
+        put_u32(output, 1, big_endian);
+        put_u32(output, pointer, big_endian);
+    }
+    put_u32(output, 0, big_endian);                                     // No next IFD
+
+    for (size_t i = 0; i < count; i++) {
+        size_t bytes = value_size(&entries[i]);
+        if (bytes > 4) {
+            put_values(output, &entries[i], big_endian);
+            put_fill(output, 0, bytes & 1);
+        }
+    }
+}
+
+static void put_segment_header(OutputBuilder *output, uint8_t marker, size_t payload) {
+    char header[4] = { (char)0xFF, (char)marker, (char)((payload + 2) >> 8), (char)(payload + 2) };
+    builder_append(output, header, 4);
+}
+
+// Drops a partial write and reports why it could not complete
+static ErrorCode finish_write(OutputBuilder *output, size_t base) {
+    if (output->failed || builder_overflowed(output)) {
+        ErrorCode status = output->failed ? ERR_MALLOC : ERR_TOO_SMALL;
+        builder_rewind(output, base);
+        return status;
+    }
+    return ERR_OK;
+}
+
+// **** TIFF AND JPEG WRITERS **** //
+
+ErrorCode exif_write_tiff(OutputBuilder *output, bool big_endian, const ExifWriterEntry *ifd0, size_t ifd0_count,
+                          const ExifWriterEntry *exif, size_t exif_count) {
+
+    for (size_t i = 0; i < ifd0_count + exif_count; i++) {              // Reject types we cannot size, even with no values
+        const ExifWriterEntry *entry = (i < ifd0_count) ? &ifd0[i] : &exif[i - ifd0_count];
+        if (type_size(entry->type) == 0) {
+            return ERR_INVALID_TAG;
+        }
+    }
+
+    size_t base = output->len;
+    bool has_exif = exif_count > 0;
+    size_t exif_offset = 8 + ifd_size(ifd0, ifd0_count, has_exif);
+
+    builder_append(output, big_endian ? "MM" : "II", 2);
+    put_u16(output, 0x002A, big_endian);
+    put_u32(output, 8, big_endian);                                     // IFD0 right after the header
+
+    put_ifd(output, 8, ifd0, ifd0_count, has_exif ? 0x8769 : 0, (uint32_t)exif_offset, big_endian);
+    if (has_exif) {
+        put_ifd(output, exif_offset, exif, exif_count, 0, 0, big_endian);
+    }
+
+    return finish_write(output, base);
+}
+
+ErrorCode exif_write_jpeg(OutputBuilder *output, const uint8_t *tiff, size_t tiff_length, const ExifJpegLayout *layout) {
+
+    if ((layout->exif && tiff_length > EXIF_WRITER_MAX_TIFF) || layout->app2_size > 0xFFFF - 2) {
+        return ERR_EXIF_OVERFLOW;
+    }
+
+    size_t base = output->len;
+    builder_append(output, "\xFF\xD8", 2);                              // SOI
+
+    for (size_t i = 0; i < layout->app2_count; i++) {                   // ICC style blocks ahead of the EXIF
+        put_segment_header(output, 0xE2, layout->app2_size);
+        put_fill(output, 0, layout->app2_size);
+    }
+
+    if (layout->exif) {
+        put_segment_header(output, 0xE1, 6 + tiff_length);
+        builder_append(output, "Exif\0\0", 6);
+        builder_append(output, (const char *)tiff, tiff_length);
+    }
+
+    put_segment_header(output, 0xC0, 9);                                // SOF0 for an 8x8 image with one component
+    builder_append(output, "\x08\x00\x08\x00\x08\x01\x01\x11\x00", 9);
+
+    put_segment_header(output, 0xDA, 10);                               // SOS header, contents are not decoded
+    put_fill(output, 0, 10);
+    put_fill(output, 0x55, layout->scan_size);
+    builder_append(output, "\xFF\xD9", 2);                              // EOI
+
+    return finish_write(output, base);
+}
@@ -1,9 +1,14 @@
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "format_reader.h"
 #include "exif_parser.h"
+#include "jpeg_segments.h"
+#include "heif_boxes.h"
+#include "png_chunks.h"
+#include "webp_chunks.h"
 
 
 
@@ -14,54 +19,182 @@
 //////// ** ////////
 
 bool is_jpeg(const uint8_t *buffer, size_t length) {
+    JpegIndex index;
+    return is_jpeg_indexed(buffer, length, &index);
+}
+
+bool is_jpeg_indexed(const uint8_t *buffer, size_t length, JpegIndex *index) {
+
+    // walks every segment up to the scan once, checking the lengths and that
+    // a frame header and SOS are present, the table is kept for the parse
+    return jpeg_index_build(buffer, length, index, NULL) == ERR_OK;
+}
+
+bool is_png(const uint8_t *buffer, size_t length) {
+    return readImageFormat(buffer, length) == IMAGE_FORMAT_PNG;
+}
+
+bool is_avif(const uint8_t *buffer, size_t length) {
+    return readImageFormat(buffer, length) == IMAGE_FORMAT_AVIF;
+}
+
+bool is_heic(const uint8_t *buffer, size_t length) {
+    return readImageFormat(buffer, length) == IMAGE_FORMAT_HEIC;
+}
+
+bool is_webp(const uint8_t *buffer, size_t length) {
+    return readImageFormat(buffer, length) == IMAGE_FORMAT_WEBP;
+}
 
-    const uint16_t SOI = 0xFFD8;
-    const uint16_t EOI = 0xFFD9;
 
 
-    // check first two bytes as jpeg start of image
-    if (((buffer[0] << 8) | buffer[1]) != SOI) {
+//////// ** ////////
+//   SIGNATURES   //
+//////// ** ////////
+
+// A signature is a run of bytes at the start of the file and an optional
+// second run further in, for containers that put a size field before their
+// brand. Every byte checked is inside FORMAT_SNIFF_BYTES.
+typedef struct {
+    uint8_t format;                 // One of ImageFormat
+    uint8_t head_length;
+    const char *head;               // At offset 0
+    uint8_t tail_offset;
+    uint8_t tail_length;
+    const char *tail;
+} FormatSignature;
+
+#define SIGNATURE(format, head) { (format), sizeof(head) - 1, (head), 0, 0, NULL }
+#define SIGNATURE_AT(format, head, offset, tail) { (format), sizeof(head) - 1, (head), (offset), sizeof(tail) - 1, (tail) }
+
+static const FormatSignature signatures[] = {
+    SIGNATURE(IMAGE_FORMAT_JPEG, "\xFF\xD8\xFF"),
+    SIGNATURE(IMAGE_FORMAT_PNG, PNG_SIGNATURE),
+    SIGNATURE_AT(IMAGE_FORMAT_WEBP, "RIFF", 8, "WEBP"),
+    SIGNATURE(IMAGE_FORMAT_TIFF, "II\x2A\x00"),
+    SIGNATURE(IMAGE_FORMAT_TIFF, "MM\x00\x2A"),
+    SIGNATURE(IMAGE_FORMAT_JXL, "\xFF\x0A"),                               // Bare codestream
+    SIGNATURE(IMAGE_FORMAT_JXL, JXL_SIGNATURE),                            // Box container
+    SIGNATURE_AT(IMAGE_FORMAT_AVIF, "", 4, "ftypavif"),
+    SIGNATURE_AT(IMAGE_FORMAT_AVIF, "", 4, "ftypavis"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftypheic"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftypheix"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftyphevc"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftyphevx"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftypheim"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftypheis"),
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftypmif1"),                   // Generic HEIF, may still be AVIF
+    SIGNATURE_AT(IMAGE_FORMAT_HEIC, "", 4, "ftypmsf1"),
+};
+
+#undef SIGNATURE
+#undef SIGNATURE_AT
+
+static bool matches(const uint8_t *buffer, size_t length, const FormatSignature *signature) {
+    if (length < signature->head_length || length < (size_t)signature->tail_offset + signature->tail_length) {
         return false;
     }
+    return memcmp(buffer, signature->head, signature->head_length) == 0 &&
+           (signature->tail_length == 0 || memcmp(buffer + signature->tail_offset, signature->tail, signature->tail_length) == 0);
+}
 
-    // check last two bytes as jpeg end of image
-    if(((buffer[length - 2] << 8) | buffer[length - 1]) != EOI) {
-        return false;
+// A generic HEIF major brand leaves the codec to the compatible brands that
+// follow it in the ftyp box
+static ImageFormat heif_brand(const uint8_t *buffer, size_t length) {
+    size_t box = ((size_t)buffer[0] << 24) | ((size_t)buffer[1] << 16) | ((size_t)buffer[2] << 8) | buffer[3];
+    size_t end = (box < length) ? box : length;
+    if (end > FORMAT_SNIFF_BYTES) {
+        end = FORMAT_SNIFF_BYTES;
     }
 
+    for (size_t i = 16; i + 4 <= end; i += 4) {                         // Past size, type, major brand and version
+        if (memcmp(buffer + i, "avif", 4) == 0 || memcmp(buffer + i, "avis", 4) == 0) {
+            return IMAGE_FORMAT_AVIF;
+        }
+    }
+    return IMAGE_FORMAT_HEIC;
+}
 
-    // File is jpeg
-    return true;
+ImageFormat readImageFormat(const uint8_t *buffer, size_t length) {
 
-    // TODO check these
-    // 1. walk through each segment (marker starts with 0xFF)
-    // 2. handle segment lengths
-    // 3. skip or parse APPO/APP1 segments
-    // 4. ensure there's at least one SOS and one EOI marker
-    // 5. Validate no bad lengths or crashes
+    if (length > FORMAT_SNIFF_BYTES) {                                  // Never look further than the signatures need
+        length = FORMAT_SNIFF_BYTES;
+    }
 
+    for (size_t i = 0; i < sizeof(signatures) / sizeof(signatures[0]); i++) {
+        if (matches(buffer, length, &signatures[i])) {
+            ImageFormat format = (ImageFormat)signatures[i].format;
+            if (format == IMAGE_FORMAT_HEIC && (memcmp(buffer + 8, "mif1", 4) == 0 || memcmp(buffer + 8, "msf1", 4) == 0)) {
+                return heif_brand(buffer, length);
+            }
+            return format;
+        }
+    }
+    return IMAGE_FORMAT_UNKNOWN;
 }
 
-bool is_png() {
-    return false;
-}
 
-bool is_avif() {
-    return false;
-}
 
-bool is_heic() {
-    return false;
+//////// ** ////////
+// EXIF LOCATORS  //
+//////// ** ////////
+
+// A TIFF file is its own EXIF block
+static ErrorCode tiff_locate(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed) {
+    (void)buffer;
+    (void)needed;
+    *tiff_offset = 0;
+    *tiff_length = length;
+    return ERR_OK;
 }
 
-bool is_webp() {
-    return false;
+ExifLocator exif_locator(ImageFormat format) {
+    switch (format) {
+        case IMAGE_FORMAT_JPEG:
+            return jpeg_find_exif;
+        case IMAGE_FORMAT_PNG:
+            return png_find_exif;
+        case IMAGE_FORMAT_WEBP:
+            return webp_find_exif;
+        case IMAGE_FORMAT_HEIC:
+        case IMAGE_FORMAT_AVIF:
+            return heif_find_exif;
+        case IMAGE_FORMAT_TIFF:
+            return tiff_locate;
+        case IMAGE_FORMAT_JXL:
+            return jxl_find_exif;
+        default:
+            return NULL;
+    }
 }
 
+ErrorCode exif_locate(const uint8_t *buffer, size_t length, ImageFormat *format, size_t *tiff_offset, size_t *tiff_length,
+                      size_t *needed) {
 
-uint8_t readImageFormat(const uint8_t *buffer, size_t length) {
-    if(is_jpeg(buffer, length)) {
-        // parse the image
+    ImageFormat found = readImageFormat(buffer, length);
+    ExifLocator locate = exif_locator(found);
+
+    if (format != NULL) {
+        *format = found;
+    }
+    if (locate == NULL) {
+        return ERR_EXIF_MISSING;
     }
+    return locate(buffer, length, tiff_offset, tiff_length, needed);
+}
+
+char *parse_image(const uint8_t *buffer, size_t length) {
 
-}
\ No newline at end of file
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+    ImageFormat format = readImageFormat(buffer, length);
+
+    if (format == IMAGE_FORMAT_JPEG) {                                  // One marker walk, keeps the error strings of parse_jpeg
+        JpegIndex index;
+        return parse_jpeg_keep_index(buffer, length, &index);
+    }
+    if (exif_locate(buffer, length, NULL, &tiff_offset, &tiff_length, NULL) != ERR_OK) {
+        return NULL;
+    }
+    return parse_tiff(buffer + tiff_offset, tiff_length);
+}
@@ -0,0 +1,348 @@
+/*
+ * @file            src/heif_boxes.c
+ * @description     Finds the Exif item of a HEIC or AVIF through the meta, iinf and iloc boxes
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 20:41:18
+ * @lastModified    2026-10-17 20:41:18
+ */
+
+#include "heif_boxes.h"
+#include "exif_parser.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// **** HELPERS **** //
+
+// Big endian reads that fail once past the end instead of reading past it
+typedef struct {
+    const uint8_t *data;
+    size_t length;
+    size_t pos;
+    bool ok;
+} BoxReader;
+
+static uint64_t take(BoxReader *reader, size_t bytes) {                 // bytes is at most 8, 0 reads nothing
+    uint64_t value = 0;
+
+    if (!reader->ok || bytes > reader->length - reader->pos) {
+        reader->ok = false;
+        return 0;
+    }
+    for (size_t i = 0; i < bytes; i++) {
+        value = (value << 8) | reader->data[reader->pos + i];
+    }
+    reader->pos += bytes;
+    return value;
+}
+
+// A box header at offset: its type, where its payload starts and its size.
+// A size of 0 runs to the end of the enclosing data and is left to the caller.
+typedef struct {
+    const uint8_t *type;
+    size_t header;
+    uint64_t size;
+} BoxHeader;
+
+static bool read_box(const uint8_t *buffer, size_t length, size_t offset, BoxHeader *box) {
+    BoxReader reader = { buffer, length, offset, offset <= length };
+
+    box->size = take(&reader, 4);
+    box->type = buffer + offset + 4;
+    take(&reader, 4);
+    box->header = HEIF_BOX_HEADER;
+    if (box->size == 1) {                                               // 64 bit size after the type
+        box->size = take(&reader, 8);
+        box->header = HEIF_LARGE_BOX_HEADER;
+    }
+    return reader.ok;
+}
+
+// Walks the child boxes of a payload for the first of a type
+static bool find_child(const uint8_t *payload, size_t length, size_t start, const char *type, size_t *child, size_t *child_length) {
+    BoxHeader box;
+    size_t i = start;
+
+    while (read_box(payload, length, i, &box)) {
+        uint64_t size = (box.size == 0) ? length - i : box.size;
+        if (size < box.header || size > length - i) {                   // Corrupt, or cut off by the parent
+            return false;
+        }
+        if (memcmp(box.type, type, 4) == 0) {
+            *child = i + box.header;
+            *child_length = (size_t)size - box.header;
+            return true;
+        }
+        i += (size_t)size;
+    }
+    return false;
+}
+
+// The item_ID of the first item whose infe entry has type Exif
+static bool find_exif_id(const uint8_t *iinf, size_t length, uint32_t *id) {
+    BoxReader reader = { iinf, length, 0, true };
+    uint8_t version = (uint8_t)(take(&reader, 4) >> 24);               // Version, then 24 bits of flags
+
+    take(&reader, version == 0 ? 2 : 4);                                // entry_count, the boxes say as much
+    if (!reader.ok) {
+        return false;
+    }
+
+    BoxHeader box;
+    size_t i = reader.pos;
+    while (read_box(iinf, length, i, &box)) {
+        uint64_t size = (box.size == 0) ? length - i : box.size;
+        if (size < box.header || size > length - i) {
+            return false;
+        }
+
+        if (memcmp(box.type, "infe", 4) == 0) {                         // Only versions 2 and 3 carry an item type
+            BoxReader entry = { iinf + i + box.header, (size_t)size - box.header, 0, true };
+            uint8_t entry_version = (uint8_t)(take(&entry, 4) >> 24);
+            if (entry_version >= 2) {
+                uint32_t item_id = (uint32_t)take(&entry, entry_version == 2 ? 2 : 4);
+                take(&entry, 2);                                        // item_protection_index
+                if (entry.ok && entry.pos + 4 <= entry.length && memcmp(entry.data + entry.pos, "Exif", 4) == 0) {
+                    *id = item_id;
+                    return true;
+                }
+            }
+        }
+        i += (size_t)size;
+    }
+    return false;
+}
+
+// The location of one item in iloc. Extents that follow each other are
+// joined, the Exif item is read as one run or not at all.
+static bool find_location(const uint8_t *iloc, size_t length, uint32_t id, uint8_t *method, HeifItem *item) {
+    BoxReader reader = { iloc, length, 0, true };
+    uint8_t version = (uint8_t)(take(&reader, 4) >> 24);
+
+    if (version > 2) {
+        return false;
+    }
+
+    uint8_t sizes = (uint8_t)take(&reader, 1);
+    uint8_t more_sizes = (uint8_t)take(&reader, 1);
+    size_t offset_size = sizes >> 4;
+    size_t length_size = sizes & 0x0F;
+    size_t base_offset_size = more_sizes >> 4;
+    size_t index_size = (version == 0) ? 0 : (more_sizes & 0x0F);       // Reserved in version 0
+    if (offset_size > 8 || length_size > 8 || base_offset_size > 8 || index_size > 8) {
+        return false;
+    }
+
+    uint32_t item_count = (uint32_t)take(&reader, version < 2 ? 2 : 4);
+
+    for (uint32_t n = 0; n < item_count && reader.ok; n++) {
+        uint32_t item_id = (uint32_t)take(&reader, version < 2 ? 2 : 4);
+        uint8_t construction = (version == 0) ? 0 : (uint8_t)(take(&reader, 2) & 0x0F);
+        take(&reader, 2);                                               // data_reference_index, 0 is this file
+        uint64_t base = take(&reader, base_offset_size);
+        uint16_t extent_count = (uint16_t)take(&reader, 2);
+
+        uint64_t start = 0;
+        uint64_t total = 0;
+        for (uint16_t e = 0; e < extent_count && reader.ok; e++) {
+            take(&reader, index_size);
+            uint64_t extent_offset = base + take(&reader, offset_size);
+            uint64_t extent_length = take(&reader, length_size);
+
+            if (item_id != id) {
+                continue;
+            }
+            if (e == 0) {
+                start = extent_offset;
+            } else if (extent_offset != start + total) {                // Scattered extents, not one run
+                return false;
+            }
+            total += extent_length;
+        }
+
+        if (reader.ok && item_id == id) {
+            if (extent_count == 0 || total == 0) {                      // A length of 0 means the rest of the file
+                return false;
+            }
+            *method = construction;
+            item->offset = start;
+            item->length = total;
+            return true;
+        }
+    }
+    return false;
+}
+
+// **** BOX WALK **** //
+
+// Jumps over the top level boxes until the first of a type, whose payload
+// may not be larger than HEIF_MAX_METADATA
+static ErrorCode scan_boxes(const uint8_t *buffer, size_t length, size_t *offset, const char *type, size_t *payload_offset,
+                            size_t *payload_length) {
+
+    size_t i = *offset;
+    BoxHeader box;
+
+    while (read_box(buffer, length, i, &box)) {                         // Jump from box header to box header
+
+        *offset = i;
+        if (box.size == 0 || box.size < box.header) {                   // Runs to the end of the file, or corrupt
+            return ERR_EXIF_MISSING;
+        }
+
+        if (memcmp(box.type, type, 4) == 0) {
+            if (box.size > HEIF_MAX_METADATA) {
+                return ERR_EXIF_MISSING;
+            }
+            *payload_offset = i + box.header;
+            *payload_length = (size_t)box.size - box.header;
+            return ERR_OK;
+        }
+
+        if (box.size > SIZE_MAX - i) {
+            return ERR_EXIF_MISSING;
+        }
+        i += (size_t)box.size;                                          // Skip the payload unread, mdat included
+    }
+
+    *offset = i;
+    return ERR_TRUNCATED;
+}
+
+ErrorCode heif_scan_boxes(const uint8_t *buffer, size_t length, size_t *offset, size_t *meta_offset, size_t *meta_length) {
+    return scan_boxes(buffer, length, offset, "meta", meta_offset, meta_length);
+}
+
+ErrorCode heif_exif_item(const uint8_t *meta, size_t meta_length, HeifItem *item) {
+
+    size_t iinf = 0, iinf_length = 0;
+    size_t iloc = 0, iloc_length = 0;
+    size_t idat = 0, idat_length = 0;
+    uint32_t id = 0;
+    uint8_t method = 0;
+
+    if (meta_length < 4 ||                                              // Version and flags come before the children
+        !find_child(meta, meta_length, 4, "iinf", &iinf, &iinf_length) ||
+        !find_child(meta, meta_length, 4, "iloc", &iloc, &iloc_length) ||
+        !find_exif_id(meta + iinf, iinf_length, &id) ||
+        !find_location(meta + iloc, iloc_length, id, &method, item)) {
+        return ERR_EXIF_MISSING;
+    }
+
+    item->in_meta = false;
+    if (method == 1) {                                                  // Offsets into the idat box of meta
+        if (!find_child(meta, meta_length, 4, "idat", &idat, &idat_length) ||
+            item->offset > idat_length || item->length > idat_length - item->offset) {
+            return ERR_EXIF_MISSING;
+        }
+        item->offset += idat;
+        item->in_meta = true;
+    } else if (method != 0) {                                           // Built from other items
+        return ERR_EXIF_MISSING;
+    }
+
+    if (item->length > HEIF_MAX_METADATA) {
+        return ERR_EXIF_MISSING;
+    }
+    return ERR_OK;
+}
+
+ErrorCode heif_exif_payload(const uint8_t *data, size_t length, size_t *tiff_offset, size_t *tiff_length) {
+
+    BoxReader reader = { data, length, 0, true };
+    uint64_t skip = take(&reader, 4);                                   // exif_tiff_header_offset
+
+    if (!reader.ok || skip > length - 4) {
+        return ERR_TIFF_MISSING;
+    }
+    *tiff_offset = 4 + (size_t)skip;
+    *tiff_length = length - *tiff_offset;
+    return ERR_OK;
+}
+
+ErrorCode heif_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed) {
+
+    size_t offset = 0;
+    size_t meta_offset = 0;
+    size_t meta_length = 0;
+    HeifItem item;
+
+    if (length >= HEIF_BOX_HEADER && memcmp(buffer + 4, "ftyp", 4) != 0) {
+        return ERR_EXIF_MISSING;
+    }
+
+    ErrorCode status = heif_scan_boxes(buffer, length, &offset, &meta_offset, &meta_length);
+
+    if (status == ERR_OK && meta_offset + meta_length > length) {       // The whole meta box is needed
+        if (needed != NULL) {
+            *needed = meta_offset + meta_length;
+        }
+        return ERR_TRUNCATED;
+    }
+    if (status == ERR_TRUNCATED) {                                      // Room for a 64 bit box size
+        if (needed != NULL) {
+            *needed = offset + HEIF_LARGE_BOX_HEADER;
+        }
+        return status;
+    }
+    if (status != ERR_OK) {
+        return status;
+    }
+
+    status = heif_exif_item(buffer + meta_offset, meta_length, &item);
+    if (status != ERR_OK) {
+        return status;
+    }
+
+    size_t start = (size_t)item.offset + (item.in_meta ? meta_offset : 0);
+    if (item.offset > length || start + item.length > length) {         // If the Exif item extends past image buffer
+        if (needed != NULL) {
+            *needed = start + (size_t)item.length;
+        }
+        return ERR_TIFF_OVERFLOW;
+    }
+
+    status = heif_exif_payload(buffer + start, (size_t)item.length, tiff_offset, tiff_length);
+    *tiff_offset += start;
+    return status;
+}
+
+// **** JPEG XL **** //
+
+ErrorCode jxl_scan_boxes(const uint8_t *buffer, size_t length, size_t *offset, size_t *exif_offset, size_t *exif_length) {
+    return scan_boxes(buffer, length, offset, "Exif", exif_offset, exif_length);
+}
+
+ErrorCode jxl_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed) {
+
+    size_t offset = 0;
+    size_t exif_offset = 0;
+    size_t exif_length = 0;
+
+    if (length < JXL_SIGNATURE_LENGTH || memcmp(buffer, JXL_SIGNATURE, JXL_SIGNATURE_LENGTH) != 0) {
+        return ERR_EXIF_MISSING;                                        // A bare codestream has nowhere to keep EXIF
+    }
+
+    ErrorCode status = jxl_scan_boxes(buffer, length, &offset, &exif_offset, &exif_length);
+
+    if (status == ERR_TRUNCATED) {                                      // Room for a 64 bit box size
+        if (needed != NULL) {
+            *needed = offset + HEIF_LARGE_BOX_HEADER;
+        }
+        return status;
+    }
+    if (status != ERR_OK) {
+        return status;
+    }
+    if (exif_offset + exif_length > length) {                           // If the Exif box extends past image buffer
+        if (needed != NULL) {
+            *needed = exif_offset + exif_length;
+        }
+        return ERR_TIFF_OVERFLOW;
+    }
+
+    status = heif_exif_payload(buffer + exif_offset, exif_length, tiff_offset, tiff_length);
+    *tiff_offset += exif_offset;
+    return status;
+}
@@ -0,0 +1,231 @@
+/*
+ * @file            src/jpeg_segments.c
+ * @description     One pass over the JPEG markers that validates them and records every segment
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 18:02:11
+ * @lastModified    2026-10-17 18:02:11
+ */
+
+#include "jpeg_segments.h"
+#include "exif_parser.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// **** HELPERS **** //
+
+static void record_segment(JpegIndex *index, uint8_t marker, uint16_t length, size_t offset) {
+    if (index->count < JPEG_MAX_SEGMENTS) {
+        JpegSegment *segment = &index->segments[index->count++];
+        segment->marker = marker;
+        segment->length = length;
+        segment->offset = (uint32_t)offset;
+    }
+    index->total++;
+}
+
+// SOF0 to SOF15, less DHT, JPG and DAC which share the range
+static bool is_frame_marker(uint8_t marker) {
+    return marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+}
+
+// The marker walk behind jpeg_index_build and jpeg_find_exif. Stops at SOS,
+// or at the first APP1 Exif segment when stop_at_exif is set. Stray bytes
+// between segments are skipped up to the next 0xFF and counted.
+static ErrorCode walk_segments(const uint8_t *buffer, size_t length, JpegIndex *index, bool stop_at_exif, size_t *needed) {
+
+    size_t i = 2;                                                       // SKIP SOI (0xFF, 0xD8)
+    size_t want = 0;                                                    // Prefix length needed to keep walking
+
+    index->count = 0;
+    index->total = 0;
+    index->scan = 0;
+    index->garbage = 0;
+    index->frame = false;
+    index->exif = false;
+    index->tiff_offset = 0;
+    index->tiff_length = 0;
+
+    if (length < 2 || buffer[0] != 0xFF || buffer[1] != 0xD8) {         // Not a JPEG stream
+        return ERR_JPEG_INVALID;
+    }
+    record_segment(index, 0xD8, 0, 0);
+
+    for (;;) {                                                          // Jump from marker to marker
+
+        if (i + 2 > length) {                                           // Marker is cut off
+            want = i + 4;
+            break;
+        }
+
+        if (buffer[i] != 0xFF) {                                        // Garbage between segments, resync on the next 0xFF
+            const uint8_t *next = memchr(buffer + i, 0xFF, length - i);
+            if (next == NULL) {
+                index->garbage += length - i;
+                want = length + 1;
+                break;
+            }
+            index->garbage += (size_t)(next - buffer) - i;
+            i = (size_t)(next - buffer);
+        }
+
+        while (i + 1 < length && buffer[i + 1] == 0xFF) {               // Any number of 0xFF fill bytes may precede a marker
+            i++;
+        }
+        if (i + 2 > length) {
+            want = i + 4;
+            break;
+        }
+
+        const uint8_t marker = buffer[i + 1];
+
+        if (marker == 0xD9) {                                           // EOI before any scan
+            record_segment(index, marker, 0, i);
+            return ERR_JPEG_INVALID;
+        }
+
+        if (marker == 0x00 || marker == 0x01 ||                         // Stuffed byte, TEM and RSTn carry no length
+            (marker >= 0xD0 && marker <= 0xD8)) {
+            record_segment(index, marker, 0, i);
+            i += 2;
+            continue;
+        }
+
+        if (marker == 0xDA) {                                           // SOS, EXIF cannot follow the scan data
+            uint16_t sos_length = (i + 4 <= length) ? (uint16_t)((buffer[i + 2] << 8) | buffer[i + 3]) : 0;
+            record_segment(index, marker, sos_length, i);
+            if (stop_at_exif) {                                         // The header itself is not needed
+                return ERR_OK;
+            }
+            if (i + 4 <= length && sos_length < 2) {
+                return ERR_JPEG_INVALID;
+            }
+            if (i + 4 > length || i + 2 + sos_length > length) {        // Header is cut off
+                want = (i + 4 > length) ? i + 4 : i + 2 + sos_length;
+                break;
+            }
+            index->scan = i + 2 + sos_length;
+            return ERR_OK;
+        }
+
+        if (i + 4 > length) {                                           // Length field is cut off
+            want = i + 4;
+            break;
+        }
+
+        const uint16_t seg_length = (buffer[i + 2] << 8) | buffer[i + 3];  // Includes the two length bytes
+        if (seg_length < 2) {                                           // Corrupt length, no way to find the next marker
+            return ERR_JPEG_INVALID;
+        }
+
+        if (marker == 0xE1 && seg_length >= 8 && i + 10 > length) {    // Identifier is cut off
+            want = i + 10;
+            break;
+        }
+
+        record_segment(index, marker, seg_length, i);
+        index->frame |= is_frame_marker(marker);
+
+        if (marker == 0xE1 && seg_length >= 8 && !index->exif &&        // APP1 with the Exif identifier
+            memcmp(buffer + i + 4, "Exif\0\0", 6) == 0) {
+
+            if (i + 2 + seg_length > length) {                          // If the Tiff segment extends past image buffer
+                if (needed != NULL) {
+                    *needed = i + 2 + seg_length;
+                }
+                return ERR_TIFF_OVERFLOW;
+            }
+
+            index->exif = true;
+            index->tiff_offset = i + 10;                                // Marker, length and "Exif\0\0"
+            index->tiff_length = seg_length - 8;                        // Minus the length field and "Exif\0\0"
+            if (stop_at_exif) {
+                return ERR_OK;
+            }
+        }
+
+        i += 2 + (size_t)seg_length;                                    // Skip the whole segment, payload unread
+    }
+
+    if (needed != NULL) {
+        *needed = want;
+    }
+    return ERR_TRUNCATED;
+}
+
+// **** SEGMENT TABLE **** //
+
+ErrorCode jpeg_index_build(const uint8_t *buffer, size_t length, JpegIndex *index, size_t *needed) {
+
+    ErrorCode status = walk_segments(buffer, length, index, false, needed);
+
+    if (status == ERR_TIFF_OVERFLOW) {                                  // Only a short buffer, not a bad file
+        return ERR_TRUNCATED;
+    }
+    if (status != ERR_OK) {
+        return status;
+    }
+    return jpeg_index_valid(index) ? ERR_OK : ERR_JPEG_INVALID;
+}
+
+bool jpeg_index_valid(const JpegIndex *index) {
+    return index->scan > 0 && index->frame && index->garbage == 0;
+}
+
+ErrorCode jpeg_index_locate(const uint8_t *buffer, size_t length, JpegIndex *index, size_t *tiff_offset,
+                            size_t *tiff_length) {
+
+    ErrorCode status = walk_segments(buffer, length, index, false, NULL);
+
+    if (status == ERR_TIFF_OVERFLOW || index->exif) {                   // The segments past APP1 do not matter here
+        return (status == ERR_TIFF_OVERFLOW) ? status : jpeg_index_exif(index, tiff_offset, tiff_length);
+    }
+    if (status == ERR_TRUNCATED && index->total > 0 &&                  // A cut off SOS header still ends the search
+        !(index->count == index->total && index->segments[index->count - 1].marker == 0xDA)) {
+        return status;
+    }
+    return ERR_EXIF_MISSING;
+}
+
+ErrorCode jpeg_index_exif(const JpegIndex *index, size_t *tiff_offset, size_t *tiff_length) {
+    if (!index->exif) {
+        return ERR_EXIF_MISSING;
+    }
+    *tiff_offset = index->tiff_offset;
+    *tiff_length = index->tiff_length;
+    return ERR_OK;
+}
+
+const JpegSegment *jpeg_index_find(const JpegIndex *index, uint8_t marker) {
+    for (size_t i = 0; i < index->count; i++) {
+        if (index->segments[i].marker == marker) {
+            return &index->segments[i];
+        }
+    }
+    return NULL;
+}
+
+// **** EXIF **** //
+
+ErrorCode jpeg_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed) {
+
+    JpegIndex index;
+    ErrorCode status = walk_segments(buffer, length, &index, true, needed);
+
+    if (status == ERR_OK) {                                             // At the Exif segment, or SOS without one
+        return jpeg_index_exif(&index, tiff_offset, tiff_length);
+    }
+    return (status == ERR_JPEG_INVALID) ? ERR_EXIF_MISSING : status;
+}
+
+char *parse_jpeg_indexed(const uint8_t *buffer, size_t length, const JpegIndex *index) {
+
+    size_t tiff_offset = 0;
+    size_t tiff_length = 0;
+
+    if (jpeg_index_exif(index, &tiff_offset, &tiff_length) != ERR_OK || tiff_offset + tiff_length > length) {
+        return NULL;
+    }
+    return parse_tiff(buffer + tiff_offset, tiff_length);
+}
@@ -0,0 +1,221 @@
+/*
+ * @file            src/output_builder.c
+ * @description     Growable character buffer used to assemble parser output
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 09:12:40
+ * @lastModified    2026-10-17 00:31:14
+ */
+
+#include "output_builder.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool builder_init(OutputBuilder *builder, size_t initial_cap) {
+
+    if (initial_cap < 16) {                                             // Keep room for a handful of small writes
+        initial_cap = 16;
+    }
+
+    builder->data = malloc(initial_cap);
+    builder->len = 0;
+    builder->cap = initial_cap;
+    builder->failed = (builder->data == NULL);
+    builder->fixed = false;
+
+    if (builder->failed) {                                              // Nothing can be written into a failed builder
+        builder->cap = 0;
+        return false;
+    }
+
+    builder->data[0] = '\0';
+    return true;
+}
+
+void builder_init_fixed(OutputBuilder *builder, char *buffer, size_t cap) {
+    builder->data = buffer;
+    builder->len = 0;
+    builder->cap = (buffer == NULL) ? 0 : cap;                          // A NULL buffer is a pure size query
+    builder->failed = false;
+    builder->fixed = true;
+
+    if (builder->cap > 0) {
+        builder->data[0] = '\0';
+    }
+}
+
+void builder_free(OutputBuilder *builder) {
+    if (!builder->fixed) {                                              // Caller memory is never ours to free
+        free(builder->data);
+    }
+    builder->data = NULL;
+    builder->len = 0;
+    builder->cap = 0;
+    builder->failed = true;                                             // Released, later writes are dropped
+}
+
+char *builder_finish(OutputBuilder *builder) {
+
+    if (builder->failed) {                                              // Output is incomplete, do not hand it out
+        builder_free(builder);
+        return NULL;
+    }
+
+    char *data = builder->data;                                         // Ownership moves to the caller
+    builder->data = NULL;
+    builder->len = 0;
+    builder->cap = 0;
+    builder->failed = true;                                             // Nothing left to write into
+    return data;
+}
+
+bool builder_grow(OutputBuilder *builder, size_t extra) {
+
+    if (builder->failed) {
+        return false;
+    }
+
+    size_t needed = builder->len + extra + 1;                           // Always leave room for the terminator
+    if (needed <= builder->cap) {
+        return true;
+    }
+
+    if (builder->fixed) {                                               // Caller memory cannot grow
+        return false;
+    }
+
+    size_t new_cap = builder->cap;
+    while (new_cap < needed) {                                          // Double so total copying stays linear
+        new_cap *= 2;
+    }
+
+    char *temp = realloc(builder->data, new_cap);
+    if (temp == NULL) {
+        builder->failed = true;
+        return false;
+    }
+
+    builder->data = temp;
+    builder->cap = new_cap;
+    return true;
+}
+
+// **** NUMBER WRITERS **** //
+
+#define BUILDER_NUMBER_MAX 24                                           // "-2147483648/-2147483648" and the NUL
+
+// Two ASCII digits for every value below 100, so each division by 100
+// produces two characters
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static size_t count_digits(uint32_t value) {
+    if (value < 10) return 1;
+    if (value < 100) return 2;
+    if (value < 1000) return 3;
+    if (value < 10000) return 4;
+    if (value < 100000) return 5;
+    if (value < 1000000) return 6;
+    if (value < 10000000) return 7;
+    if (value < 100000000) return 8;
+    if (value < 1000000000) return 9;
+    return 10;
+}
+
+// Writes the digits of value to dst, back to front, and returns how many
+static size_t format_u32(char *dst, uint32_t value) {
+    size_t len = count_digits(value);
+    char *p = dst + len;
+
+    while (value >= 100) {
+        uint32_t pair = (value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--p = digit_pairs[value * 2 + 1];
+        *--p = digit_pairs[value * 2];
+    } else {
+        *--p = (char)('0' + value);
+    }
+    return len;
+}
+
+static size_t format_i32(char *dst, int32_t value) {
+    if (value < 0) {                                                    // Negate as unsigned so INT32_MIN survives
+        *dst = '-';
+        return 1 + format_u32(dst + 1, 0u - (uint32_t)value);
+    }
+    return format_u32(dst, (uint32_t)value);
+}
+
+// Formats in place when the number fits, otherwise into scratch so a full
+// fixed builder keeps the prefix that fits and its count
+static char *number_target(OutputBuilder *builder, char *scratch) {
+    if (!builder->failed && builder_reserve(builder, BUILDER_NUMBER_MAX)) {
+        return builder->data + builder->len;
+    }
+    return scratch;
+}
+
+static size_t number_commit(OutputBuilder *builder, const char *dst, const char *scratch, size_t len) {
+    if (dst == scratch) {
+        builder_append(builder, scratch, len);
+        return builder->failed ? 0 : len;
+    }
+    builder->len += len;
+    builder->data[builder->len] = '\0';
+    return len;
+}
+
+size_t builder_put_u32(OutputBuilder *builder, uint32_t value) {
+    char scratch[BUILDER_NUMBER_MAX];
+    char *dst = number_target(builder, scratch);
+    return number_commit(builder, dst, scratch, format_u32(dst, value));
+}
+
+size_t builder_put_i32(OutputBuilder *builder, int32_t value) {
+    char scratch[BUILDER_NUMBER_MAX];
+    char *dst = number_target(builder, scratch);
+    return number_commit(builder, dst, scratch, format_i32(dst, value));
+}
+
+size_t builder_put_rational(OutputBuilder *builder, uint32_t numerator, uint32_t denominator) {
+    char scratch[BUILDER_NUMBER_MAX];
+    char *dst = number_target(builder, scratch);
+    size_t len = format_u32(dst, numerator);
+    dst[len++] = '/';
+    len += format_u32(dst + len, denominator);
+    return number_commit(builder, dst, scratch, len);
+}
+
+size_t builder_put_srational(OutputBuilder *builder, int32_t numerator, int32_t denominator) {
+    char scratch[BUILDER_NUMBER_MAX];
+    char *dst = number_target(builder, scratch);
+    size_t len = format_i32(dst, numerator);
+    dst[len++] = '/';
+    len += format_i32(dst + len, denominator);
+    return number_commit(builder, dst, scratch, len);
+}
+
+size_t builder_put_hex8(OutputBuilder *builder, uint8_t value) {
+    static const char hex[] = "0123456789ABCDEF";
+    char scratch[BUILDER_NUMBER_MAX];
+    char *dst = number_target(builder, scratch);
+    dst[0] = '0';
+    dst[1] = 'x';
+    dst[2] = hex[value >> 4];
+    dst[3] = hex[value & 0xF];
+    return number_commit(builder, dst, scratch, 4);
+}
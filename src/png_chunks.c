@@ -0,0 +1,120 @@
+/*
+ * @file            src/png_chunks.c
+ * @description     Finds the eXIf chunk of a PNG by skipping over the chunks before it
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 19:12:40
+ * @lastModified    2026-10-17 19:12:40
+ */
+
+#include "png_chunks.h"
+#include "exif_parser.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Chunk lengths are limited to 2^31 - 1, anything larger is corrupt
+#define PNG_MAX_CHUNK 0x7FFFFFFFu
+
+// **** HELPERS **** //
+
+static uint32_t read_be32(const uint8_t *bytes) {
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+// CRC-32 of the reflected 0xEDB88320 polynomial, four bits at a time. Only
+// used when a caller asks for the check, so a 16 entry table is enough.
+static const uint32_t crc_nibbles[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+uint32_t png_crc(const uint8_t *data, size_t length) {
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crc_nibbles[crc & 0x0F];
+        crc = (crc >> 4) ^ crc_nibbles[crc & 0x0F];
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// **** CHUNK WALK **** //
+
+ErrorCode png_scan_chunks(const uint8_t *buffer, size_t length, size_t *offset, size_t *tiff_offset, size_t *tiff_length) {
+
+    size_t i = *offset;
+
+    while (i + PNG_CHUNK_HEADER <= length) {                            // Jump from chunk header to chunk header
+
+        const uint32_t chunk_length = read_be32(buffer + i);
+        const uint8_t *type = buffer + i + 4;
+
+        if (chunk_length > PNG_MAX_CHUNK) {                             // Corrupt length, no way to find the next chunk
+            *offset = i;
+            return ERR_EXIF_MISSING;
+        }
+
+        if (memcmp(type, "eXIf", 4) == 0) {
+            *offset = i;
+            *tiff_offset = i + PNG_CHUNK_HEADER;
+            *tiff_length = chunk_length;
+            return ERR_OK;
+        }
+
+        if (memcmp(type, "IEND", 4) == 0) {                             // Nothing follows IEND
+            *offset = i;
+            return ERR_EXIF_MISSING;
+        }
+
+        i += PNG_CHUNK_HEADER + (size_t)chunk_length + PNG_CHUNK_CRC;   // Skip the data and CRC unread, IDAT included
+    }
+
+    *offset = i;
+    return ERR_TRUNCATED;
+}
+
+ErrorCode png_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed) {
+
+    size_t offset = PNG_SIGNATURE_LENGTH;
+    size_t found_offset = 0;
+    size_t found_length = 0;
+
+    if (length < PNG_SIGNATURE_LENGTH || memcmp(buffer, PNG_SIGNATURE, PNG_SIGNATURE_LENGTH) != 0) {
+        return ERR_EXIF_MISSING;
+    }
+
+    ErrorCode status = png_scan_chunks(buffer, length, &offset, &found_offset, &found_length);
+
+    if (status == ERR_TRUNCATED) {                                      // Header of the next chunk is cut off
+        if (needed != NULL) {
+            *needed = offset + PNG_CHUNK_HEADER;
+        }
+        return status;
+    }
+    if (status != ERR_OK) {
+        return status;
+    }
+
+    if (found_offset + found_length > length) {                         // If the eXIf data extends past image buffer
+        if (needed != NULL) {
+            *needed = found_offset + found_length + PNG_CHUNK_CRC;
+        }
+        return ERR_TIFF_OVERFLOW;
+    }
+
+    *tiff_offset = found_offset;
+    *tiff_length = found_length;
+    return ERR_OK;
+}
+
+ErrorCode png_check_exif(const uint8_t *buffer, size_t length, size_t tiff_offset, size_t tiff_length) {
+
+    if (tiff_offset < 4 || tiff_offset + tiff_length + PNG_CHUNK_CRC > length) {
+        return ERR_TRUNCATED;
+    }
+
+    // The CRC covers the chunk type and data but not the length
+    uint32_t crc = png_crc(buffer + tiff_offset - 4, tiff_length + 4);
+    return (crc == read_be32(buffer + tiff_offset + tiff_length)) ? ERR_OK : ERR_CHECKSUM;
+}
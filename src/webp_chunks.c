@@ -0,0 +1,115 @@
+/*
+ * @file            src/webp_chunks.c
+ * @description     Finds the EXIF chunk of a WebP from the VP8X flags and the RIFF chunk sizes
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 20:03:55
+ * @lastModified    2026-10-17 20:03:55
+ */
+
+#include "webp_chunks.h"
+#include "exif_parser.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// **** HELPERS **** //
+
+static uint32_t read_le32(const uint8_t *bytes) {
+    return ((uint32_t)bytes[3] << 24) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[1] << 8) | bytes[0];
+}
+
+// **** CHUNK WALK **** //
+
+ErrorCode webp_has_exif(const uint8_t *buffer, size_t length, size_t *riff_end) {
+
+    if (length < WEBP_HEADER_LENGTH) {
+        return ERR_TRUNCATED;
+    }
+    if (memcmp(buffer, "RIFF", 4) != 0 || memcmp(buffer + 8, "WEBP", 4) != 0) {
+        return ERR_EXIF_MISSING;
+    }
+    if (riff_end != NULL) {
+        *riff_end = 8 + (size_t)read_le32(buffer + 4);                  // The size counts from "WEBP"
+    }
+    if (length < WEBP_FLAGS_LENGTH) {
+        return ERR_TRUNCATED;
+    }
+
+    if (memcmp(buffer + WEBP_HEADER_LENGTH, "VP8X", 4) != 0) {          // VP8 or VP8L, no room for metadata
+        return ERR_EXIF_MISSING;
+    }
+    return (buffer[WEBP_HEADER_LENGTH + WEBP_CHUNK_HEADER] & WEBP_FLAG_EXIF) ? ERR_OK : ERR_EXIF_MISSING;
+}
+
+ErrorCode webp_scan_chunks(const uint8_t *buffer, size_t length, size_t *offset, size_t *tiff_offset, size_t *tiff_length) {
+
+    size_t i = *offset;
+
+    while (i + WEBP_CHUNK_HEADER <= length) {                           // Jump from chunk header to chunk header
+
+        const uint32_t chunk_size = read_le32(buffer + i + 4);
+
+        if (memcmp(buffer + i, "EXIF", 4) == 0) {
+            size_t data = i + WEBP_CHUNK_HEADER;
+            if (chunk_size >= 6 && data + 6 > length) {                 // Prefix check is cut off
+                break;
+            }
+
+            *offset = i;
+            *tiff_offset = data;
+            *tiff_length = chunk_size;
+            if (chunk_size >= 6 && memcmp(buffer + data, "Exif\0\0", 6) == 0) {
+                *tiff_offset += 6;
+                *tiff_length -= 6;
+            }
+            return ERR_OK;
+        }
+
+        i += WEBP_CHUNK_HEADER + (size_t)chunk_size + (chunk_size & 1); // Skip the data and its pad byte unread
+    }
+
+    *offset = i;
+    return ERR_TRUNCATED;
+}
+
+ErrorCode webp_find_exif(const uint8_t *buffer, size_t length, size_t *tiff_offset, size_t *tiff_length, size_t *needed) {
+
+    size_t riff_end = 0;
+    size_t offset = WEBP_HEADER_LENGTH;
+    size_t found_offset = 0;
+    size_t found_length = 0;
+
+    ErrorCode status = webp_has_exif(buffer, length, &riff_end);
+    if (status == ERR_TRUNCATED) {
+        if (needed != NULL) {
+            *needed = WEBP_FLAGS_LENGTH;
+        }
+        return status;
+    }
+    if (status != ERR_OK) {                                             // The flags rule it out, nothing is walked
+        return status;
+    }
+
+    status = webp_scan_chunks(buffer, (length < riff_end) ? length : riff_end, &offset, &found_offset, &found_length);
+
+    if (status == ERR_TRUNCATED) {
+        if (offset + WEBP_CHUNK_HEADER > riff_end) {                    // Walked off the RIFF data, the flag was wrong
+            return ERR_EXIF_MISSING;
+        }
+        if (needed != NULL) {
+            *needed = offset + WEBP_CHUNK_HEADER + 6;                   // Room for the header and the prefix check
+        }
+        return status;
+    }
+
+    if (found_offset + found_length > length) {                         // If the EXIF data extends past image buffer
+        if (needed != NULL) {
+            *needed = found_offset + found_length;
+        }
+        return ERR_TIFF_OVERFLOW;
+    }
+
+    *tiff_offset = found_offset;
+    *tiff_length = found_length;
+    return ERR_OK;
+}
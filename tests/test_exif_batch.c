@@ -0,0 +1,268 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "exif_batch.h"
+#include "exif_parser.h"
+#include "exif_uring.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define BATCH_SIZE 64
+
+// Each index is written by exactly one callback, so no locking is needed
+typedef struct {
+  int calls[BATCH_SIZE];
+  ErrorCode status[BATCH_SIZE];
+  char *json[BATCH_SIZE];
+} BatchResults;
+
+static void record(size_t index, const char *path, ErrorCode status, char *json, void *user) {
+  BatchResults *results = user;
+  (void)path;
+  results->calls[index]++;
+  results->status[index] = status;
+  results->json[index] = json;
+}
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+static void put_segment(FILE *file, uint8_t marker, const uint8_t *payload, size_t length) {
+  uint8_t header[4] = { 0xFF, marker, (uint8_t)((length + 2) >> 8), (uint8_t)(length + 2) };
+  fwrite(header, 1, sizeof(header), file);
+  for (size_t i = 0; i < length; i++) {
+    fputc(payload ? payload[i] : 0, file);
+  }
+}
+
+// Writes a JPEG whose APP1 sits behind three large APP2 blocks, past the
+// first read window, so the prefix has to grow. Without exif there is no APP1.
+static int write_deep_jpeg(char *path, bool exif) {
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return -1;
+  }
+  FILE *file = fdopen(fd, "wb");
+  uint8_t app1[6 + sizeof(tiny_tiff)];
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, tiny_tiff, sizeof(tiny_tiff));
+
+  fputc(0xFF, file);
+  fputc(0xD8, file);
+  for (int i = 0; i < 3; i++) {
+    put_segment(file, 0xE2, NULL, 30000);
+  }
+  if (exif) {
+    put_segment(file, 0xE1, app1, sizeof(app1));
+  }
+  put_segment(file, 0xDA, NULL, 10);
+  fclose(file);
+  return 0;
+}
+
+static size_t put_be32(uint8_t *out, size_t pos, uint32_t value) {
+  out[pos] = (uint8_t)(value >> 24);
+  out[pos + 1] = (uint8_t)(value >> 16);
+  out[pos + 2] = (uint8_t)(value >> 8);
+  out[pos + 3] = (uint8_t)value;
+  return pos + 4;
+}
+
+// The smallest PNG, WebP and HEIC files that carry tiny_tiff, CRCs and image
+// data left out since no reader looks at them
+static size_t build_container(uint8_t *out, int kind) {
+  size_t pos = 0;
+
+  if (kind == 0) {                                        // Signature, eXIf and IEND
+    memcpy(out, "\x89PNG\r\n\x1A\n", 8);
+    pos = put_be32(out, 8, sizeof(tiny_tiff));
+    memcpy(out + pos, "eXIf", 4);
+    memcpy(out + pos + 4, tiny_tiff, sizeof(tiny_tiff));
+    pos = put_be32(out, pos + 4 + sizeof(tiny_tiff), 0);
+    pos = put_be32(out, pos, 0);
+    memcpy(out + pos, "IEND", 4);
+    return put_be32(out, pos + 4, 0);
+  }
+
+  if (kind == 1) {                                        // RIFF header, VP8X with the EXIF flag, EXIF
+    memcpy(out, "RIFF\0\0\0\0WEBPVP8X\x0A\0\0\0\x08\0\0\0\0\0\0\0\0\0EXIF", 34);
+    out[34] = sizeof(tiny_tiff);
+    memset(out + 35, 0, 3);
+    memcpy(out + 38, tiny_tiff, sizeof(tiny_tiff));
+    pos = 38 + sizeof(tiny_tiff);
+    out[4] = (uint8_t)(pos - 8);
+    return pos;
+  }
+
+  memcpy(out, "\0\0\0\x14" "ftypheic\0\0\0\0mif1", 20);    // ftyp, then meta with iinf and iloc
+  pos = put_be32(out, 20, 77);
+  memcpy(out + pos, "meta\0\0\0\0", 8);
+  pos = put_be32(out, pos + 8, 35);
+  memcpy(out + pos, "iinf\0\0\0\0\0\x01", 10);
+  pos = put_be32(out, pos + 10, 21);
+  memcpy(out + pos, "infe\x02\0\0\0\0\x01\0\0Exif", 16);
+  out[pos + 16] = 0;                                      // Empty item name
+  pos = put_be32(out, pos + 17, 30);
+  memcpy(out + pos, "iloc\0\0\0\0\x44\0\0\x01\0\x01\0\0\0\x01", 18);
+  pos = put_be32(out, pos + 18, 105);
+  pos = put_be32(out, pos, 4 + 6 + sizeof(tiny_tiff));
+  pos = put_be32(out, pos, 8 + 4 + 6 + sizeof(tiny_tiff));  // mdat holding the Exif item
+  memcpy(out + pos, "mdat", 4);
+  pos = put_be32(out, pos + 4, 6);
+  memcpy(out + pos, "Exif\0\0", 6);
+  memcpy(out + pos + 6, tiny_tiff, sizeof(tiny_tiff));
+  return pos + 6 + sizeof(tiny_tiff);
+}
+
+static int write_container(char *path, int kind) {
+  uint8_t data[256];
+  size_t length = build_container(data, kind);
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return -1;
+  }
+  bool written = write(fd, data, length) == (ssize_t)length;
+  close(fd);
+  return written ? 0 : -1;
+}
+
+// Every mode reads the other container formats through the format dispatch
+static int run_containers(const ExifBatchOptions *options, const char *const *paths) {
+  BatchResults results;
+  memset(&results, 0, sizeof(results));
+
+  CHECK(exif_parse_batch(paths, 3, options, record, &results) == ERR_OK);
+  for (size_t i = 0; i < 3; i++) {
+    CHECK(results.calls[i] == 1 && results.status[i] == ERR_OK);
+    CHECK(strcmp(results.json[i], "{\"Orientation\":6}") == 0);
+    free(results.json[i]);
+  }
+  return 0;
+}
+
+// Every reader has to agree on the sample, a missing file, an empty file, a
+// file whose EXIF lies past the first window and a JPEG without EXIF
+static int run_mixed(const ExifBatchOptions *options, const char *expected, const char *deep, const char *empty,
+                     const char *bare) {
+  const char *paths[] = { "tests/example.jpeg", "tests/missing.jpeg", empty, deep, bare };
+  BatchResults results;
+  memset(&results, 0, sizeof(results));
+
+  CHECK(exif_parse_batch(paths, 5, options, record, &results) == ERR_OK);
+  for (size_t i = 0; i < 5; i++) {
+    CHECK(results.calls[i] == 1);
+  }
+  CHECK(results.status[0] == ERR_OK && strcmp(results.json[0], expected) == 0);
+  CHECK(results.status[1] == ERR_IO && results.json[1] == NULL);
+  CHECK(results.status[2] != ERR_OK && results.json[2] == NULL);
+  CHECK(results.status[3] == ERR_OK && strcmp(results.json[3], "{\"Orientation\":6}") == 0);
+  CHECK(results.status[4] == ERR_EXIF_MISSING && results.json[4] == NULL);  // The real status, not a catch-all
+
+  for (size_t i = 0; i < 5; i++) {
+    free(results.json[i]);
+  }
+  return 0;
+}
+
+static int run_batch(const ExifBatchOptions *options, const char *expected) {
+  const char *paths[BATCH_SIZE];
+  BatchResults results;
+  memset(&results, 0, sizeof(results));
+
+  for (size_t i = 0; i < BATCH_SIZE; i++) {
+    paths[i] = (i % 16 == 7) ? "tests/missing.jpeg" : "tests/example.jpeg";
+  }
+
+  CHECK(exif_parse_batch(paths, BATCH_SIZE, options, record, &results) == ERR_OK);
+
+  for (size_t i = 0; i < BATCH_SIZE; i++) {
+    CHECK(results.calls[i] == 1);
+    if (i % 16 == 7) {
+      CHECK(results.status[i] != ERR_OK);
+      CHECK(results.json[i] == NULL);
+    } else {
+      CHECK(results.status[i] == ERR_OK);
+      CHECK(results.json[i] != NULL && strcmp(results.json[i], expected) == 0);
+    }
+    free(results.json[i]);
+  }
+  return 0;
+}
+
+int main(void) {
+  FILE *file = fopen("tests/example.jpeg", "rb");
+  CHECK(file != NULL);
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *buffer = malloc(size);
+  CHECK(fread(buffer, 1, size, file) == (size_t)size);
+  fclose(file);
+
+  char *expected = parse_jpeg(buffer, size);
+  free(buffer);
+  CHECK(expected != NULL);
+
+  ExifBatchOptions serial = { 1, false, false, 0 };
+  ExifBatchOptions pooled = { 4, false, false, 0 };
+  ExifBatchOptions mapped = { 4, true, false, 0 };
+  ExifBatchOptions crowded = { BATCH_SIZE * 2, false, false, 0 };   // More threads than paths
+  ExifBatchOptions uring = { 1, false, true, 8 };          // Falls back to the pool without a ring
+  ExifBatchOptions shallow = { 1, false, true, 1 };
+
+  CHECK(run_batch(&serial, expected) == 0);
+  CHECK(run_batch(&pooled, expected) == 0);
+  CHECK(run_batch(&mapped, expected) == 0);
+  CHECK(run_batch(&crowded, expected) == 0);
+  CHECK(run_batch(NULL, expected) == 0);
+  CHECK(run_batch(&uring, expected) == 0);
+  CHECK(run_batch(&shallow, expected) == 0);
+
+  char deep[] = "/tmp/exif_batch_deep_XXXXXX";
+  char empty[] = "/tmp/exif_batch_empty_XXXXXX";
+  char bare[] = "/tmp/exif_batch_bare_XXXXXX";
+  int empty_fd = mkstemp(empty);
+  CHECK(write_deep_jpeg(deep, true) == 0 && write_deep_jpeg(bare, false) == 0 && empty_fd >= 0);
+  close(empty_fd);
+
+  int mixed = run_mixed(&pooled, expected, deep, empty, bare) + run_mixed(&mapped, expected, deep, empty, bare) +
+              run_mixed(&uring, expected, deep, empty, bare) + run_mixed(&shallow, expected, deep, empty, bare);
+  unlink(deep);
+  unlink(empty);
+  unlink(bare);
+  CHECK(mixed == 0);
+
+  char png[] = "/tmp/exif_batch_png_XXXXXX";
+  char webp[] = "/tmp/exif_batch_webp_XXXXXX";
+  char heic[] = "/tmp/exif_batch_heic_XXXXXX";
+  const char *containers[] = { png, webp, heic };
+  CHECK(write_container(png, 0) == 0 && write_container(webp, 1) == 0 && write_container(heic, 2) == 0);
+  int read = run_containers(&pooled, containers) + run_containers(&mapped, containers) +
+             run_containers(&uring, containers) + run_containers(&shallow, containers);
+  unlink(png);
+  unlink(webp);
+  unlink(heic);
+  CHECK(read == 0);
+  CHECK(exif_parse_batch(NULL, 0, NULL, record, NULL) == ERR_OK);
+
+  free(expected);
+  printf("exif_batch: OK (io_uring %s)\n", exif_uring_available() ? "available" : "unavailable, pool fallback");
+  return 0;
+}
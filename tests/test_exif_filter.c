@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exif_filter.h"
+#include "exif_parser.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// IFD0 holds Orientation = 6 then an ExifOffset pointing past the TIFF data,
+// so a walk that gets past Orientation fails
+static const uint8_t broken[] = {
+  0xFF, 0xD8, 0xFF, 0xE1, 0x00, 0x2E, 'E', 'x', 'i', 'f', 0x00, 0x00,
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x02,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x87, 0x69, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x10, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+static uint8_t *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = malloc((size_t)size);
+  if (data != NULL && fread(data, 1, (size_t)size, file) != (size_t)size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *length = (size_t)size;
+  return data;
+}
+
+int main(void) {
+  size_t length = 0;
+  uint8_t *jpeg = read_file("tests/example.jpeg", &length);
+  CHECK(jpeg != NULL);
+
+  // ISO > 3200 from a RICOH, the example was shot at ISO 100
+  ExifFilter filter;
+  exif_filter_init(&filter);
+  int iso = exif_filter_number(&filter, 0x8827, EXIF_CMP_GT, 3200);
+  int make = exif_filter_text(&filter, 0x010F, EXIF_CMP_EQ, "RICOH IMAGING COMPANY, LTD.");
+  CHECK(exif_filter_and(&filter, iso, make) >= 0);
+  CHECK(exif_filter_match(&filter, jpeg, length) == ERR_FILTERED);
+
+  char *json = (char *)1;
+  CHECK(parse_jpeg_where(&filter, jpeg, length, NULL, &json) == ERR_FILTERED && json == NULL);
+
+  // Low ISO from a GR III taken during 2022, with trailing padding in Model
+  exif_filter_init(&filter);
+  iso = exif_filter_number(&filter, 0x8827, EXIF_CMP_LE, 100);
+  int model = exif_filter_text(&filter, 0x0110, EXIF_CMP_EQ, "RICOH GR III");
+  int after = exif_filter_text(&filter, 0x9003, EXIF_CMP_GE, "2022:01:01 00:00:00");
+  int before = exif_filter_text(&filter, 0x9003, EXIF_CMP_LT, "2023:01:01 00:00:00");
+  CHECK(exif_filter_and(&filter, exif_filter_and(&filter, iso, model), exif_filter_and(&filter, after, before)) >= 0);
+  CHECK(exif_filter_match(&filter, jpeg, length) == ERR_OK);
+
+  ExifTagSet tags;
+  exif_tagset_clear(&tags);
+  exif_tagset_add(&tags, 0x0112);
+  CHECK(parse_jpeg_where(&filter, jpeg, length, &tags, &json) == ERR_OK);
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":1}") == 0);
+  free(json);
+
+  tags.ifds = EXIF_IFD_BIT(EXIF_IFD_0);                   // The filter still reaches ISO in the Exif IFD
+  CHECK(parse_jpeg_where(&filter, jpeg, length, &tags, &json) == ERR_OK);
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":1}") == 0);
+  free(json);
+
+  char *all = parse_jpeg(jpeg, length);                   // Same output as parse_jpeg from the one walk
+  CHECK(all != NULL && parse_jpeg_where(&filter, jpeg, length, NULL, &json) == ERR_OK);
+  CHECK(json != NULL && strcmp(json, all) == 0);
+  free(json);
+  free(all);
+
+  // OR is decided by either side, rationals compare by quotient
+  exif_filter_init(&filter);
+  make = exif_filter_text(&filter, 0x010F, EXIF_CMP_EQ, "Canon");
+  int focal = exif_filter_number(&filter, 0x920A, EXIF_CMP_GT, 18.25);
+  CHECK(exif_filter_or(&filter, make, focal) >= 0);
+  CHECK(exif_filter_match(&filter, jpeg, length) == ERR_OK);
+
+  // A tag the image does not have makes its comparison false
+  exif_filter_init(&filter);
+  CHECK(exif_filter_number(&filter, 0x0102, EXIF_CMP_NE, 0) >= 0);
+  CHECK(exif_filter_match(&filter, jpeg, length) == ERR_FILTERED);
+
+  // Orientation decides the AND in IFD0, the broken Exif IFD is never reached
+  exif_filter_init(&filter);
+  int orientation = exif_filter_number(&filter, 0x0112, EXIF_CMP_EQ, 1);
+  iso = exif_filter_number(&filter, 0x8827, EXIF_CMP_GT, 0);
+  CHECK(exif_filter_and(&filter, orientation, iso) >= 0);
+  CHECK(exif_filter_match(&filter, broken, sizeof(broken)) == ERR_FILTERED);
+  CHECK(parse_jpeg_where(&filter, broken, sizeof(broken), NULL, &json) == ERR_FILTERED && json == NULL);
+  filter.nodes[orientation].number = 6;                   // Now the walk must go on and fail
+  CHECK(exif_filter_match(&filter, broken, sizeof(broken)) == ERR_EXIF_OVERFLOW);
+
+  // Unknown tags and bad children make the filter invalid
+  exif_filter_init(&filter);
+  CHECK(exif_filter_number(&filter, 0x011A, EXIF_CMP_EQ, 72) == -1);
+  CHECK(exif_filter_match(&filter, jpeg, length) == ERR_INVALID_TAG);
+  exif_filter_init(&filter);
+  CHECK(exif_filter_and(&filter, 0, 1) == -1);
+  CHECK(exif_filter_match(&filter, jpeg, length) == ERR_INVALID_TAG);
+
+  free(jpeg);
+  printf("exif_filter: OK\n");
+  return 0;
+}
@@ -0,0 +1,218 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "exif_io.h"
+#include "exif_parser.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+// Big endian TIFF block with Orientation = 8 in IFD0 and IFD1 pointing to
+// an 8 byte JPEG thumbnail at TIFF offset 68
+static const uint8_t thumb_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x08, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x1A,
+  0x00, 0x03,
+  0x01, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x02, 0x01, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x44,
+  0x02, 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x00, 0x00, 0x00,
+  0xFF, 0xD8, 0xFF, 0xFE, 0x00, 0x02, 0xFF, 0xD9,
+};
+
+static void put_segment(FILE *file, uint8_t marker, const uint8_t *payload, size_t length) {
+  uint8_t header[4] = { 0xFF, marker, (uint8_t)((length + 2) >> 8), (uint8_t)(length + 2) };
+  fwrite(header, 1, sizeof(header), file);
+  for (size_t i = 0; i < length; i++) {
+    fputc(payload ? payload[i] : 0, file);
+  }
+}
+
+// SOI, app2_count APP2 blocks of app2_size, optional APP1 padded to app1_size,
+// SOS and scan_size bytes of scan data
+static FILE *write_jpeg(int app2_count, size_t app2_size, size_t app1_size, size_t scan_size) {
+  FILE *file = tmpfile();
+  if (!file) {
+    return NULL;
+  }
+
+  fputc(0xFF, file);
+  fputc(0xD8, file);
+  for (int i = 0; i < app2_count; i++) {
+    put_segment(file, 0xE2, NULL, app2_size);
+  }
+  if (app1_size > 0) {
+    uint8_t *app1 = calloc(1, app1_size);
+    memcpy(app1, "Exif\0\0", 6);
+    memcpy(app1 + 6, tiny_tiff, sizeof(tiny_tiff));
+    put_segment(file, 0xE1, app1, app1_size);
+    free(app1);
+  }
+  put_segment(file, 0xDA, NULL, 10);
+  for (size_t i = 0; i < scan_size; i++) {
+    fputc(0x55, file);
+  }
+  fflush(file);
+  return file;
+}
+
+int main() {
+  uint8_t *prefix = NULL;
+  size_t length = 0;
+
+  // The sample image only needs its first window
+  char *from_path = exif_parse_path("tests/example.jpeg");
+  CHECK(from_path != NULL);
+
+  FILE *file = fopen("tests/example.jpeg", "rb");
+  CHECK(file != NULL);
+  CHECK(exif_read_prefix(fileno(file), &prefix, &length) == ERR_OK);
+  CHECK(length == EXIF_READ_WINDOW);
+
+  char *from_prefix = parse_jpeg(prefix, length);
+  CHECK(from_prefix != NULL && strcmp(from_prefix, from_path) == 0);
+  free(from_prefix);
+
+  char *from_mmap = exif_parse_mmap("tests/example.jpeg");
+  CHECK(from_mmap != NULL && strcmp(from_mmap, from_path) == 0);
+  free(from_mmap);
+  CHECK(exif_parse_mmap("tests/does_not_exist.jpeg") == NULL);
+  free(from_path);
+  free(prefix);
+  fclose(file);
+
+  // Large APP2 blocks push APP1 past the first window
+  file = write_jpeg(2, 60000, 6 + sizeof(tiny_tiff), 200000);
+  CHECK(file != NULL);
+  CHECK(exif_read_prefix(fileno(file), &prefix, &length) == ERR_OK);
+  CHECK(length > EXIF_READ_WINDOW && length < 2 * 60004 + 2 + 200000);
+  char *json = exif_parse_fd(fileno(file));
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  free(prefix);
+  fclose(file);
+
+  // APP1 starting inside the window but ending past it is read to its end only
+  file = write_jpeg(1, 65000, 3000, 200000);
+  CHECK(file != NULL);
+  CHECK(exif_read_prefix(fileno(file), &prefix, &length) == ERR_OK);
+  CHECK(length == 2 + 65004 + 3004);
+  free(prefix);
+  fclose(file);
+
+  // No EXIF stops at the start of scan without reading the scan data
+  file = write_jpeg(1, 1000, 0, 500000);
+  CHECK(file != NULL);
+  CHECK(exif_read_prefix(fileno(file), &prefix, &length) == ERR_EXIF_MISSING);
+  CHECK(exif_parse_fd(fileno(file)) == NULL);
+  fclose(file);
+
+  // APP1 cut off by the end of the file reports its status and no JSON
+  file = write_jpeg(0, 0, 3000, 0);
+  CHECK(file != NULL && ftruncate(fileno(file), 2 + 2000) == 0);
+  json = (char *)1;
+  CHECK(exif_json_fd(fileno(file), &json) == ERR_TIFF_OVERFLOW && json == NULL);
+  CHECK(exif_parse_fd(fileno(file)) == NULL);
+  fclose(file);
+
+  // A bare TIFF with IFD0 behind 200000 bytes of strip data reads only the
+  // header and the IFD, not the strip or the data after the IFD
+  file = tmpfile();
+  CHECK(file != NULL);
+  uint8_t tiff_header[8] = { 'M', 'M', 0x00, 0x2A, 0x00, 0x03, 0x0D, 0x48 };  // IFD0 at 8 + 200000
+  fwrite(tiff_header, 1, sizeof(tiff_header), file);
+  for (size_t i = 0; i < 200000; i++) {
+    fputc(0x55, file);
+  }
+  fwrite(tiny_tiff + 8, 1, sizeof(tiny_tiff) - 8, file);
+  for (size_t i = 0; i < 100000; i++) {
+    fputc(0x55, file);
+  }
+  fflush(file);
+  CHECK(exif_read_tiff(fileno(file), &prefix, &length) == ERR_OK);
+  CHECK(length == 200000 + sizeof(tiny_tiff) && memcmp(prefix, tiff_header, 8) == 0);
+  CHECK(prefix[8] == 0 && prefix[199999] == 0 && prefix[200008] == 0x00 && prefix[200009] == 0x01);
+  free(prefix);
+  CHECK(exif_json_fd(fileno(file), &json) == ERR_OK && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  fclose(file);
+
+  // Values out of line are read where they point, wherever that is
+  file = tmpfile();
+  CHECK(file != NULL);
+  static const uint8_t make_tiff[] = {
+    'I', 'I', 0x2A, 0x00, 0x08, 0x00, 0x00, 0x00,
+    0x01, 0x00,
+    0x0F, 0x01, 0x02, 0x00, 0x06, 0x00, 0x00, 0x00, 0x50, 0xC3, 0x00, 0x00,  // Make, 6 bytes at 50000
+    0x00, 0x00, 0x00, 0x00,
+  };
+  fwrite(make_tiff, 1, sizeof(make_tiff), file);
+  for (size_t i = sizeof(make_tiff); i < 50000; i++) {
+    fputc(0x55, file);
+  }
+  fwrite("Canon\0", 1, 6, file);
+  for (size_t i = 0; i < 100000; i++) {
+    fputc(0x55, file);
+  }
+  fflush(file);
+  CHECK(exif_read_tiff(fileno(file), &prefix, &length) == ERR_OK);
+  CHECK(length == 50006 && prefix[sizeof(make_tiff)] == 0 && memcmp(prefix + 50000, "Canon", 6) == 0);
+  free(prefix);
+  CHECK(exif_json_fd(fileno(file), &json) == ERR_OK && strcmp(json, "{\"Make\":\"Canon\"}") == 0);
+  free(json);
+  fclose(file);
+
+  // The thumbnail is found in place, in a buffer and by file offset
+  uint8_t app1[6 + sizeof(thumb_tiff)];
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, thumb_tiff, sizeof(thumb_tiff));
+  file = tmpfile();
+  CHECK(file != NULL);
+  fputc(0xFF, file);
+  fputc(0xD8, file);
+  put_segment(file, 0xE1, app1, sizeof(app1));
+  put_segment(file, 0xDA, NULL, 10);
+  fflush(file);
+  CHECK(exif_read_prefix(fileno(file), &prefix, &length) == ERR_OK);
+
+  ExifThumbnail thumbnail;
+  CHECK(exif_thumbnail(prefix, length, &thumbnail) == ERR_OK);
+  CHECK(thumbnail.offset == 2 + 4 + 6 + 68 && thumbnail.length == 8 && thumbnail.orientation == 8);
+  CHECK(thumbnail.data == prefix + thumbnail.offset && thumbnail.data[7] == 0xD9);
+  CHECK(exif_thumbnail_fd(fileno(file), &thumbnail) == ERR_OK);
+  CHECK(thumbnail.data == NULL && thumbnail.offset == 80 && thumbnail.length == 8 && thumbnail.orientation == 8);
+
+  app1[6 + 63] = 0x40;                                    // Length now runs past the APP1 segment
+  memcpy(prefix + 12, app1 + 6, sizeof(thumb_tiff));
+  CHECK(exif_thumbnail(prefix, length, &thumbnail) == ERR_EXIF_OVERFLOW);
+  free(prefix);
+  fclose(file);
+
+  file = fopen("tests/example.jpeg", "rb");               // No IFD1, the Orientation is still reported
+  CHECK(file != NULL);
+  CHECK(exif_thumbnail_fd(fileno(file), &thumbnail) == ERR_INVALID_TAG && thumbnail.orientation == 1);
+  fclose(file);
+
+  printf("exif_io: OK\n");
+  return 0;
+}
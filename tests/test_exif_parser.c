@@ -1,9 +1,295 @@
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "exif_parser.h"
 
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+// Appends a marker segment with a zero filled payload and returns its payload
+static uint8_t *put_segment(uint8_t *out, size_t *pos, uint8_t marker, size_t payload) {
+  out[(*pos)++] = 0xFF;
+  out[(*pos)++] = marker;
+  out[(*pos)++] = (uint8_t)((payload + 2) >> 8);
+  out[(*pos)++] = (uint8_t)(payload + 2);
+  memset(out + *pos, 0, payload);
+  *pos += payload;
+  return out + *pos - payload;
+}
+
+// Big endian TIFF block with every kind of IFD. IFD0 links to the Exif IFD,
+// the GPS IFD and IFD1; the Exif IFD links to the Interop IFD and back to
+// IFD0, which must not be walked twice.
+static const uint8_t graph_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x03,                                                             // IFD0 at 8
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x87, 0x69, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x32,
+  0x88, 0x25, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x5C,
+  0x00, 0x00, 0x00, 0x8C,                                                 // Next is IFD1
+  0x00, 0x03,                                                             // Exif IFD at 50
+  0x88, 0x27, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x64, 0x00, 0x00,
+  0xA0, 0x05, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x7A,
+  0x87, 0x69, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x08, // Cycle back to IFD0
+  0x00, 0x00, 0x00, 0x00,
+  0x00, 0x02,                                                             // GPS IFD at 92
+  0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x02, 'N', 0x00, 0x00, 0x00,
+  0x00, 0x05, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+  0x00, 0x01,                                                             // Interop IFD at 122
+  0x00, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x04, 'R', '9', '8', 0x00,
+  0x00, 0x00, 0x00, 0x00,
+  0x00, 0x02,                                                             // IFD1 at 140
+  0x01, 0x03, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x08,                                                 // Chain back to IFD0
+};
+
+// The segment walker must skip large segments, fill bytes and standalone
+// markers, and never look for EXIF past the start of scan
+static int test_segment_walker(void) {
+  static uint8_t jpeg[8192];
+  size_t pos = 0;
+  jpeg[pos++] = 0xFF;
+  jpeg[pos++] = 0xD8;
+  put_segment(jpeg, &pos, 0xE2, 4000);                    // ICC profile before APP1
+  jpeg[pos++] = 0xFF;                                     // Fill byte
+  uint8_t *app1 = put_segment(jpeg, &pos, 0xE1, 6 + sizeof(tiny_tiff));
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, tiny_tiff, sizeof(tiny_tiff));
+  put_segment(jpeg, &pos, 0xDA, 10);
+
+  char *json = parse_jpeg(jpeg, pos);
+  if (json == NULL || strcmp(json, "{\"Orientation\":6}") != 0) {
+    printf("Walker missed APP1 after APP2: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  // Move the APP1 after SOS, it is now scan data and must be ignored
+  pos = 2;
+  put_segment(jpeg, &pos, 0xDB, 64);
+  put_segment(jpeg, &pos, 0xDA, 10);
+  app1 = put_segment(jpeg, &pos, 0xE1, 6 + sizeof(tiny_tiff));
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, tiny_tiff, sizeof(tiny_tiff));
+
+  size_t required = 0;
+  if (parse_jpeg_into(jpeg, pos, NULL, 0, &required) != ERR_EXIF_MISSING) {
+    printf("Walker read EXIF from scan data\n");
+    return 1;
+  }
+
+  printf("SEGMENT WALKER OK\n");
+  return 0;
+}
+
+// Only the selected tags are reported, and the walk stops once all of them
+// have been seen, before it can reach a broken Exif IFD
+static int test_tag_selection(const uint8_t *buffer, size_t length) {
+  ExifTagSet tags;
+  exif_tagset_clear(&tags);
+  if (!exif_tagset_add(&tags, 0x0112) || !exif_tagset_add(&tags, 0x9003) || !exif_tagset_add(&tags, 0x010F) ||
+      !exif_tagset_add(&tags, 0x0112) || exif_tagset_add(&tags, 0x011A) || tags.count != 3) {
+    printf("Tag set did not track its tags\n");
+    return 1;
+  }
+
+  char *json = parse_jpeg_select(buffer, length, &tags);
+  if (json == NULL || strcmp(json, "{\"Make\":\"RICOH IMAGING COMPANY, LTD.  \",\"Orientation\":1,"
+                                   "\"DateTimeOriginal\":\"2022:08:30 17:27:15\"}") != 0) {
+    printf("Selected JSON does not match: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  ExifEntry entries[4];
+  size_t count = 0;
+  if (parse_jpeg_entries_select(buffer, length, &tags, entries, 4, &count) != ERR_OK || count != 3 ||
+      entries[2].tag != 0x9003) {
+    printf("Selected entries do not match\n");
+    return 1;
+  }
+
+  // IFD0 holds Orientation then an ExifOffset pointing past the TIFF data
+  static const uint8_t broken[] = {
+    0xFF, 0xD8, 0xFF, 0xE1, 0x00, 0x2E, 'E', 'x', 'i', 'f', 0x00, 0x00,
+    'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+    0x00, 0x02,
+    0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+    0x87, 0x69, 0x00, 0x04, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x10, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+  };
+  exif_tagset_clear(&tags);
+  exif_tagset_add(&tags, 0x0112);
+  if (parse_jpeg_entries(broken, sizeof(broken), NULL, 0, &count) != ERR_EXIF_OVERFLOW) {
+    printf("Broken Exif IFD was not reported\n");
+    return 1;
+  }
+  json = parse_jpeg_select(broken, sizeof(broken), &tags);
+  if (json == NULL || strcmp(json, "{\"Orientation\":6}") != 0) {
+    printf("Selection did not stop after Orientation: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  exif_tagset_clear(&tags);                               // Nothing selected, nothing walked
+  json = parse_jpeg_select(broken, sizeof(broken), &tags);
+  if (json == NULL || strcmp(json, "{}") != 0) {
+    printf("Empty selection reported tags\n");
+    return 1;
+  }
+  free(json);
+
+  printf("TAG SELECTION OK\n");
+  return 0;
+}
+
+// The index records every tag the eager parser reports and formats each
+// one only when asked, the same way parse_jpeg does
+static int test_lazy_index(const uint8_t *buffer, size_t length) {
+  static ExifIndex index;
+  size_t count = 0;
+  if (exif_index_build(&index, buffer, length) != ERR_OK ||
+      parse_jpeg_entries(buffer, length, NULL, 0, &count) != ERR_TOO_SMALL || index.count != count) {
+    printf("Index does not hold every entry\n");
+    return 1;
+  }
+
+  const char *value = NULL;
+  if (exif_get(&index, 0x010F, &value) != ERR_OK || strcmp(value, "\"RICOH IMAGING COMPANY, LTD.  \"") != 0) {
+    printf("Index formatted Make wrong\n");
+    return 1;
+  }
+  const char *again = NULL;
+  if (exif_get(&index, 0x010F, &again) != ERR_OK || again != value) {
+    printf("Index did not cache Make\n");
+    return 1;
+  }
+  if (exif_get(&index, 0x920A, &value) != ERR_OK || strcmp(value, "\"183/10\"") != 0 ||
+      exif_get(&index, 0x8827, &value) != ERR_OK || strcmp(value, "100") != 0) {
+    printf("Index formatted Exif IFD tags wrong\n");
+    return 1;
+  }
+  for (size_t i = 0; i < index.count; i++) {              // Nothing else was formatted
+    bool asked = index.records[i].tag == 0x010F || index.records[i].tag == 0x920A || index.records[i].tag == 0x8827;
+    if ((index.values[i] != NULL) != asked) {
+      printf("Index formatted 0x%04X unasked\n", index.records[i].tag);
+      return 1;
+    }
+  }
+
+  ExifEntry entry;
+  if (exif_get_entry(&index, 0xA003, &entry) != ERR_OK || entry.value.u != 2048 ||
+      exif_get_entry(&index, 0x0102, &entry) != ERR_INVALID_TAG || exif_get(&index, 0x8769, &value) != ERR_INVALID_TAG) {
+    printf("Index lookups are wrong\n");
+    return 1;
+  }
+
+  if (exif_index_build(&index, buffer, length) != ERR_OK || index.values[0] != NULL) {  // Frees the cached values
+    printf("Rebuilt index kept its values\n");
+    return 1;
+  }
+  exif_index_free(&index);
+  printf("LAZY INDEX OK\n");
+  return 0;
+}
+
+// Sub-IFDs are walked only when asked for, each IFD once however it is
+// linked, and tags are told apart by the IFD they were found in
+static int test_ifd_graph(void) {
+  static uint8_t jpeg[512];
+  size_t pos = 0;
+  jpeg[pos++] = 0xFF;
+  jpeg[pos++] = 0xD8;
+  uint8_t *app1 = put_segment(jpeg, &pos, 0xE1, 6 + sizeof(graph_tiff));
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, graph_tiff, sizeof(graph_tiff));
+  put_segment(jpeg, &pos, 0xDA, 10);
+
+  char *json = parse_jpeg(jpeg, pos);                    // IFD0 and Exif by default, GPS is opted into
+  if (json == NULL || strcmp(json, "{\"Orientation\":6,\"ISO\":100}") != 0) {
+    printf("Default IFDs do not match: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  ExifTagSet tags;
+  exif_tagset_clear(&tags);
+  exif_tagset_add_ifds(&tags, EXIF_IFDS_ALL);
+  json = parse_jpeg_select(jpeg, pos, &tags);
+  if (json == NULL || strcmp(json, "{\"Orientation\":6,\"ISO\":100,\"GPSLatitudeRef\":\"N\",\"GPSAltitudeRef\":\"0x01\","
+                                   "\"IFD1:Compression\":6,\"IFD1:Orientation\":1,\"InteropIndex\":\"R98\"}") != 0) {
+    printf("All IFDs do not match: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  tags.count = 0;                                         // GPS without the Exif IFD or IFD1
+  memset(tags.bits, 0, sizeof(tags.bits));
+  tags.ifds = 0;
+  exif_tagset_add_ifds(&tags, EXIF_IFD_BIT(EXIF_IFD_0) | EXIF_IFD_BIT(EXIF_IFD_GPS));
+  json = parse_jpeg_select(jpeg, pos, &tags);
+  if (json == NULL || strcmp(json, "{\"Orientation\":6,\"GPSLatitudeRef\":\"N\",\"GPSAltitudeRef\":\"0x01\"}") != 0) {
+    printf("GPS selection walked other IFDs: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  exif_tagset_clear(&tags);                               // One GPS tag, the walk ends in the GPS IFD
+  if (!exif_tagset_add_in(&tags, EXIF_IFD_GPS, 0x0001) || exif_tagset_add_in(&tags, EXIF_IFD_GPS, 0x0020) ||
+      !exif_tagset_has_in(&tags, EXIF_IFD_GPS, 0x0001) || exif_tagset_has(&tags, 0x0001)) {
+    printf("GPS tags are not kept apart\n");
+    return 1;
+  }
+  ExifEntry entries[4];
+  size_t count = 0;
+  if (parse_jpeg_entries_select(jpeg, pos, &tags, entries, 4, &count) != ERR_OK || count != 1 ||
+      entries[0].ifd != EXIF_IFD_GPS || entries[0].tag != 0x0001 || entries[0].data[0] != 'N') {
+    printf("GPS entry does not match\n");
+    return 1;
+  }
+
+  static ExifIndex index;
+  const char *value = NULL;
+  if (exif_index_build(&index, jpeg, pos) != ERR_OK || index.count != 7 ||
+      exif_get(&index, 0x0112, &value) != ERR_OK || strcmp(value, "6") != 0 ||
+      exif_get_in(&index, EXIF_IFD_1, 0x0112, &value) != ERR_OK || strcmp(value, "1") != 0 ||
+      exif_get_in(&index, EXIF_IFD_GPS, 0x0001, &value) != ERR_OK || strcmp(value, "\"N\"") != 0 ||
+      exif_get_in(&index, EXIF_IFD_INTEROP, 0x0001, &value) != ERR_OK || strcmp(value, "\"R98\"") != 0 ||
+      exif_get_in(&index, EXIF_IFD_1, 0x0201, &value) != ERR_INVALID_TAG) {
+    printf("Index does not keep the IFDs apart\n");
+    return 1;
+  }
+  exif_index_free(&index);
+
+  pos = 2;                                                // IFD1 cut off inside its second entry
+  app1 = put_segment(jpeg, &pos, 0xE1, 6 + 160);
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, graph_tiff, 160);
+  put_segment(jpeg, &pos, 0xDA, 10);
+  exif_tagset_clear(&tags);
+  exif_tagset_add_ifds(&tags, EXIF_IFDS_ALL);
+  json = parse_jpeg_select(jpeg, pos, &tags);
+  if (json == NULL || strcmp(json, "{\"Orientation\":6,\"ISO\":100,\"GPSLatitudeRef\":\"N\",\"GPSAltitudeRef\":\"0x01\","
+                                   "\"IFD1:Compression\":6,\"InteropIndex\":\"R98\"}") != 0) {
+    printf("Truncated IFD1 lost the other IFDs: %s\n", json ? json : "(null)");
+    return 1;
+  }
+  free(json);
+
+  printf("IFD GRAPH OK\n");
+  return 0;
+}
+
 int main() {
   const char *filename = "tests/example.jpeg";
 
@@ -65,6 +351,103 @@ int main() {
   fflush(stdout);
 
 
+  // Size query followed by writes into caller memory
+  size_t required = 0;
+  if (parse_jpeg_into(buffer, filesize, NULL, 0, &required) != ERR_TOO_SMALL ||
+      required != strlen(response) + 1) {
+    printf("Size query returned %zu\n", required);
+    return 1;
+  }
+
+  char small[16];
+  if (parse_jpeg_into(buffer, filesize, small, sizeof(small), &required) != ERR_TOO_SMALL ||
+      strncmp(small, response, sizeof(small) - 1) != 0 || small[sizeof(small) - 1] != '\0') {
+    printf("Truncated output does not match\n");
+    return 1;
+  }
+
+  char *exact = malloc(required);
+  if (!exact || parse_jpeg_into(buffer, filesize, exact, required, &required) != ERR_OK ||
+      strcmp(exact, response) != 0) {
+    printf("Caller buffer output does not match\n");
+    return 1;
+  }
+  printf("CALLER BUFFER OK\n");
+  free(exact);
+
+
+  // Typed entries decode the same values without any formatting
+  size_t count = 0;
+  if (parse_jpeg_entries(buffer, filesize, NULL, 0, &count) != ERR_TOO_SMALL || count == 0) {
+    printf("Entry count query failed\n");
+    return 1;
+  }
+
+  ExifEntry *entries = malloc(count * sizeof(ExifEntry));
+  if (!entries || parse_jpeg_entries(buffer, filesize, entries, count, &count) != ERR_OK) {
+    printf("Failed to decode entries\n");
+    return 1;
+  }
+
+  bool found_iso = false, found_focal = false, found_make = false;
+  for (size_t i = 0; i < count; i++) {
+    if (entries[i].tag == 0x8827) {
+      found_iso = entries[i].type == EXIF_TYPE_SHORT && entries[i].value.u == 100;
+    } else if (entries[i].tag == 0x920A) {
+      found_focal = entries[i].value.rational.numerator == 183 &&
+                    entries[i].value.rational.denominator == 10;
+    } else if (entries[i].tag == 0x010F) {
+      found_make = entries[i].data > buffer && entries[i].data < buffer + filesize &&
+                   strncmp((const char *)entries[i].data, "RICOH", 5) == 0;
+    }
+  }
+  if (!found_iso || !found_focal || !found_make) {
+    printf("Entries did not decode ISO, FocalLength and Make\n");
+    return 1;
+  }
+
+  char *from_entries = malloc(required);
+  if (!from_entries || exif_entries_to_json(entries, count, from_entries, required, &required) != ERR_OK ||
+      strcmp(from_entries, response) != 0) {
+    printf("Entry JSON does not match\n");
+    return 1;
+  }
+  printf("TYPED ENTRIES OK\n");
+
+
+  // Every tag in the table must be found in its own slot, unknown tags never
+  for (uint32_t slot = 0; slot < EXIF_TAG_SLOTS; slot++) {
+    const ExifTag *known = &exif_tag_table[slot];
+    if (known->name != NULL &&
+        (exif_tag_lookup(known->tag) != known || known->name_len != strlen(known->name))) {
+      printf("Tag 0x%04X is not found by lookup\n", known->tag);
+      return 1;
+    }
+  }
+  if (exif_tag_lookup(0x0000) != NULL || exif_tag_lookup(0xFFFF) != NULL ||
+      exif_tag_lookup(0x011A) != NULL) {
+    printf("Unknown tag was found by lookup\n");
+    return 1;
+  }
+  printf("TAG LOOKUP OK\n");
+  free(entries);
+  free(from_entries);
+  free(response);
+
+
+  if (test_segment_walker() != 0) {
+    return 1;
+  }
+  if (test_tag_selection(buffer, filesize) != 0) {
+    return 1;
+  }
+  if (test_lazy_index(buffer, filesize) != 0) {
+    return 1;
+  }
+  if (test_ifd_graph() != 0) {
+    return 1;
+  }
+
   // Cleanup
   free(buffer);
   fclose(file);
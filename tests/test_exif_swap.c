@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exif_parser.h"
+#include "exif_swap.h"
+#include "exif_writer.h"
+#include "output_builder.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+#define MAX_COUNT 300
+#define STRIPS 3000
+
+// Every length up to past two AVX2 blocks, from every misalignment, so each
+// kernel and every tail length is compared against a byte by byte decode
+static int loaders(bool big_endian) {
+  static uint8_t raw[4 * MAX_COUNT + 4];
+  static uint16_t shorts[MAX_COUNT + 1];
+  static uint32_t longs[MAX_COUNT + 1];
+
+  for (size_t i = 0; i < sizeof(raw); i++) {
+    raw[i] = (uint8_t)(i * 37 + 11);
+  }
+
+  for (size_t skew = 0; skew < 4; skew++) {
+    const uint8_t *src = raw + skew;
+    for (size_t count = 0; count <= MAX_COUNT; count++) {
+      shorts[count] = 0xBEEF;            // Guards, the loaders must stop at count
+      longs[count] = 0xDEADBEEF;
+      exif_load_u16(shorts, src, count, big_endian);
+      exif_load_u32(longs, src, count, big_endian);
+
+      for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = src + 2 * i;
+        uint16_t want16 = big_endian ? (uint16_t)(p[0] << 8 | p[1]) : (uint16_t)(p[1] << 8 | p[0]);
+        CHECK(shorts[i] == want16);
+
+        p = src + 4 * i;
+        uint32_t want32 = big_endian ? ((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3])
+                                     : ((uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 | (uint32_t)p[1] << 8 | p[0]);
+        CHECK(longs[i] == want32);
+      }
+      CHECK(shorts[count] == 0xBEEF && longs[count] == 0xDEADBEEF);
+    }
+  }
+  return 0;
+}
+
+// Array tags come back through parse_jpeg as JSON arrays and through
+// exif_entry_values in full
+static int arrays(bool big_endian) {
+  static const uint16_t bits[3] = { 8, 8, 8 };
+  static const uint16_t strip_counts[2] = { 512, 65535 };
+  static const uint32_t lens[8] = { 24, 1, 70, 1, 28, 10, 28, 10 };
+  static uint32_t strips[STRIPS];
+  static uint32_t values[2 * STRIPS];
+
+  for (size_t i = 0; i < STRIPS; i++) {
+    strips[i] = 0x10000000u + (uint32_t)i * 4099u;
+  }
+
+  ExifWriterEntry ifd0[] = {
+    { 0x0102, EXIF_TYPE_SHORT, 3, bits },
+    { 0x0111, EXIF_TYPE_LONG, STRIPS, strips },
+    { 0x0117, EXIF_TYPE_SHORT, 2, strip_counts },         // Inline in the value field
+  };
+  ExifWriterEntry exif[] = {
+    { 0xA432, EXIF_TYPE_RATIONAL, 4, lens },
+  };
+
+  OutputBuilder tiff;
+  OutputBuilder jpeg;
+  CHECK(builder_init(&tiff, 64) && builder_init(&jpeg, 64));
+  CHECK(exif_write_tiff(&tiff, big_endian, ifd0, 3, exif, 1) == ERR_OK);
+  ExifJpegLayout layout = { 0, 0, true, 16 };
+  CHECK(exif_write_jpeg(&jpeg, (const uint8_t *)tiff.data, tiff.len, &layout) == ERR_OK);
+
+  ExifEntry entries[4];
+  size_t count = 0;
+  CHECK(parse_jpeg_entries((const uint8_t *)jpeg.data, jpeg.len, entries, 4, &count) == ERR_OK);
+  CHECK(count == 4);
+
+  CHECK(exif_entry_values(&entries[1], 0, values, STRIPS) == STRIPS);
+  CHECK(memcmp(values, strips, sizeof(strips)) == 0);
+  CHECK(exif_entry_values(&entries[1], STRIPS - 5, values, 100) == 5);        // Stops at the last component
+  CHECK(values[4] == strips[STRIPS - 1]);
+  CHECK(exif_entry_values(&entries[1], STRIPS, values, 100) == 0);
+  CHECK(exif_entry_values(&entries[2], 0, values, 2) == 2 && values[0] == 512 && values[1] == 65535);
+  CHECK(exif_entry_values(&entries[3], 0, values, 7) == 6);                   // Only whole rationals
+  CHECK(memcmp(values, lens, 6 * sizeof(uint32_t)) == 0);
+
+  char *json = parse_jpeg((const uint8_t *)jpeg.data, jpeg.len);
+  CHECK(json != NULL);
+  static const char head[] = "{\"BitsPerSample\":[8,8,8],\"StripOffsets\":[268435456,268439555,";
+  CHECK(strncmp(json, head, sizeof(head) - 1) == 0);
+  CHECK(strstr(json, ",280728357],\"StripByteCounts\":[512,65535],"
+                     "\"LensSpecification\":[\"24/1\",\"70/1\",\"28/10\",\"28/10\"]}") != NULL);
+  free(json);
+
+  builder_free(&tiff);
+  builder_free(&jpeg);
+  return 0;
+}
+
+int main(void) {
+  CHECK(loaders(true) == 0);
+  CHECK(loaders(false) == 0);
+  CHECK(arrays(true) == 0);
+  CHECK(arrays(false) == 0);
+
+  printf("exif_swap: OK\n");
+  return 0;
+}
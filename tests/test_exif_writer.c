@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exif_parser.h"
+#include "exif_writer.h"
+#include "format_reader.h"
+#include "output_builder.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+static const char expected[] =
+  "{\"Make\":\"Writer\",\"Orientation\":6,\"Copyright\":\"Written for the round trip test\","
+  "\"ExposureTime\":\"1/250\",\"ISO\":400,\"ExifImageWidth\":4000}";
+
+// Writes a JPEG with the test entries and checks the parser reads them back
+static int round_trip(bool big_endian, size_t app2_count) {
+  static const char make[] = "Writer";
+  static const char copyright[] = "Written for the round trip test";
+  static const uint8_t blob[40] = { 1, 2, 3 };
+  static const uint16_t orientation = 6;
+  static const uint16_t iso = 400;
+  static const uint32_t width = 4000;
+  static const uint32_t exposure[2] = { 1, 250 };
+
+  ExifWriterEntry ifd0[] = {
+    { 0x010F, EXIF_TYPE_ASCII, sizeof(make), make },
+    { 0x0112, EXIF_TYPE_SHORT, 1, &orientation },
+    { 0x8298, EXIF_TYPE_ASCII, sizeof(copyright), copyright },
+  };
+  ExifWriterEntry exif[] = {
+    { 0x829A, EXIF_TYPE_RATIONAL, 1, exposure },
+    { 0x8827, EXIF_TYPE_SHORT, 1, &iso },
+    { 0xA002, EXIF_TYPE_LONG, 1, &width },
+    { 0xC123, EXIF_TYPE_UNDEFINED, sizeof(blob), blob },    // Unknown and out of line, skipped by the parser
+  };
+
+  OutputBuilder tiff;
+  OutputBuilder jpeg;
+  CHECK(builder_init(&tiff, 64) && builder_init(&jpeg, 64));
+  CHECK(exif_write_tiff(&tiff, big_endian, ifd0, 3, exif, 4) == ERR_OK);
+  CHECK(tiff.data[0] == (big_endian ? 'M' : 'I'));
+
+  ExifJpegLayout layout = { app2_count, 30000, true, 100 };
+  CHECK(exif_write_jpeg(&jpeg, (const uint8_t *)tiff.data, tiff.len, &layout) == ERR_OK);
+
+  ExifEntry entries[8];
+  size_t count = 0;
+  CHECK(parse_jpeg_entries((const uint8_t *)jpeg.data, jpeg.len, entries, 8, &count) == ERR_OK);
+  CHECK(count == 6);                      // The unknown tag is not reported
+  CHECK(entries[0].big_endian == big_endian);
+  CHECK(entries[3].value.rational.numerator == 1 && entries[3].value.rational.denominator == 250);
+  CHECK(entries[2].length == sizeof(copyright) && memcmp(entries[2].data, copyright, sizeof(copyright)) == 0);
+
+  char *json = parse_jpeg((const uint8_t *)jpeg.data, jpeg.len);
+  CHECK(json != NULL && strcmp(json, expected) == 0);
+  free(json);
+  CHECK(is_jpeg((const uint8_t *)jpeg.data, jpeg.len));  // The frame header makes it a valid JPEG
+
+  builder_free(&tiff);
+  builder_free(&jpeg);
+  return 0;
+}
+
+int main(void) {
+  CHECK(round_trip(true, 0) == 0);
+  CHECK(round_trip(false, 0) == 0);
+  CHECK(round_trip(true, 3) == 0);       // APP1 lands past the first 64K
+
+  // No APP1 at all
+  OutputBuilder jpeg;
+  CHECK(builder_init(&jpeg, 64));
+  ExifJpegLayout bare = { 1, 100, false, 100 };
+  CHECK(exif_write_jpeg(&jpeg, NULL, 0, &bare) == ERR_OK);
+  size_t tiff_offset = 0;
+  size_t tiff_length = 0;
+  CHECK(jpeg_find_exif((const uint8_t *)jpeg.data, jpeg.len, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+  CHECK(is_jpeg((const uint8_t *)jpeg.data, jpeg.len));
+
+  // Blocks that cannot fit in one segment are refused without writing
+  size_t before = jpeg.len;
+  ExifJpegLayout oversized = { 0, 0, true, 0 };
+  CHECK(exif_write_jpeg(&jpeg, (const uint8_t *)jpeg.data, EXIF_WRITER_MAX_TIFF + 1, &oversized) == ERR_EXIF_OVERFLOW);
+  CHECK(jpeg.len == before);
+
+  // Unknown types cannot be sized
+  static const uint8_t raw[8] = { 0 };
+  ExifWriterEntry bad = { 0x010F, 99, 8, raw };
+  OutputBuilder tiff;
+  CHECK(builder_init(&tiff, 64));
+  CHECK(exif_write_tiff(&tiff, true, &bad, 1, NULL, 0) == ERR_INVALID_TAG);
+  CHECK(tiff.len == 0);
+  bad.count = 0;                                          // Not even as an empty entry
+  CHECK(exif_write_tiff(&tiff, true, NULL, 0, &bad, 1) == ERR_INVALID_TAG);
+  CHECK(tiff.len == 0);
+
+  builder_free(&tiff);
+  builder_free(&jpeg);
+  printf("exif_writer: OK\n");
+  return 0;
+}
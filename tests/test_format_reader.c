@@ -1,9 +1,111 @@
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include "exif_parser.h"
+#include "format_reader.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+// ftyp boxes, a generic HEIF major brand with and without an AV1 compatible brand
+static const uint8_t heif_avif[] = {
+  0x00, 0x00, 0x00, 0x1C, 'f', 't', 'y', 'p', 'm', 'i', 'f', '1', 0x00, 0x00, 0x00, 0x00,
+  'm', 'i', 'f', '1', 'm', 'i', 'a', 'f', 'a', 'v', 'i', 'f',
+};
+static const uint8_t heif_hevc[] = {
+  0x00, 0x00, 0x00, 0x18, 'f', 't', 'y', 'p', 'm', 'i', 'f', '1', 0x00, 0x00, 0x00, 0x00,
+  'm', 'i', 'f', '1', 'h', 'e', 'i', 'c', 'a', 'v', 'i', 'f',        // avif lies past the box
+};
+
+static uint8_t *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = malloc((size_t)size);
+  if (data != NULL && fread(data, 1, (size_t)size, file) != (size_t)size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *length = (size_t)size;
+  return data;
+}
+
+#define SNIFF(bytes) readImageFormat((const uint8_t *)(bytes), sizeof(bytes) - 1)
+
+int main(void) {
+  // Every signature, each from no more than its own bytes
+  CHECK(SNIFF("\xFF\xD8\xFF") == IMAGE_FORMAT_JPEG);
+  CHECK(SNIFF("\x89PNG\r\n\x1A\n") == IMAGE_FORMAT_PNG);
+  CHECK(SNIFF("RIFF\x10\x00\x00\x00WEBP") == IMAGE_FORMAT_WEBP);
+  CHECK(SNIFF("RIFF\x10\x00\x00\x00WAVE") == IMAGE_FORMAT_UNKNOWN);
+  CHECK(SNIFF("II*\0") == IMAGE_FORMAT_TIFF && SNIFF("MM\0*") == IMAGE_FORMAT_TIFF);
+  CHECK(SNIFF("\xFF\x0A") == IMAGE_FORMAT_JXL);
+  CHECK(SNIFF("\0\0\0\x0CJXL \r\n\x87\n") == IMAGE_FORMAT_JXL);
+  CHECK(SNIFF("\0\0\0\x18" "ftypheic") == IMAGE_FORMAT_HEIC);
+  CHECK(SNIFF("\0\0\0\x18" "ftypavif") == IMAGE_FORMAT_AVIF);
+  CHECK(readImageFormat(heif_avif, sizeof(heif_avif)) == IMAGE_FORMAT_AVIF);
+  CHECK(readImageFormat(heif_hevc, sizeof(heif_hevc)) == IMAGE_FORMAT_HEIC);
+  CHECK(is_avif(heif_avif, sizeof(heif_avif)) && is_heic(heif_hevc, sizeof(heif_hevc)));
+
+  // Prefixes shorter than a signature match nothing
+  CHECK(SNIFF("\xFF\xD8") == IMAGE_FORMAT_UNKNOWN);
+  CHECK(SNIFF("\x89PNG") == IMAGE_FORMAT_UNKNOWN && !is_png((const uint8_t *)"\x89PNG", 4));
+  CHECK(SNIFF("RIFF\x10\x00\x00\x00WEB") == IMAGE_FORMAT_UNKNOWN && !is_webp((const uint8_t *)"RIFF", 4));
+  CHECK(readImageFormat(tiny_tiff, 0) == IMAGE_FORMAT_UNKNOWN);
+  CHECK(exif_locator(IMAGE_FORMAT_UNKNOWN) == NULL && exif_locator(IMAGE_FORMAT_PNG) != NULL);
+
+  // A JPEG routes to the marker walk and parses as parse_jpeg does
+  size_t length = 0;
+  uint8_t *jpeg = read_file("tests/example.jpeg", &length);
+  CHECK(jpeg != NULL);
+
+  ImageFormat format = IMAGE_FORMAT_UNKNOWN;
+  size_t tiff_offset = 0;
+  size_t tiff_length = 0;
+  size_t found_offset = 0;
+  size_t found_length = 0;
+  CHECK(exif_locate(jpeg, length, &format, &tiff_offset, &tiff_length, NULL) == ERR_OK && format == IMAGE_FORMAT_JPEG);
+  CHECK(jpeg_find_exif(jpeg, length, &found_offset, &found_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == found_offset && tiff_length == found_length);
+
+  char *direct = parse_jpeg(jpeg, length);
+  char *routed = parse_image(jpeg, length);
+  CHECK(direct != NULL && routed != NULL && strcmp(direct, routed) == 0);
+  free(direct);
+  free(routed);
+  free(jpeg);
+
+  // A bare TIFF is its own EXIF block
+  CHECK(exif_locate(tiny_tiff, sizeof(tiny_tiff), &format, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(format == IMAGE_FORMAT_TIFF && tiff_offset == 0 && tiff_length == sizeof(tiny_tiff));
+  routed = parse_image(tiny_tiff, sizeof(tiny_tiff));
+  CHECK(routed != NULL && strcmp(routed, "{\"Orientation\":6}") == 0);
+  free(routed);
 
-int main() {
-    uint8_t data[] = {0x01, 0x02, 0x03, 0x04};
+  // Unknown data has no EXIF
+  CHECK(exif_locate((const uint8_t *)"GIF89a", 6, &format, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+  CHECK(format == IMAGE_FORMAT_UNKNOWN && parse_image((const uint8_t *)"GIF89a", 6) == NULL);
 
-    return 0;
+  printf("format_reader: OK\n");
+  return 0;
 }
@@ -0,0 +1,251 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exif_io.h"
+#include "exif_parser.h"
+#include "format_reader.h"
+#include "heif_boxes.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+// Exif item data, the offset to the TIFF header skips "Exif\0\0"
+#define EXIF_ITEM_LENGTH (4 + 6 + sizeof(tiny_tiff))
+
+static size_t put_be(uint8_t *out, size_t pos, uint64_t value, int bytes) {
+  for (int i = bytes - 1; i >= 0; i--) {
+    out[pos++] = (uint8_t)(value >> (8 * i));
+  }
+  return pos;
+}
+
+static size_t put_exif_item(uint8_t *out, size_t pos) {
+  pos = put_be(out, pos, 6, 4);
+  memcpy(out + pos, "Exif\0\0", 6);
+  memcpy(out + pos + 6, tiny_tiff, sizeof(tiny_tiff));
+  return pos + 6 + sizeof(tiny_tiff);
+}
+
+// Opens a box, its size is written by close_box
+static size_t open_box(uint8_t *out, size_t pos, const char *type, int version) {
+  pos = put_be(out, pos, 0, 4);
+  memcpy(out + pos, type, 4);
+  pos += 4;
+  return (version >= 0) ? put_be(out, pos, (uint64_t)version << 24, 4) : pos;
+}
+
+static void close_box(uint8_t *out, size_t start, size_t end) {
+  put_be(out, start, end - start, 4);
+}
+
+static size_t put_infe(uint8_t *out, size_t pos, uint16_t id, const char *type) {
+  size_t start = pos;
+  pos = open_box(out, pos, "infe", 2);
+  pos = put_be(out, pos, id, 2);
+  pos = put_be(out, pos, 0, 2);
+  memcpy(out + pos, type, 4);
+  out[pos + 4] = 0;                                       // Empty item name
+  pos += 5;
+  close_box(out, start, pos);
+  return pos;
+}
+
+// ftyp, then meta and mdat in either order. The image item is image_size
+// bytes of mdat. The Exif item is in mdat after it, or in idat when in_idat,
+// which needs iloc version 1. Sets exif_at to the file offset of the item.
+static size_t build_heif(uint8_t *out, const char *brand, size_t image_size, bool meta_last, bool in_idat,
+                         size_t *exif_at) {
+  size_t pos = open_box(out, 0, "ftyp", -1);
+  memcpy(out + pos, brand, 4);
+  pos = put_be(out, pos + 4, 0, 4);
+  memcpy(out + pos, "mif1", 4);
+  pos += 4;
+  close_box(out, 0, pos);
+
+  size_t mdat = pos;
+  size_t meta_size = 0;
+  for (int pass = 0; pass < 2; pass++) {                  // The first pass sizes meta so mdat offsets are known
+    size_t meta = meta_last ? mdat + 8 + image_size + (in_idat ? 0 : EXIF_ITEM_LENGTH) : pos;
+    size_t data = meta_last ? mdat + 8 : pos + meta_size + 8;
+    size_t p = open_box(out, meta, "meta", 0);
+
+    size_t iinf = p;
+    p = open_box(out, p, "iinf", 0);
+    p = put_be(out, p, 2, 2);
+    p = put_infe(out, p, 1, "hvc1");
+    p = put_infe(out, p, 2, "Exif");
+    close_box(out, iinf, p);
+
+    size_t iloc = p;
+    p = open_box(out, p, "iloc", in_idat ? 1 : 0);
+    out[p++] = 0x44;                                      // 32 bit offsets and lengths
+    out[p++] = 0x00;
+    p = put_be(out, p, 2, 2);
+    p = put_be(out, p, 1, 2);
+    p = in_idat ? put_be(out, p, 0, 2) : p;
+    p = put_be(out, p, 0, 2);
+    p = put_be(out, p, 1, 2);
+    p = put_be(out, p, data, 4);
+    p = put_be(out, p, image_size, 4);
+    p = put_be(out, p, 2, 2);
+    p = in_idat ? put_be(out, p, 1, 2) : p;               // construction_method 1
+    p = put_be(out, p, 0, 2);
+    p = put_be(out, p, 1, 2);
+    p = put_be(out, p, in_idat ? 0 : data + image_size, 4);
+    p = put_be(out, p, EXIF_ITEM_LENGTH, 4);
+    close_box(out, iloc, p);
+
+    if (in_idat) {
+      size_t idat = p;
+      p = open_box(out, p, "idat", -1);
+      *exif_at = p;
+      p = put_exif_item(out, p);
+      close_box(out, idat, p);
+    } else {
+      *exif_at = data + image_size;
+    }
+    close_box(out, meta, p);
+    meta_size = p - meta;
+  }
+
+  size_t meta = meta_last ? mdat + 8 + image_size + (in_idat ? 0 : EXIF_ITEM_LENGTH) : pos;
+  if (!meta_last) {
+    mdat = pos + meta_size;
+  }
+  size_t p = open_box(out, mdat, "mdat", -1);
+  memset(out + p, 0x55, image_size);
+  p += image_size;
+  if (!in_idat) {
+    p = put_exif_item(out, p);
+  }
+  close_box(out, mdat, p);
+  return meta_last ? meta + meta_size : p;
+}
+
+// A JPEG XL container: the signature box, ftyp, a jxlc codestream of
+// image_size bytes and the Exif box. Sets exif_at to the Exif box payload.
+static size_t build_jxl(uint8_t *out, size_t image_size, size_t *exif_at) {
+  memcpy(out, JXL_SIGNATURE, JXL_SIGNATURE_LENGTH);
+  size_t pos = open_box(out, JXL_SIGNATURE_LENGTH, "ftyp", -1);
+  memcpy(out + pos, "jxl \0\0\0\0jxl ", 12);
+  close_box(out, JXL_SIGNATURE_LENGTH, pos + 12);
+
+  size_t jxlc = pos + 12;
+  pos = open_box(out, jxlc, "jxlc", -1);
+  memset(out + pos, 0x55, image_size);
+  close_box(out, jxlc, pos + image_size);
+
+  size_t exif = pos + image_size;
+  *exif_at = open_box(out, exif, "Exif", -1);
+  pos = put_exif_item(out, *exif_at);
+  close_box(out, exif, pos);
+  return pos;
+}
+
+int main(void) {
+  static uint8_t heif[1 << 20];
+  size_t tiff_offset = 0;
+  size_t tiff_length = 0;
+  size_t needed = 0;
+  size_t exif_at = 0;
+
+  // meta ahead of mdat, the item is found through iinf and iloc
+  size_t length = build_heif(heif, "heic", 1000, false, false, &exif_at);
+  CHECK(readImageFormat(heif, length) == IMAGE_FORMAT_HEIC && is_heic(heif, length));
+  CHECK(heif_find_exif(heif, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == exif_at + 4 + 6 && tiff_length == sizeof(tiny_tiff));
+
+  char *json = parse_image(heif, length);
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+
+  // A prefix holding meta but not the item asks for the item only
+  CHECK(heif_find_exif(heif, exif_at, &tiff_offset, &tiff_length, &needed) == ERR_TIFF_OVERFLOW);
+  CHECK(needed == exif_at + EXIF_ITEM_LENGTH);
+  CHECK(heif_find_exif(heif, 40, &tiff_offset, &tiff_length, &needed) == ERR_TRUNCATED && needed > 40);
+
+  // AVIF with the item in idat, read with meta
+  length = build_heif(heif, "avif", 1000, false, true, &exif_at);
+  CHECK(is_avif(heif, length));
+  CHECK(heif_find_exif(heif, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == exif_at + 4 + 6 && tiff_length == sizeof(tiny_tiff));
+
+  // A TIFF header offset past the item, and no Exif item at all
+  length = build_heif(heif, "heic", 100, false, true, &exif_at);
+  heif[exif_at + 3] = 0xF0;
+  CHECK(heif_find_exif(heif, length, &tiff_offset, &tiff_length, NULL) == ERR_TIFF_MISSING);
+  length = build_heif(heif, "heic", 100, false, false, &exif_at);
+  size_t infe = 0;
+  while (infe + 4 <= length && memcmp(heif + infe, "Exif", 4) != 0) {
+    infe++;
+  }
+  CHECK(infe + 4 <= length);
+  memcpy(heif + infe, "mime", 4);                         // The infe type comes before the item data
+  CHECK(heif_find_exif(heif, length, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+
+  // From a file only the box headers, meta and the item are read, mdat is seeked over
+  length = build_heif(heif, "heic", 600000, true, false, &exif_at);
+  CHECK(heif_find_exif(heif, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  FILE *file = tmpfile();
+  CHECK(file != NULL && fwrite(heif, 1, length, file) == length && fflush(file) == 0);
+  uint8_t *tiff = NULL;
+  CHECK(exif_read_heif(fileno(file), &tiff, &tiff_length) == ERR_OK);
+  CHECK(tiff_length == sizeof(tiny_tiff) && memcmp(tiff, tiny_tiff, sizeof(tiny_tiff)) == 0);
+  free(tiff);
+  json = exif_parse_fd(fileno(file));
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  fclose(file);
+
+  length = build_heif(heif, "avif", 600000, false, true, &exif_at);
+  file = tmpfile();
+  CHECK(file != NULL && fwrite(heif, 1, length, file) == length && fflush(file) == 0);
+  CHECK(exif_read_heif(fileno(file), &tiff, &tiff_length) == ERR_OK);
+  CHECK(tiff_length == sizeof(tiny_tiff) && memcmp(tiff, tiny_tiff, sizeof(tiny_tiff)) == 0);
+  free(tiff);
+  fclose(file);
+
+  // JPEG XL keeps the same payload in a top level Exif box past the codestream
+  length = build_jxl(heif, 600000, &exif_at);
+  CHECK(readImageFormat(heif, length) == IMAGE_FORMAT_JXL);
+  CHECK(jxl_find_exif(heif, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == exif_at + 4 + 6 && tiff_length == sizeof(tiny_tiff));
+  json = parse_image(heif, length);
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  CHECK(jxl_find_exif(heif, 64, &tiff_offset, &tiff_length, &needed) == ERR_TRUNCATED && needed == exif_at - 8 + 16);
+  CHECK(jxl_find_exif(heif, exif_at, &tiff_offset, &tiff_length, &needed) == ERR_TIFF_OVERFLOW &&
+        needed == exif_at + EXIF_ITEM_LENGTH);
+  CHECK(jxl_find_exif((const uint8_t *)"\xFF\x0A\0\0", 4, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+
+  file = tmpfile();
+  CHECK(file != NULL && fwrite(heif, 1, length, file) == length && fflush(file) == 0);
+  CHECK(exif_read_jxl(fileno(file), &tiff, &tiff_length) == ERR_OK);
+  CHECK(tiff_length == sizeof(tiny_tiff) && memcmp(tiff, tiny_tiff, sizeof(tiny_tiff)) == 0);
+  free(tiff);
+  json = exif_parse_fd(fileno(file));
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  fclose(file);
+
+  printf("heif_boxes: OK\n");
+  return 0;
+}
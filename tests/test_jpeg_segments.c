@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exif_parser.h"
+#include "format_reader.h"
+#include "jpeg_segments.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+static uint8_t *read_file(const char *path, size_t *length) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t *data = malloc((size_t)size);
+  if (data != NULL && fread(data, 1, (size_t)size, file) != (size_t)size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *length = (size_t)size;
+  return data;
+}
+
+// Appends a marker segment with a zero filled payload and returns its payload
+static uint8_t *put_segment(uint8_t *out, size_t *pos, uint8_t marker, size_t payload) {
+  out[(*pos)++] = 0xFF;
+  out[(*pos)++] = marker;
+  out[(*pos)++] = (uint8_t)((payload + 2) >> 8);
+  out[(*pos)++] = (uint8_t)(payload + 2);
+  memset(out + *pos, 0, payload);
+  *pos += payload;
+  return out + *pos - payload;
+}
+
+static void put_exif(uint8_t *out, size_t *pos) {
+  uint8_t *app1 = put_segment(out, pos, 0xE1, 6 + sizeof(tiny_tiff));
+  memcpy(app1, "Exif\0\0", 6);
+  memcpy(app1 + 6, tiny_tiff, sizeof(tiny_tiff));
+}
+
+int main(void) {
+  size_t length = 0;
+  uint8_t *jpeg = read_file("tests/example.jpeg", &length);
+  CHECK(jpeg != NULL);
+
+  // One walk gives the table, the Exif segment and the parse
+  JpegIndex index;
+  size_t needed = 0;
+  CHECK(jpeg_index_build(jpeg, length, &index, &needed) == ERR_OK);
+  CHECK(index.count == 14 && index.total == 14 && index.frame && index.garbage == 0);
+  CHECK(index.segments[0].marker == 0xD8 && index.segments[13].marker == 0xDA && index.scan == 2051 + 2 + 12);
+
+  const JpegSegment *app1 = jpeg_index_find(&index, 0xE1);
+  CHECK(app1 != NULL && app1->offset == 20 && app1->length == 736);
+  CHECK(jpeg_index_find(&index, 0xFE) == NULL);
+
+  size_t tiff_offset = 0;
+  size_t tiff_length = 0;
+  size_t found_offset = 0;
+  size_t found_length = 0;
+  CHECK(jpeg_index_exif(&index, &tiff_offset, &tiff_length) == ERR_OK);
+  CHECK(jpeg_find_exif(jpeg, length, &found_offset, &found_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == found_offset && tiff_length == found_length);
+
+  char *direct = parse_jpeg(jpeg, length);
+  char *indexed = parse_jpeg_indexed(jpeg, length, &index);
+  CHECK(direct != NULL && indexed != NULL && strcmp(direct, indexed) == 0);
+  free(indexed);
+
+  // The parse leaves the same table behind for format detection
+  JpegIndex kept;
+  indexed = parse_jpeg_keep_index(jpeg, length, &kept);
+  CHECK(indexed != NULL && strcmp(direct, indexed) == 0 && jpeg_index_valid(&kept));
+  CHECK(kept.total == index.total && kept.scan == index.scan && kept.tiff_offset == tiff_offset);
+  free(direct);
+  free(indexed);
+  CHECK(is_jpeg(jpeg, length));
+
+  // A prefix that stops inside the tables asks for more
+  CHECK(jpeg_index_build(jpeg, 1500, &index, &needed) == ERR_TRUNCATED && needed > 1500);
+  CHECK(index.exif && index.scan == 0 && index.count == 7);
+  CHECK(jpeg_index_build(jpeg, 2053, &index, &needed) == ERR_TRUNCATED && needed == 2055);
+  CHECK(!is_jpeg(jpeg, 1500));
+  free(jpeg);
+
+  // No frame header, the EXIF is still found but the file is not valid
+  static uint8_t built[4096];
+  size_t pos = 0;
+  built[pos++] = 0xFF;
+  built[pos++] = 0xD8;
+  put_exif(built, &pos);
+  put_segment(built, &pos, 0xDA, 10);
+  CHECK(jpeg_index_build(built, pos, &index, NULL) == ERR_JPEG_INVALID && index.exif && index.scan == pos);
+  CHECK(jpeg_find_exif(built, pos, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(jpeg_index_locate(built, pos, &index, &found_offset, &found_length) == ERR_OK && !jpeg_index_valid(&index));
+  CHECK(found_offset == tiff_offset && found_length == tiff_length);
+
+  // Stray bytes between segments
+  pos = 2;
+  put_exif(built, &pos);
+  built[pos++] = 0x12;
+  built[pos++] = 0x34;
+  put_segment(built, &pos, 0xC0, 15);
+  put_segment(built, &pos, 0xDA, 10);
+  CHECK(jpeg_index_build(built, pos, &index, NULL) == ERR_JPEG_INVALID && index.garbage == 2);
+  built[pos - 14 - 19 - 2] = 0xFF;                        // Fill bytes are allowed
+  built[pos - 14 - 19 - 1] = 0xFF;
+  CHECK(jpeg_index_build(built, pos, &index, NULL) == ERR_OK && index.garbage == 0);
+
+  // Lengths that cannot be walked, and EOI before any scan
+  pos = 2;
+  put_segment(built, &pos, 0xC0, 15);
+  built[pos++] = 0xFF;
+  built[pos++] = 0xDB;
+  built[pos++] = 0x00;
+  built[pos++] = 0x01;
+  CHECK(jpeg_index_build(built, pos, &index, NULL) == ERR_JPEG_INVALID);
+  pos -= 4;
+  built[pos++] = 0xFF;
+  built[pos++] = 0xD9;
+  CHECK(jpeg_index_build(built, pos, &index, NULL) == ERR_JPEG_INVALID && index.segments[index.count - 1].marker == 0xD9);
+  CHECK(jpeg_find_exif(built, pos, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+  CHECK(jpeg_index_locate(built, pos, &index, &tiff_offset, &tiff_length) == ERR_EXIF_MISSING);
+
+  // More segments than the table holds are still walked
+  pos = 2;
+  put_segment(built, &pos, 0xC0, 15);
+  for (int i = 0; i < 80; i++) {
+    put_segment(built, &pos, 0xE2, 4);
+  }
+  put_exif(built, &pos);
+  put_segment(built, &pos, 0xDA, 10);
+  CHECK(jpeg_index_build(built, pos, &index, NULL) == ERR_OK);
+  CHECK(index.count == JPEG_MAX_SEGMENTS && index.total == 84 && index.exif);
+  indexed = parse_jpeg_indexed(built, pos, &index);
+  CHECK(indexed != NULL && strcmp(indexed, "{\"Orientation\":6}") == 0);
+  free(indexed);
+
+  printf("jpeg_segments: OK\n");
+  return 0;
+}
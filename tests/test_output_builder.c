@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "output_builder.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+int main() {
+  OutputBuilder builder;
+  CHECK(builder_init(&builder, 4));
+
+  // Many small appends must grow the buffer without losing data
+  for (int i = 0; i < 1000; i++) {
+    builder_append(&builder, "ab", 2);
+  }
+  CHECK(builder.len == 2000);
+  CHECK(strlen(builder.data) == 2000);
+  CHECK(builder.cap > builder.len);
+
+  // Formatting larger than the remaining room triggers a grow
+  size_t before = builder.len;
+  builder_put_rational(&builder, 4294967295u, 1u);
+  CHECK(strcmp(builder.data + before, "4294967295/1") == 0);
+
+  // Rewinding drops a partially written entry
+  builder_putc(&builder, ',');
+  builder_rewind(&builder, before);
+  CHECK(builder.len == before);
+  CHECK(builder.data[before] == '\0');
+
+  char *out = builder_finish(&builder);
+  CHECK(out != NULL);
+  CHECK(builder.data == NULL);
+  free(out);
+
+  // A finished or freed builder drops writes instead of growing from nothing
+  builder_append(&builder, "ab", 2);
+  CHECK(builder.failed && builder.data == NULL && builder.len == 0);
+  CHECK(builder_init(&builder, 16));
+  builder_free(&builder);
+  CHECK(!builder_grow(&builder, 100) && builder_put_u32(&builder, 7) == 0);
+
+  // A fixed builder never writes past cap but still counts what it needed
+  char small[8];
+  OutputBuilder fixed;
+  builder_init_fixed(&fixed, small, sizeof(small));
+  builder_append(&fixed, "\"Make\":", 7);
+  CHECK(!builder_overflowed(&fixed));
+  builder_put_u32(&fixed, 123456u);
+  builder_putc(&fixed, '}');
+  CHECK(builder_overflowed(&fixed));
+  CHECK(builder_needed(&fixed) == 15);
+  CHECK(strcmp(small, "\"Make\":") == 0);
+
+  // NULL memory is a pure size query
+  builder_init_fixed(&fixed, NULL, 0);
+  builder_append(&fixed, "abc", 3);
+  CHECK(builder_needed(&fixed) == 4);
+
+  // Number writers match printf at every digit count boundary
+  static const uint32_t edges[] = { 0, 1, 9, 10, 99, 100, 999, 1000, 9999, 10000, 65535, 99999, 100000,
+                                    999999, 1000000, 9999999, 10000000, 99999999, 100000000, 999999999,
+                                    1000000000, 2147483647u, 2147483648u, 4294967295u };
+  OutputBuilder numbers;
+  char expect[64];
+  CHECK(builder_init(&numbers, 16));
+  for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+    for (int sign = 0; sign < 2; sign++) {
+      uint32_t u = sign ? 0u - edges[i] : edges[i];
+      int32_t d = (int32_t)u;
+      int32_t negated = (int32_t)(0u - u);            // -d overflows for INT32_MIN
+
+      builder_rewind(&numbers, 0);
+      CHECK(builder_put_u32(&numbers, u) == (size_t)snprintf(expect, sizeof(expect), "%u", u));
+      CHECK(strcmp(numbers.data, expect) == 0);
+
+      builder_rewind(&numbers, 0);
+      CHECK(builder_put_i32(&numbers, d) == (size_t)snprintf(expect, sizeof(expect), "%d", d));
+      CHECK(strcmp(numbers.data, expect) == 0);
+
+      builder_rewind(&numbers, 0);
+      CHECK(builder_put_srational(&numbers, d, negated) == (size_t)snprintf(expect, sizeof(expect), "%d/%d", d, negated));
+      CHECK(strcmp(numbers.data, expect) == 0);
+
+      builder_rewind(&numbers, 0);
+      CHECK(builder_put_rational(&numbers, u, edges[i]) == (size_t)snprintf(expect, sizeof(expect), "%u/%u", u, edges[i]));
+      CHECK(strcmp(numbers.data, expect) == 0);
+    }
+  }
+  builder_rewind(&numbers, 0);
+  CHECK(builder_put_hex8(&numbers, 0x0A) == 4 && builder_put_u16(&numbers, 65535) == 5);
+  CHECK(strcmp(numbers.data, "0x0A65535") == 0);
+  builder_free(&numbers);
+
+  // A full fixed builder keeps the digits that fit and counts the rest
+  builder_init_fixed(&fixed, small, sizeof(small));
+  builder_append(&fixed, "\"ISO\":", 6);
+  CHECK(builder_put_rational(&fixed, 4000, 1) == 6);
+  CHECK(builder_needed(&fixed) == 13);
+  CHECK(strcmp(small, "\"ISO\":4") == 0);
+
+  printf("output_builder: OK\n");
+  return 0;
+}
@@ -0,0 +1,139 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "exif_io.h"
+#include "exif_parser.h"
+#include "format_reader.h"
+#include "png_chunks.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+// Appends a chunk with its CRC, a NULL data is zero filled
+static size_t put_chunk(uint8_t *out, size_t pos, const char *type, const uint8_t *data, size_t length) {
+  out[pos++] = (uint8_t)(length >> 24);
+  out[pos++] = (uint8_t)(length >> 16);
+  out[pos++] = (uint8_t)(length >> 8);
+  out[pos++] = (uint8_t)length;
+  memcpy(out + pos, type, 4);
+  if (data != NULL) {
+    memcpy(out + pos + 4, data, length);
+  } else {
+    memset(out + pos + 4, 0, length);
+  }
+  uint32_t crc = png_crc(out + pos, length + 4);
+  pos += 4 + length;
+  out[pos++] = (uint8_t)(crc >> 24);
+  out[pos++] = (uint8_t)(crc >> 16);
+  out[pos++] = (uint8_t)(crc >> 8);
+  out[pos++] = (uint8_t)crc;
+  return pos;
+}
+
+// Signature, IHDR, idat_count IDAT chunks of idat_size, then eXIf before
+// or after them and IEND
+static size_t build_png(uint8_t *out, int idat_count, size_t idat_size, bool exif_first, bool exif) {
+  size_t pos = PNG_SIGNATURE_LENGTH;
+  memcpy(out, PNG_SIGNATURE, PNG_SIGNATURE_LENGTH);
+  pos = put_chunk(out, pos, "IHDR", NULL, 13);
+  if (exif && exif_first) {
+    pos = put_chunk(out, pos, "eXIf", tiny_tiff, sizeof(tiny_tiff));
+  }
+  for (int i = 0; i < idat_count; i++) {
+    pos = put_chunk(out, pos, "IDAT", NULL, idat_size);
+  }
+  if (exif && !exif_first) {
+    pos = put_chunk(out, pos, "eXIf", tiny_tiff, sizeof(tiny_tiff));
+  }
+  return put_chunk(out, pos, "IEND", NULL, 0);
+}
+
+int main(void) {
+  static uint8_t png[1 << 20];
+  size_t tiff_offset = 0;
+  size_t tiff_length = 0;
+  size_t needed = 0;
+
+  // The CRC the PNG specification gives for an empty IEND chunk
+  CHECK(png_crc((const uint8_t *)"IEND", 4) == 0xAE426082u);
+
+  // eXIf ahead of the image data
+  size_t length = build_png(png, 2, 100, true, true);
+  CHECK(png_find_exif(png, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == 8 + 25 + 8 && tiff_length == sizeof(tiny_tiff));
+  CHECK(png_check_exif(png, length, tiff_offset, tiff_length) == ERR_OK);
+
+  char *json = parse_image(png, length);
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+
+  // The walk never looks inside IDAT, a prefix ending in one asks for the next header
+  length = build_png(png, 3, 50000, false, true);
+  CHECK(png_find_exif(png, 1000, &tiff_offset, &tiff_length, &needed) == ERR_TRUNCATED);
+  CHECK(needed == 8 + 25 + 50012 + 8);
+  CHECK(png_find_exif(png, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == 8 + 25 + 3 * 50012 + 8);
+  CHECK(png_find_exif(png, tiff_offset + 4, &tiff_offset, &tiff_length, &needed) == ERR_TIFF_OVERFLOW);
+  CHECK(needed == tiff_offset + sizeof(tiny_tiff) + 4);
+
+  // A corrupt CRC is only reported when asked for
+  png[tiff_offset + 9] ^= 0x01;
+  CHECK(png_check_exif(png, length, tiff_offset, tiff_length) == ERR_CHECKSUM);
+  CHECK(png_find_exif(png, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(png_check_exif(png, tiff_offset + tiff_length, tiff_offset, tiff_length) == ERR_TRUNCATED);
+
+  // IEND, a corrupt length and a missing signature all end the search
+  length = build_png(png, 1, 10, true, false);
+  CHECK(png_find_exif(png, length, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+  png[8] = 0x80;
+  CHECK(png_find_exif(png, length, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+  CHECK(png_find_exif(tiny_tiff, sizeof(tiny_tiff), &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+
+  // From a file the IDAT chunks are seeked over, eXIf data may straddle the window
+  length = build_png(png, 20, 40000, false, true);
+  FILE *file = tmpfile();
+  CHECK(file != NULL && fwrite(png, 1, length, file) == length && fflush(file) == 0);
+  uint8_t *tiff = NULL;
+  CHECK(exif_read_png(fileno(file), &tiff, &tiff_length) == ERR_OK);
+  CHECK(tiff_length == sizeof(tiny_tiff) && memcmp(tiff, tiny_tiff, sizeof(tiny_tiff)) == 0);
+  free(tiff);
+  json = exif_parse_fd(fileno(file));
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  fclose(file);
+
+  size_t pos = build_png(png, 0, 0, true, false) - 12;    // Drop IEND, pad so eXIf data crosses the first window
+  pos = put_chunk(png, pos, "tEXt", NULL, EXIF_CHUNK_WINDOW - pos - 12 - 16);
+  pos = put_chunk(png, pos, "eXIf", tiny_tiff, sizeof(tiny_tiff));
+  pos = put_chunk(png, pos, "IEND", NULL, 0);
+  file = tmpfile();
+  CHECK(file != NULL && fwrite(png, 1, pos, file) == pos && fflush(file) == 0);
+  CHECK(exif_read_png(fileno(file), &tiff, &tiff_length) == ERR_OK);
+  CHECK(tiff_length == sizeof(tiny_tiff) && memcmp(tiff, tiny_tiff, sizeof(tiny_tiff)) == 0);
+  free(tiff);
+  CHECK(ftruncate(fileno(file), (off_t)(pos - 12 - 4 - 10)) == 0);  // Cut inside the eXIf data
+  CHECK(exif_read_png(fileno(file), &tiff, &tiff_length) == ERR_TIFF_OVERFLOW);
+  fclose(file);
+
+  printf("png_chunks: OK\n");
+  return 0;
+}
@@ -0,0 +1,139 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "exif_io.h"
+#include "exif_parser.h"
+#include "format_reader.h"
+#include "webp_chunks.h"
+
+#define CHECK(cond)                                                            \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);                 \
+      return 1;                                                                \
+    }                                                                          \
+  } while (0)
+
+// Minimal big endian TIFF block holding IFD0 with Orientation = 6
+static const uint8_t tiny_tiff[] = {
+  'M', 'M', 0x00, 0x2A, 0x00, 0x00, 0x00, 0x08,
+  0x00, 0x01,
+  0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00,
+};
+
+static void put_le32(uint8_t *out, size_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+  out[2] = (uint8_t)(value >> 16);
+  out[3] = (uint8_t)(value >> 24);
+}
+
+// Appends a chunk and its pad byte, a NULL data is zero filled
+static size_t put_chunk(uint8_t *out, size_t pos, const char *fourcc, const uint8_t *data, size_t size) {
+  memcpy(out + pos, fourcc, 4);
+  put_le32(out + pos + 4, size);
+  if (data != NULL) {
+    memcpy(out + pos + 8, data, size);
+  } else {
+    memset(out + pos + 8, 0, size);
+  }
+  pos += 8 + size;
+  if (size & 1) {
+    out[pos++] = 0;
+  }
+  return pos;
+}
+
+// Extended WebP: VP8X with flags, an odd sized VP8L bitstream of
+// bitstream_size and, when exif is set, an EXIF chunk with an optional
+// "Exif\0\0" prefix
+static size_t build_webp(uint8_t *out, uint8_t flags, size_t bitstream_size, bool exif, bool prefix) {
+  uint8_t vp8x[10] = { flags };
+  uint8_t payload[6 + sizeof(tiny_tiff)];
+  size_t pos = 12;
+
+  memcpy(out, "RIFF", 4);
+  memcpy(out + 8, "WEBP", 4);
+  pos = put_chunk(out, pos, "VP8X", vp8x, sizeof(vp8x));
+  pos = put_chunk(out, pos, "VP8L", NULL, bitstream_size);
+  if (exif) {
+    memcpy(payload, "Exif\0\0", 6);
+    memcpy(payload + 6, tiny_tiff, sizeof(tiny_tiff));
+    pos = prefix ? put_chunk(out, pos, "EXIF", payload, sizeof(payload))
+                 : put_chunk(out, pos, "EXIF", tiny_tiff, sizeof(tiny_tiff));
+  }
+  put_le32(out + 4, pos - 8);
+  return pos;
+}
+
+int main(void) {
+  static uint8_t webp[1 << 20];
+  size_t tiff_offset = 0;
+  size_t tiff_length = 0;
+  size_t needed = 0;
+
+  // The EXIF chunk past an odd sized bitstream, which is padded
+  size_t length = build_webp(webp, WEBP_FLAG_EXIF, 1001, true, false);
+  CHECK(readImageFormat(webp, length) == IMAGE_FORMAT_WEBP && is_webp(webp, length));
+  CHECK(webp_find_exif(webp, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == 12 + 18 + 8 + 1002 + 8 && tiff_length == sizeof(tiny_tiff));
+
+  char *json = parse_image(webp, length);
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+
+  // Some writers keep the JPEG APP1 identifier in front of the TIFF header
+  length = build_webp(webp, WEBP_FLAG_EXIF, 1001, true, true);
+  CHECK(webp_find_exif(webp, length, &tiff_offset, &tiff_length, NULL) == ERR_OK);
+  CHECK(tiff_offset == 12 + 18 + 8 + 1002 + 8 + 6 && tiff_length == sizeof(tiny_tiff));
+
+  // A prefix ending in the bitstream asks for the next header only
+  CHECK(webp_find_exif(webp, 100, &tiff_offset, &tiff_length, &needed) == ERR_TRUNCATED);
+  CHECK(needed == 12 + 18 + 8 + 1002 + 8 + 6);
+  CHECK(webp_find_exif(webp, 10, &tiff_offset, &tiff_length, &needed) == ERR_TRUNCATED && needed == WEBP_FLAGS_LENGTH);
+  CHECK(webp_find_exif(webp, length - 4, &tiff_offset, &tiff_length, &needed) == ERR_TIFF_OVERFLOW && needed == length);
+
+  // Without the flag the chunks are never walked, even when an EXIF chunk is there
+  length = build_webp(webp, 0x10, 1001, true, false);
+  CHECK(webp_has_exif(webp, WEBP_FLAGS_LENGTH, NULL) == ERR_EXIF_MISSING);
+  CHECK(webp_find_exif(webp, length, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+
+  // A flag with no chunk behind it stops at the end of the RIFF data
+  length = build_webp(webp, WEBP_FLAG_EXIF, 1001, false, false);
+  memset(webp + length, 0x45, 64);
+  CHECK(webp_find_exif(webp, length + 64, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+
+  // Simple lossy files cannot hold EXIF
+  length = put_chunk(webp, 12, "VP8 ", NULL, 64);
+  put_le32(webp + 4, length - 8);
+  CHECK(webp_find_exif(webp, length, &tiff_offset, &tiff_length, NULL) == ERR_EXIF_MISSING);
+
+  // From a file the bitstream is seeked over
+  length = build_webp(webp, WEBP_FLAG_EXIF, 500001, true, true);
+  FILE *file = tmpfile();
+  CHECK(file != NULL && fwrite(webp, 1, length, file) == length && fflush(file) == 0);
+  uint8_t *tiff = NULL;
+  CHECK(exif_read_webp(fileno(file), &tiff, &tiff_length) == ERR_OK);
+  CHECK(tiff_length == sizeof(tiny_tiff) && memcmp(tiff, tiny_tiff, sizeof(tiny_tiff)) == 0);
+  free(tiff);
+  json = exif_parse_fd(fileno(file));
+  CHECK(json != NULL && strcmp(json, "{\"Orientation\":6}") == 0);
+  free(json);
+  fclose(file);
+
+  length = build_webp(webp, 0, 500001, true, false);
+  file = tmpfile();
+  CHECK(file != NULL && fwrite(webp, 1, length, file) == length && fflush(file) == 0);
+  CHECK(exif_read_webp(fileno(file), &tiff, &tiff_length) == ERR_EXIF_MISSING);
+  CHECK(exif_parse_fd(fileno(file)) == NULL);
+  fclose(file);
+
+  printf("webp_chunks: OK\n");
+  return 0;
+}
@@ -0,0 +1,405 @@
+/*
+ * @file            tools/gen_corpus.c
+ * @description     Writes a deterministic corpus of synthetic JPEG and TIFF files for benchmarks and scale tests
+ * @author          Jesse Peterson
+ * @createTime      2026-10-17 14:05:37
+ * @lastModified    2026-10-17 14:05:37
+ */
+
+#define _POSIX_C_SOURCE 200809L                                         // mkdir
+
+#include "exif_parser.h"
+#include "exif_writer.h"
+#include "output_builder.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define CORPUS_MAX_ENTRIES 500
+#define CORPUS_ARENA (128 * 1024)                                       // Value bytes for one file
+#define CORPUS_TIFF_BUDGET (EXIF_WRITER_MAX_TIFF - 1024)                // Leave room for the known tags
+
+// **** Random source **** //
+
+// splitmix64, each file gets its own stream so any slice of a corpus can be
+// regenerated without the files before it
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15u);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    return z ^ (z >> 31);
+}
+
+static uint32_t pick(uint64_t *state, uint32_t low, uint32_t high) {
+    return low + (uint32_t)(next_random(state) % (uint64_t)(high - low + 1));
+}
+
+// **** File builder **** //
+
+typedef struct {
+    uint64_t rng;
+    uint8_t arena[CORPUS_ARENA];                                        // Backing store for entry values
+    size_t used;
+    ExifWriterEntry ifd0[CORPUS_MAX_ENTRIES];
+    size_t ifd0_count;
+    ExifWriterEntry exif[CORPUS_MAX_ENTRIES];
+    size_t exif_count;
+    size_t tiff_bytes;                                                  // Running estimate of the TIFF block size
+} CorpusFile;
+
+static void *arena_take(CorpusFile *file, size_t bytes) {
+    void *slot = file->arena + file->used;
+    file->used += (bytes + 7) & ~(size_t)7;                             // Keep every slot aligned for memcpy free reads
+    return slot;
+}
+
+static void add_entry(CorpusFile *file, bool in_exif, uint16_t tag, uint16_t type, uint32_t count, const void *values) {
+    static const uint8_t type_sizes[13] = { 0, 1, 1, 2, 4, 8, 1, 1, 2, 4, 8, 4, 8 };
+    size_t bytes = (size_t)type_sizes[type] * count;
+
+    ExifWriterEntry *entry = in_exif ? &file->exif[file->exif_count++] : &file->ifd0[file->ifd0_count++];
+    entry->tag = tag;
+    entry->type = type;
+    entry->count = count;
+    entry->values = values;
+    file->tiff_bytes += 12 + ((bytes > 4) ? bytes + 1 : 0);
+}
+
+static void add_ascii(CorpusFile *file, bool in_exif, uint16_t tag, const char *text) {
+    size_t length = strlen(text) + 1;                                   // The count includes the NUL
+    char *copy = arena_take(file, length);
+    memcpy(copy, text, length);
+    add_entry(file, in_exif, tag, EXIF_TYPE_ASCII, (uint32_t)length, copy);
+}
+
+static void add_short(CorpusFile *file, bool in_exif, uint16_t tag, uint16_t value) {
+    uint16_t *slot = arena_take(file, sizeof(uint16_t));
+    *slot = value;
+    add_entry(file, in_exif, tag, EXIF_TYPE_SHORT, 1, slot);
+}
+
+static void add_long(CorpusFile *file, bool in_exif, uint16_t tag, uint32_t value) {
+    uint32_t *slot = arena_take(file, sizeof(uint32_t));
+    *slot = value;
+    add_entry(file, in_exif, tag, EXIF_TYPE_LONG, 1, slot);
+}
+
+static void add_rational(CorpusFile *file, bool in_exif, uint16_t tag, uint32_t numerator, uint32_t denominator) {
+    uint32_t *slot = arena_take(file, 2 * sizeof(uint32_t));
+    slot[0] = numerator;
+    slot[1] = denominator;
+    add_entry(file, in_exif, tag, EXIF_TYPE_RATIONAL, 1, slot);
+}
+
+static void add_date(CorpusFile *file, bool in_exif, uint16_t tag) {
+    char date[20];
+    snprintf(date, sizeof(date), "%04u:%02u:%02u %02u:%02u:%02u", pick(&file->rng, 2000, 2026),
+             pick(&file->rng, 1, 12), pick(&file->rng, 1, 28), pick(&file->rng, 0, 23), pick(&file->rng, 0, 59),
+             pick(&file->rng, 0, 59));
+    add_ascii(file, in_exif, tag, date);
+}
+
+// ** Known tags ** //
+
+typedef enum {
+    KNOWN_MAKE,                                                         // Make and Model come from the same camera
+    KNOWN_MODEL,
+    KNOWN_DATE,
+    KNOWN_COPYRIGHT,
+    KNOWN_SHORT,
+    KNOWN_LONG,
+    KNOWN_RATIONAL,                                                     // low..high over denominator
+    KNOWN_EXPOSURE,                                                     // 1 over low..high
+} KnownKind;
+
+typedef struct {
+    uint16_t tag;
+    KnownKind kind;
+    uint32_t low;
+    uint32_t high;
+    uint32_t denominator;
+} KnownTag;
+
+// Tags the parser reports, in tag order, with plausible value ranges
+static const KnownTag known_ifd0[] = {
+    { 0x010F, KNOWN_MAKE, 0, 0, 0 },
+    { 0x0110, KNOWN_MODEL, 0, 0, 0 },
+    { 0x0112, KNOWN_SHORT, 1, 8, 0 },                                   // Orientation
+    { 0x0132, KNOWN_DATE, 0, 0, 0 },                                    // ModifyDate
+    { 0x8298, KNOWN_COPYRIGHT, 0, 0, 0 },
+};
+
+static const KnownTag known_exif[] = {
+    { 0x829A, KNOWN_EXPOSURE, 1, 4000, 0 },                             // ExposureTime
+    { 0x829D, KNOWN_RATIONAL, 14, 220, 10 },                            // FNumber
+    { 0x8822, KNOWN_SHORT, 0, 8, 0 },                                   // ExposureProgram
+    { 0x8827, KNOWN_SHORT, 50, 12800, 0 },                              // ISO
+    { 0x8830, KNOWN_SHORT, 0, 7, 0 },                                   // SensitivityType
+    { 0x8831, KNOWN_LONG, 50, 12800, 0 },                               // StandardOutputSensitivity
+    { 0x9003, KNOWN_DATE, 0, 0, 0 },                                    // DateTimeOriginal
+    { 0x9004, KNOWN_DATE, 0, 0, 0 },                                    // CreateDate
+    { 0x920A, KNOWN_RATIONAL, 100, 6000, 10 },                          // FocalLength
+    { 0xA001, KNOWN_SHORT, 1, 2, 0 },                                   // ColorSpace
+    { 0xA002, KNOWN_LONG, 320, 8192, 0 },                               // ExifImageWidth
+    { 0xA003, KNOWN_LONG, 240, 8192, 0 },                               // ExifImageHeight
+    { 0xA405, KNOWN_SHORT, 14, 600, 0 },                                // FocalLengthIn35mmFormat
+    { 0xA408, KNOWN_SHORT, 0, 2, 0 },                                   // Contrast
+    { 0xA409, KNOWN_SHORT, 0, 2, 0 },                                   // Saturation
+    { 0xA40A, KNOWN_SHORT, 0, 2, 0 },                                   // Sharpness
+};
+
+static void add_known(CorpusFile *file, bool in_exif, const KnownTag *tags, size_t count, size_t index) {
+    static const char *makes[] = { "Canon", "NIKON CORPORATION", "RICOH IMAGING COMPANY, LTD.", "FUJIFILM", "SONY" };
+    static const char *models[] = { "Canon EOS R5", "NIKON Z 6", "RICOH GR III", "X-T5", "ILCE-7M4" };
+    uint32_t camera = pick(&file->rng, 0, 4);
+    char text[32];
+
+    for (size_t i = 0; i < count; i++) {
+        const KnownTag *known = &tags[i];
+        uint32_t value = pick(&file->rng, known->low, known->high);
+
+        switch (known->kind) {
+            case KNOWN_MAKE: {
+                add_ascii(file, in_exif, known->tag, makes[camera]);
+                break;
+            }
+            case KNOWN_MODEL: {
+                add_ascii(file, in_exif, known->tag, models[camera]);
+                break;
+            }
+            case KNOWN_DATE: {
+                add_date(file, in_exif, known->tag);
+                break;
+            }
+            case KNOWN_COPYRIGHT: {
+                snprintf(text, sizeof(text), "Corpus %06zu", index);
+                add_ascii(file, in_exif, known->tag, text);
+                break;
+            }
+            case KNOWN_SHORT: {
+                add_short(file, in_exif, known->tag, (uint16_t)value);
+                break;
+            }
+            case KNOWN_LONG: {
+                add_long(file, in_exif, known->tag, value);
+                break;
+            }
+            case KNOWN_RATIONAL: {
+                add_rational(file, in_exif, known->tag, value, known->denominator);
+                break;
+            }
+            case KNOWN_EXPOSURE: {
+                add_rational(file, in_exif, known->tag, 1, value);
+                break;
+            }
+        }
+    }
+}
+
+// Private tags the parser does not know. Offset heavy files store most of
+// them out of line, the rest keep most values inline.
+static void add_filler(CorpusFile *file, bool in_exif, uint16_t tag, bool offset_heavy) {
+    uint64_t *rng = &file->rng;
+    uint32_t roll = pick(rng, 0, 9);
+
+    if (!offset_heavy || file->tiff_bytes > CORPUS_TIFF_BUDGET) {       // Inline values, or out of room
+        if (roll < 5) {
+            add_entry(file, in_exif, tag, EXIF_TYPE_SHORT, 1, memset(arena_take(file, 2), (int)roll, 2));
+        } else if (roll < 8) {
+            add_entry(file, in_exif, tag, EXIF_TYPE_LONG, 1, memset(arena_take(file, 4), (int)roll, 4));
+        } else {
+            add_entry(file, in_exif, tag, EXIF_TYPE_BYTE, 4, memset(arena_take(file, 4), (int)roll, 4));
+        }
+        return;
+    }
+
+    uint32_t count = 0;
+    uint16_t type = 0;
+    if (roll < 3) {
+        type = EXIF_TYPE_ASCII;
+        count = pick(rng, 16, 96);
+    } else if (roll < 5) {
+        type = EXIF_TYPE_UNDEFINED;
+        count = pick(rng, 32, 256);
+    } else if (roll < 8) {
+        type = EXIF_TYPE_RATIONAL;
+        count = pick(rng, 1, 8);
+    } else {
+        type = EXIF_TYPE_LONG;
+        count = pick(rng, 2, 16);
+    }
+
+    size_t bytes = (type == EXIF_TYPE_RATIONAL) ? 8u * count : (type == EXIF_TYPE_LONG) ? 4u * count : count;
+    uint8_t *values = arena_take(file, bytes);
+    for (size_t i = 0; i < bytes; i++) {
+        values[i] = (uint8_t)('A' + (next_random(rng) % 26));
+    }
+    if (type == EXIF_TYPE_ASCII) {
+        values[bytes - 1] = '\0';
+    }
+    add_entry(file, in_exif, tag, type, count, values);
+}
+
+static size_t min_size(size_t a, size_t b) {
+    return (a < b) ? a : b;
+}
+
+static int compare_tags(const void *a, const void *b) {
+    return (int)((const ExifWriterEntry *)a)->tag - (int)((const ExifWriterEntry *)b)->tag;
+}
+
+typedef struct {
+    uint64_t seed;
+    size_t min_entries;
+    size_t max_entries;
+    size_t max_scan;
+    uint32_t tiff_percent;                                              // Share of files written as bare TIFF
+} CorpusOptions;
+
+// Builds file index of the corpus into output, or only into tiff when
+// as_tiff says the file is a bare TIFF
+static ErrorCode build_file(CorpusFile *file, const CorpusOptions *options, size_t index, OutputBuilder *tiff,
+                            OutputBuilder *output, bool *as_tiff) {
+
+    file->rng = options->seed ^ (0xD1B54A32D192ED03u * (index + 1));
+    uint64_t kind = file->rng ^ 0x5851F42D4C957F2Du;                    // Own stream, JPEG files stay the same
+    *as_tiff = pick(&kind, 0, 99) < options->tiff_percent;
+    file->used = 0;
+    file->ifd0_count = 0;
+    file->exif_count = 0;
+    file->tiff_bytes = 8;
+
+    bool big_endian = pick(&file->rng, 0, 1);
+    bool missing = pick(&file->rng, 0, 19) == 0;                        // 1 in 20 carry no EXIF at all
+    bool big_app2 = pick(&file->rng, 0, 3) == 0;                        // 1 in 4 put large APP2 blocks first
+    bool offset_heavy = pick(&file->rng, 0, 9) < 3;                     // 3 in 10 store most values out of line
+    size_t entries = pick(&file->rng, (uint32_t)options->min_entries, (uint32_t)options->max_entries);
+
+    size_t ifd0_entries = entries / 4 ? entries / 4 : 1;                // Makers put most tags in the Exif IFD
+    size_t exif_entries = entries - ifd0_entries;
+
+    add_known(file, false, known_ifd0, min_size(ifd0_entries, sizeof(known_ifd0) / sizeof(known_ifd0[0])), index);
+    for (size_t i = file->ifd0_count; i < ifd0_entries; i++) {          // Below ExifOffset, which the writer puts last
+        add_filler(file, false, (uint16_t)(0x4000 + i), offset_heavy);
+    }
+    add_known(file, true, known_exif, min_size(exif_entries, sizeof(known_exif) / sizeof(known_exif[0])), index);
+    for (size_t i = file->exif_count; i < exif_entries; i++) {
+        add_filler(file, true, (uint16_t)(0xC000 + i), offset_heavy);
+    }
+    qsort(file->ifd0, file->ifd0_count, sizeof(ExifWriterEntry), compare_tags);
+
+    ExifJpegLayout layout;
+    layout.app2_count = big_app2 ? pick(&file->rng, 1, 3) : 0;
+    layout.app2_size = big_app2 ? pick(&file->rng, 16 * 1024, 0xFFFF - 2) : 0;
+    layout.exif = !missing;
+    layout.scan_size = pick(&file->rng, 1024, (uint32_t)options->max_scan);
+
+    builder_rewind(tiff, 0);
+    builder_rewind(output, 0);
+    ErrorCode status = exif_write_tiff(tiff, big_endian, file->ifd0, file->ifd0_count, file->exif, file->exif_count);
+    if (status != ERR_OK || *as_tiff) {
+        return status;
+    }
+    return exif_write_jpeg(output, (const uint8_t *)tiff->data, tiff->len, &layout);
+}
+
+// **** Entry point **** //
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s [--count N] [--seed S] [--min-entries N] [--max-entries N] [--max-scan BYTES] [--tiff PERCENT] "
+            "directory\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+
+    CorpusOptions options = { 1, 10, CORPUS_MAX_ENTRIES, 16 * 1024, 0 };
+    size_t count = 1000;
+    const char *directory = NULL;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--count") == 0 && a + 1 < argc) {
+            count = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            options.seed = strtoull(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--min-entries") == 0 && a + 1 < argc) {
+            options.min_entries = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--max-entries") == 0 && a + 1 < argc) {
+            options.max_entries = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--max-scan") == 0 && a + 1 < argc) {
+            options.max_scan = strtoul(argv[++a], NULL, 10);
+        } else if (strcmp(argv[a], "--tiff") == 0 && a + 1 < argc) {
+            options.tiff_percent = (uint32_t)strtoul(argv[++a], NULL, 10);
+        } else if (argv[a][0] != '-' && directory == NULL) {
+            directory = argv[a];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (directory == NULL || options.min_entries < 1 || options.max_entries > CORPUS_MAX_ENTRIES ||
+        options.min_entries > options.max_entries || options.max_scan < 1024 || options.tiff_percent > 100) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        perror(directory);
+        return 1;
+    }
+
+    CorpusFile *file = malloc(sizeof(CorpusFile));
+    OutputBuilder tiff;
+    OutputBuilder output;
+    if (file == NULL || !builder_init(&tiff, EXIF_WRITER_MAX_TIFF) || !builder_init(&output, 256 * 1024)) {
+        fprintf(stderr, "gen_corpus: out of memory\n");
+        return 1;
+    }
+
+    size_t path_cap = strlen(directory) + 32;
+    char *path = malloc(path_cap);
+    if (path == NULL) {
+        fprintf(stderr, "gen_corpus: out of memory\n");
+        free(file);
+        builder_free(&tiff);
+        builder_free(&output);
+        return 1;
+    }
+    int status = 0;
+
+    for (size_t i = 0; i < count && status == 0; i++) {
+        bool as_tiff = false;
+        if (build_file(file, &options, i, &tiff, &output, &as_tiff) != ERR_OK) {
+            fprintf(stderr, "gen_corpus: could not build file %zu\n", i);
+            status = 1;
+            break;
+        }
+
+        const OutputBuilder *data = as_tiff ? &tiff : &output;           // A bare TIFF is the EXIF block itself
+        snprintf(path, path_cap, "%s/%06zu.%s", directory, i, as_tiff ? "tif" : "jpg");
+        FILE *handle = fopen(path, "wb");
+        if (handle == NULL || fwrite(data->data, 1, data->len, handle) != data->len) {
+            perror(path);
+            status = 1;
+        }
+        if (handle != NULL) {
+            fclose(handle);
+        }
+    }
+
+    if (status == 0) {
+        printf("gen_corpus: wrote %zu files to %s (seed %llu)\n", count, directory, (unsigned long long)options.seed);
+    }
+    free(path);
+    free(file);
+    builder_free(&tiff);
+    builder_free(&output);
+    return status;
+}